@@ -1 +1 @@
-g++ ./src/threadpool.cpp  example.cpp -I./include -std=c++17 -g -o example -pthread
\ No newline at end of file
+g++ ./src/*.cpp example.cpp -I./include -std=c++17 -g -o example -pthread
\ No newline at end of file
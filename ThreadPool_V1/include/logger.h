@@ -0,0 +1,64 @@
+#ifndef LOGGER_V1_H__
+#define LOGGER_V1_H__
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// 和V2链接到同一个程序时(V2的性能对比) 用-DTHREADPOOL_V1_NAMESPACE=v1把V1的代码放进命名空间 避免类名冲突
+#ifdef THREADPOOL_V1_NAMESPACE
+#define THREADPOOL_V1_BEGIN namespace THREADPOOL_V1_NAMESPACE {
+#define THREADPOOL_V1_END }
+#else
+#define THREADPOOL_V1_BEGIN
+#define THREADPOOL_V1_END
+#endif
+
+THREADPOOL_V1_BEGIN
+
+// 日志级别 低于当前级别的日志直接丢弃 LOG_OFF关闭全部日志
+enum LogLevel
+{
+    LOG_DEBUG,
+    LOG_INFO,
+    LOG_WARN,
+    LOG_ERROR,
+    LOG_OFF
+};
+
+// 异步日志 线程池的事件(创建线程、线程退出、队列满)都通过它输出 持有taskQueMtx_时写日志也不会被慢终端阻塞
+// 每个线程第一次写日志时注册一个环形缓冲区 写日志只格式化到自己的缓冲区 由后台线程定期写到stdout/stderr
+// 缓冲区满时丢弃新记录并计数 INFO及以下写到stdout WARN及以上写到stderr
+class Logger
+{
+    public:
+        static constexpr size_t MAX_MESSAGE = 126;  // 每条日志最多保存的字符数 超出的部分截断
+        static constexpr size_t RING_SIZE = 256;    // 每个线程缓冲区的记录数
+
+        static void setLevel(LogLevel level) { level_.store(level, std::memory_order_relaxed); }
+        static LogLevel getLevel() { return (LogLevel)level_.load(std::memory_order_relaxed); }
+        static bool enabled(LogLevel level) { return level >= level_.load(std::memory_order_relaxed); }
+
+        // printf格式 级别被过滤时不格式化参数
+        template <typename... Args>
+        static void log(LogLevel level, const char* fmt, Args... args)
+        {
+            if (!enabled(level)) return;
+            write(level, fmt, args...);
+        }
+
+        // 等待调用前写入的日志全部输出 进程正常退出时自动调用一次
+        static void flush();
+
+        // 因缓冲区满而丢弃的日志条数
+        static uint64_t droppedCount();
+
+    private:
+        static void write(LogLevel level, const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+
+        static inline std::atomic_int level_{LOG_INFO};
+};
+
+THREADPOOL_V1_END
+
+#endif
@@ -1,8 +1,8 @@
-#ifndef THREADPOOL_H__
-#define THREADPOOL_H__
+#ifndef THREADPOOL_V1_H__
+#define THREADPOOL_V1_H__
 
 #include <vector>
-#include <queue>
+#include <deque>
 #include <memory>
 #include <atomic>
 #include <mutex>
@@ -10,94 +10,265 @@
 #include <thread>
 #include <functional>
 #include <unordered_map>
+#include <type_traits>
+#include <chrono>
+#include <stdexcept>
+#include <exception>
+#include <utility>
+#include <new>
+#include <cstddef>
+#include <cstdint>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// 线程池的事件日志 也定义了THREADPOOL_V1_BEGIN/THREADPOOL_V1_END
+#include "logger.h"
+
+THREADPOOL_V1_BEGIN
+
+// 类型编号 每个类型一个静态变量 用它的地址区分类型 不依赖RTTI
+template <typename T>
+struct TypeTag
+{
+    static constexpr char id = 0;
+};
 
+template <typename T>
+constexpr const void* typeId()
+{
+    return &TypeTag<T>::id;
+}
 
 // Any类型(c++17已支持) 用于接收任务的不同返回值
+// 不超过INLINE_SIZE字节、移动不抛异常的类型直接保存在内部缓冲区中 不需要分配内存
 class Any
 {
     public:
-        Any() = default;
-        template <typename T>
-        Any(T data) : base_(std::make_unique<Derive<T>>(data)) 
-        {}
-        Any(Any&&) = default;
-        Any& operator=(Any&&) = default;
+        static constexpr size_t INLINE_SIZE = 4 * sizeof(void*);
+
+        Any() : ops_(nullptr) {}
+        template <typename T, typename = std::enable_if_t<!std::is_same<std::decay_t<T>, Any>::value>>
+        Any(T&& data) : ops_(nullptr)
+        {
+            emplace<std::decay_t<T>>(std::forward<T>(data));
+        }
+        Any(Any&& other) noexcept : ops_(nullptr)
+        {
+            moveFrom(other);
+        }
+        Any& operator=(Any&& other) noexcept
+        {
+            if (this != &other)
+            {
+                reset();
+                moveFrom(other);
+            }
+            return *this;
+        }
         Any(const Any&) = delete;
         Any& operator=(const Any&) = delete;
-        ~Any() = default;
+        ~Any() { reset(); }
+
+        bool empty() const { return ops_ == nullptr; }
 
+        // 取出保存的值 值被移走 之后Any为空
         template <typename T>
         T cast()
         {
-            Derive<T>* pd = dynamic_cast<Derive<T>*>(base_.get());
-            if (pd == nullptr)
+            if (ops_ == nullptr || ops_->type != typeId<T>())
             {
                 throw "type is unright, please check it!";
             }
-            return pd->data_;
+            T value(std::move(*static_cast<T*>(ops_->get(*this))));
+            reset();
+            return value;
         }
 
     private:
-        // 基类
-        class Base
+        // 每个类型一张操作表
+        struct Ops
+        {
+            const void* type;
+            void* (*get)(Any&);
+            void (*move)(Any& dst, Any& src);  // src随后由destroy销毁
+            void (*destroy)(Any&);
+        };
+
+        template <typename T>
+        static constexpr bool isInline()
         {
-            public:
-                virtual ~Base() = default;
+            return sizeof(T) <= INLINE_SIZE && alignof(T) <= alignof(std::max_align_t)
+                && std::is_nothrow_move_constructible<T>::value;
+        }
+
+        template <typename T>
+        struct InlineOps
+        {
+            static void* get(Any& any) { return any.buf_; }
+            static void move(Any& dst, Any& src) { new (dst.buf_) T(std::move(*static_cast<T*>(get(src)))); }
+            static void destroy(Any& any) { static_cast<T*>(get(any))->~T(); }
+            static constexpr Ops ops = {typeId<T>(), &get, &move, &destroy};
         };
-        // 派生类
+
         template <typename T>
-        class Derive : public Base
+        struct HeapOps
         {
-            public:
-                Derive(T data) : data_(data) {}
-                T data_;
+            static T*& ptr(Any& any) { return *reinterpret_cast<T**>(any.buf_); }
+            static void* get(Any& any) { return ptr(any); }
+            // 只转移指针 源对象置空后destroy不会释放
+            static void move(Any& dst, Any& src) { ptr(dst) = ptr(src); ptr(src) = nullptr; }
+            static void destroy(Any& any) { delete ptr(any); }
+            static constexpr Ops ops = {typeId<T>(), &get, &move, &destroy};
         };
 
+        template <typename T, typename V>
+        void emplace(V&& data)
+        {
+            if constexpr (isInline<T>())
+            {
+                new (buf_) T(std::forward<V>(data));
+                ops_ = &InlineOps<T>::ops;
+            }
+            else
+            {
+                HeapOps<T>::ptr(*this) = new T(std::forward<V>(data));
+                ops_ = &HeapOps<T>::ops;
+            }
+        }
+
+        void moveFrom(Any& other) noexcept
+        {
+            if (other.ops_ == nullptr) return ;
+            other.ops_->move(*this, other);
+            ops_ = other.ops_;
+            other.reset();
+        }
+
+        void reset() noexcept
+        {
+            if (ops_ == nullptr) return ;
+            ops_->destroy(*this);
+            ops_ = nullptr;
+        }
+
     private:
-        std::unique_ptr<Base> base_;   
+        const Ops* ops_;
+        alignas(std::max_align_t) unsigned char buf_[INLINE_SIZE];
 };
 
-// c++20 
-class Semaphore
+// 一次性事件 只允许一个线程等待 set之后wait立即返回
+// Linux下直接使用futex 等待者已经在等待时set才需要一次系统调用
+class Event
 {
     public:
-        Semaphore(int resLimit = 0) : resLimit_(resLimit) {}
-        ~Semaphore() = default;
+        Event() : state_(EMPTY) {}
+        Event(const Event&) = delete;
+        Event& operator=(const Event&) = delete;
+
+        bool isSet() const { return state_.load(std::memory_order_acquire) == SET; }
 
         void wait()
         {
-           std::unique_lock<std::mutex> lk(mtx_); 
-           cond_.wait(lk, [&]() {return resLimit_ > 0;});
-           resLimit_ --;
+            uint32_t state = EMPTY;
+            if (!state_.compare_exchange_strong(state, WAITING, std::memory_order_acquire) && state == SET)
+            {
+                return ;
+            }
+            // 之前waitFor超时返回时状态停留在WAITING
+            while (state_.load(std::memory_order_acquire) == WAITING)
+            {
+                waitWhileWaiting(nullptr);
+            }
         }
 
-        void post()
+        // 最多等待timeout 返回是否已经SET
+        bool waitFor(std::chrono::nanoseconds timeout)
         {
-            std::unique_lock<std::mutex> lk(mtx_);
-            resLimit_ ++;
-            cond_.notify_all();
+            uint32_t state = EMPTY;
+            if (!state_.compare_exchange_strong(state, WAITING, std::memory_order_acquire) && state == SET)
+            {
+                return true;
+            }
+            waitWhileWaiting(&timeout);
+            return isSet();
+        }
+
+        void set()
+        {
+            if (state_.exchange(SET, std::memory_order_release) == WAITING)
+            {
+                wake();
+            }
         }
+
     private:
-        int resLimit_;
+        static constexpr uint32_t EMPTY = 0;
+        static constexpr uint32_t WAITING = 1;
+        static constexpr uint32_t SET = 2;
+
+#ifdef __linux__
+        void waitWhileWaiting(const std::chrono::nanoseconds* timeout)
+        {
+            timespec ts;
+            if (timeout != nullptr)
+            {
+                ts.tv_sec = timeout->count() / 1000000000;
+                ts.tv_nsec = timeout->count() % 1000000000;
+            }
+            syscall(SYS_futex, reinterpret_cast<uint32_t*>(&state_), FUTEX_WAIT_PRIVATE, WAITING,
+                    timeout != nullptr ? &ts : nullptr, nullptr, 0);
+        }
+
+        void wake()
+        {
+            syscall(SYS_futex, reinterpret_cast<uint32_t*>(&state_), FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+        }
+#else
+        void waitWhileWaiting(const std::chrono::nanoseconds* timeout)
+        {
+            std::unique_lock<std::mutex> lk(mtx_);
+            auto notWaiting = [&]() {return state_.load(std::memory_order_acquire) != WAITING;};
+            if (timeout != nullptr) cond_.wait_for(lk, *timeout, notWaiting);
+            else cond_.wait(lk, notWaiting);
+        }
+
+        void wake()
+        {
+            std::unique_lock<std::mutex> lk(mtx_);
+            cond_.notify_one();
+        }
+
         std::mutex mtx_;
         std::condition_variable cond_;
+#endif
+
+        std::atomic<uint32_t> state_;
 };
 
 
 // 封装任务的返回值类
+// 返回值和完成事件保存在Task中 Result和线程池共同持有Task 任意一方先销毁都不会访问失效的对象
 class Task;
 class Result
 {
     public:
         Result(std::shared_ptr<Task> task = nullptr, bool isValid = true);
+        Result(Result&&) = default;
+        Result& operator=(Result&&) = default;
         ~Result() = default;
+        // 等待任务完成并取出返回值 只能调用一次 提交失败的Result抛出std::runtime_error run抛出的异常在这里重新抛出
+        // 在线程池线程上调用时 等待期间执行队列中的其他任务 等待的任务还在队列中时直接取出执行
+        // 任务中可以提交子任务并等待 递归分治不会因为所有线程都在等待而死锁
         Any get();
-        void setVal(Any any);
+        // 提交是否成功 队列满(等待超时)时为false
+        bool isValid() const { return isValid_ && task_ != nullptr; }
     private:
-        Any res_;
-        Semaphore sem_;
         std::shared_ptr<Task> task_;
-        std::atomic_bool isValid_;
+        bool isValid_;
 };
 
 // 线程模式
@@ -109,18 +280,20 @@ enum PoolMode
 
 
 // 任务抽象基类
-// 用户需重写run方法
+// 用户需重写run方法 每个Task对象只能提交一次
 class Task
 {
     public:
-        Task() : result_(nullptr){}
+        Task() = default;
         void exec();
         virtual Any run() = 0; // 对外接口
         virtual ~Task() = default;
-        void setResult(Result* result_);
-    
+
     private:
-        Result* result_;
+        friend class Result;
+        Any value_;   // run的返回值
+        std::exception_ptr exception_; // run抛出的异常
+        Event done_;  // run完成 正常返回和抛出异常都会设置
 };
 
 // 线程类型 
@@ -134,7 +307,7 @@ class Thread
         ulong getId() const {return threadId_;}
     private:
         ThreadFunc func_;
-        static ulong idIdx_;
+        static std::atomic<ulong> idIdx_; // 所有线程池共用 多个线程池可能在不同的提交线程上同时创建线程
         ulong threadId_;
 };
 
@@ -155,6 +328,9 @@ class ThreadPool
         // 设置cached模式下的线程数目上限
         void setCachedModeThreadSizeLimit(int threashHold);
 
+        // 设置任务队列满时提交等待的最长时间 默认1秒 为0时不等待 立即返回无效的Result
+        void setSubmitTimeout(std::chrono::milliseconds timeout);
+
         // 提交任务
         Result submitTask(std::shared_ptr<Task> task);
 
@@ -162,10 +338,15 @@ class ThreadPool
         ThreadPool& operator=(const ThreadPool&) = delete;
 
     private:
+        friend class Result;
         // 定义每个线程的任务函数 std::bind绑定到Thread中
         void threadFunc(ulong threadId);
         // 检查线程池的运行状态
         bool checkRunningState() const;
+        // 取出并执行一个任务 preferred还在队列中时优先取它 队列为空时返回false
+        bool runPendingTask(Task* preferred);
+
+        static thread_local ThreadPool* current_; // 当前线程所属的线程池 非线程池线程为nullptr
 
 
     private:
@@ -179,9 +360,10 @@ class ThreadPool
         std::atomic_int curThreadSize_; // 当前线程数
 
         // 使用shared_ptr延长用户所提交任务的生命周期 确保执行该任务时Task没有被销毁
-        std::queue<std::shared_ptr<Task>> taskQue_; // 任务队列
+        std::deque<std::shared_ptr<Task>> taskQue_; // 任务队列
         std::atomic_uint taskSize_;  // 任务数量
         int taskQueMaxThreshHold_;      // 任务数量上限
+        std::chrono::milliseconds submitTimeout_; // 队列满时提交等待的最长时间
 
         std::mutex taskQueMtx_; 
         std::condition_variable notFull_;  // 任务队列未满
@@ -192,4 +374,6 @@ class ThreadPool
 
 };
 
-#endif
\ No newline at end of file
+THREADPOOL_V1_END
+
+#endif
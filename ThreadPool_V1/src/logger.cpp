@@ -0,0 +1,234 @@
+#include "../include/logger.h"
+
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+THREADPOOL_V1_BEGIN
+
+namespace
+{
+
+const std::chrono::milliseconds DRAIN_INTERVAL(20); // 后台线程没有被唤醒时的输出间隔
+
+struct Record
+{
+    uint8_t level;
+    uint8_t len;
+    char text[Logger::MAX_MESSAGE];
+};
+
+// 单生产者单消费者环形缓冲区 生产者是注册它的线程 消费者是后台线程
+struct Ring
+{
+    alignas(64) std::atomic<size_t> head{0};   // 后台线程读取的位置
+    alignas(64) std::atomic<size_t> tail{0};   // 写日志的线程写入的位置
+    std::atomic_bool orphan{false};            // 所属线程已经退出 输出完剩余记录后释放
+    Record records[Logger::RING_SIZE];
+};
+
+struct State
+{
+    std::mutex ringsMtx;
+    std::vector<Ring*> rings;          // 由ringsMtx保护
+    std::mutex wakeMtx;
+    std::condition_variable wakeCond;  // 后台线程睡眠
+    std::condition_variable flushCond; // 等待flush完成
+    std::atomic_bool wake{false};      // 写日志的线程不加锁设置 错过唤醒时最多等DRAIN_INTERVAL
+    uint32_t flushRequest = 0;         // 由wakeMtx保护
+    uint32_t flushDone = 0;            // 由wakeMtx保护
+    std::atomic<uint64_t> dropped{0};
+};
+
+// 不析构 进程退出时其他线程可能仍在写日志
+State& state()
+{
+    static State* s = new State;
+    return *s;
+}
+
+// 输出所有缓冲区中已有的记录
+void drainOnce(State& s)
+{
+    std::vector<Ring*> rings;
+    {
+        std::lock_guard<std::mutex> lock(s.ringsMtx);
+        rings = s.rings;
+    }
+
+    for (Ring* ring : rings)
+    {
+        size_t head = ring->head.load(std::memory_order_relaxed);
+        size_t tail = ring->tail.load(std::memory_order_acquire);
+        for (; head != tail; head++)
+        {
+            const Record& record = ring->records[head % Logger::RING_SIZE];
+            FILE* out = record.level >= LOG_WARN ? stderr : stdout;
+            fwrite(record.text, 1, record.len, out);
+            fputc('\n', out);
+        }
+        ring->head.store(head, std::memory_order_release);
+    }
+
+    static uint64_t reported = 0;
+    uint64_t dropped = s.dropped.load(std::memory_order_relaxed);
+    if (dropped != reported)
+    {
+        fprintf(stderr, "%llu log messages dropped\n", (unsigned long long)(dropped - reported));
+        reported = dropped;
+    }
+    fflush(stdout);
+    fflush(stderr);
+}
+
+// 释放所属线程已经退出并且已经输出完的缓冲区
+void reclaimRings(State& s)
+{
+    std::lock_guard<std::mutex> lock(s.ringsMtx);
+    for (size_t i = 0; i < s.rings.size(); )
+    {
+        Ring* ring = s.rings[i];
+        if (ring->orphan.load(std::memory_order_acquire)
+            && ring->head.load(std::memory_order_relaxed) == ring->tail.load(std::memory_order_acquire))
+        {
+            delete ring;
+            s.rings[i] = s.rings.back();
+            s.rings.pop_back();
+            continue;
+        }
+        i++;
+    }
+}
+
+void drainLoop()
+{
+    State& s = state();
+    std::unique_lock<std::mutex> lk(s.wakeMtx);
+    for (;;)
+    {
+        uint32_t request = s.flushRequest;
+        lk.unlock();
+        drainOnce(s);
+        reclaimRings(s);
+        lk.lock();
+        if (s.flushDone != request)
+        {
+            s.flushDone = request;
+            s.flushCond.notify_all();
+        }
+        s.wakeCond.wait_for(lk, DRAIN_INTERVAL, [&]() {return s.wake.load(std::memory_order_relaxed);});
+        s.wake.store(false, std::memory_order_relaxed);
+    }
+}
+
+void flushAtExit()
+{
+    Logger::flush();
+}
+
+// 每个线程的缓冲区 线程退出时交给后台线程释放
+struct LocalRing
+{
+    Ring* ring = nullptr;
+    ~LocalRing()
+    {
+        exited() = true;
+        if (ring != nullptr)
+        {
+            ring->orphan.store(true, std::memory_order_release);
+        }
+    }
+
+    static bool& exited()
+    {
+        static thread_local bool flag = false;
+        return flag;
+    }
+};
+
+Ring* localRing()
+{
+    static thread_local LocalRing local;
+    if (local.ring == nullptr)
+    {
+        State& s = state();
+        Ring* ring = new Ring;
+        std::lock_guard<std::mutex> lock(s.ringsMtx);
+        static bool started = false;
+        if (!started)
+        {
+            // 第一次写日志时启动后台线程 后台线程和State一样在进程退出前一直存在
+            started = true;
+            std::thread(drainLoop).detach();
+            std::atexit(flushAtExit);
+        }
+        s.rings.push_back(ring);
+        local.ring = ring;
+    }
+    return local.ring;
+}
+
+}
+
+void Logger::write(LogLevel level, const char* fmt, ...)
+{
+    State& s = state();
+    if (LocalRing::exited())
+    {
+        // 线程的缓冲区已经交出
+        s.dropped.fetch_add(1, std::memory_order_relaxed);
+        return ;
+    }
+    Ring* ring = localRing();
+    size_t tail = ring->tail.load(std::memory_order_relaxed);
+    size_t used = tail - ring->head.load(std::memory_order_acquire);
+    if (used >= RING_SIZE)
+    {
+        s.dropped.fetch_add(1, std::memory_order_relaxed);
+        s.wake.store(true, std::memory_order_relaxed);
+        s.wakeCond.notify_one();
+        return ;
+    }
+
+    Record& record = ring->records[tail % RING_SIZE];
+    va_list args;
+    va_start(args, fmt);
+    int len = vsnprintf(record.text, MAX_MESSAGE, fmt, args);
+    va_end(args);
+    record.level = (uint8_t)level;
+    record.len = (uint8_t)(len < 0 ? 0 : (size_t)len < MAX_MESSAGE ? len : MAX_MESSAGE - 1);
+    ring->tail.store(tail + 1, std::memory_order_release);
+
+    // 缓冲区过半时提前唤醒后台线程 否则等待下一次定期输出
+    if (used + 1 >= RING_SIZE / 2)
+    {
+        s.wake.store(true, std::memory_order_relaxed);
+        s.wakeCond.notify_one();
+    }
+}
+
+void Logger::flush()
+{
+    State& s = state();
+    {
+        std::lock_guard<std::mutex> lock(s.ringsMtx);
+        if (s.rings.empty()) return ; // 还没有人写过日志 后台线程没有启动
+    }
+    std::unique_lock<std::mutex> lk(s.wakeMtx);
+    uint32_t request = ++s.flushRequest;
+    s.wake.store(true, std::memory_order_relaxed);
+    s.wakeCond.notify_one();
+    s.flushCond.wait(lk, [&]() {return (int32_t)(s.flushDone - request) >= 0;});
+}
+
+uint64_t Logger::droppedCount()
+{
+    return state().dropped.load(std::memory_order_relaxed);
+}
+
+THREADPOOL_V1_END
@@ -1,21 +1,27 @@
 #include "../include/threadpool.h"
 
-#include <iostream>
+#include <algorithm>
 #include <ctime>
 
+THREADPOOL_V1_BEGIN
+
 const int TASK_MAX_THRESHHOLD = 1024;
 const int THREAD_MAX_THRESHHOLE = 10; // cached模式下线程数目的上限
 const int THREAD_MAX_IDLE_TIME = 60; // 秒
+const std::chrono::microseconds HELP_WAIT_INTERVAL(100); // 等待结果时队列为空 每次最多阻塞的时间
+
+thread_local ThreadPool* ThreadPool::current_ = nullptr;
 
 ThreadPool::ThreadPool():
+    poolMode_(MODE_FIXED),
     initThreadSize_(0),
-    taskSize_(0),
-    taskQueMaxThreshHold_(TASK_MAX_THRESHHOLD),
     threadSizeThreshHold_(10),
-    poolMode_(MODE_FIXED),
-    isPoolRunning_(false),
     idleThreadSize_(0),
-    curThreadSize_(0)
+    curThreadSize_(0),
+    taskSize_(0),
+    taskQueMaxThreshHold_(TASK_MAX_THRESHHOLD),
+    submitTimeout_(std::chrono::seconds(1)),
+    isPoolRunning_(false)
 {
 
 }
@@ -52,25 +58,31 @@ void ThreadPool::setCachedModeThreadSizeLimit(int threashHold)
     threadSizeThreshHold_ = threashHold;
 }
 
+void ThreadPool::setSubmitTimeout(std::chrono::milliseconds timeout)
+{
+    if (checkRunningState()) return ;
+    submitTimeout_ = timeout;
+}
+
 Result ThreadPool::submitTask(std::shared_ptr<Task> task)
 {
     std::unique_lock<std::mutex> lk(taskQueMtx_);
-    if (!notFull_.wait_for(lk, std::chrono::seconds(1), [&]() {return taskQue_.size() < taskQueMaxThreshHold_;}))
+    if (!notFull_.wait_for(lk, submitTimeout_, [&]() {return taskQue_.size() < (size_t)taskQueMaxThreshHold_;}))
     {
-        std::cerr << "task queue is full, submit task fail, retry later." << std::endl;
+        Logger::log(LOG_WARN, "task queue is full, submit task fail, retry later.");
         return Result(task, false);
     }
-    taskQue_.push(task); 
+    taskQue_.push_back(task);
     taskSize_++;
 
     notEmpty_.notify_all();
 
     // cached模式下 当前任务数大于空闲线程数并且当前已经创建的线程总数没有超过设定的阈值 就创建一个新的线程
-    if (poolMode_ == MODE_CACHED && taskQue_.size() > idleThreadSize_ && curThreadSize_ < threadSizeThreshHold_)
+    if (poolMode_ == MODE_CACHED && taskQue_.size() > (size_t)idleThreadSize_ && curThreadSize_ < threadSizeThreshHold_)
     {   
         auto ptr = std::make_unique<Thread>(std::bind(&ThreadPool::threadFunc, this, std::placeholders::_1));
         ulong id = ptr->getId();
-        std::cout << "create new thread, id = " << id << std::endl;
+        Logger::log(LOG_INFO, "create new thread, id = %lu", id);
         threads_[id] = std::move(ptr);
         threads_[id]->start();
         idleThreadSize_ ++;
@@ -95,15 +107,17 @@ void ThreadPool::start(int initThreadSize)
         threads_[id] = std::move(threadPtr);
     }
 
-    for (int i = 0; i < initThreadSize_; i++)
+    // 线程id全局递增 多个线程池时不一定从0开始 所以遍历容器启动
+    for (auto& kv : threads_)
     {
-        threads_[i]->start();
+        kv.second->start();
         idleThreadSize_ ++;
     }
 }
 
 void ThreadPool::threadFunc(ulong threadId)
 {
+    current_ = this;
     auto last_time = std::chrono::high_resolution_clock().now();
     for (;;)
     {
@@ -115,7 +129,8 @@ void ThreadPool::threadFunc(ulong threadId)
                 if (!isPoolRunning_) // 保证threadpool析构的时候所有任务都完成再退出
                 {
                     threads_.erase(threadId);
-                    std::cout << threadId << " exit because threadpool life is over!" << std::endl;
+                    current_ = nullptr;
+                    Logger::log(LOG_INFO, "%lu exit because threadpool life is over!", threadId);
                     exitCond_.notify_all();
                     return ;
                 }
@@ -128,8 +143,9 @@ void ThreadPool::threadFunc(ulong threadId)
                         auto dur = std::chrono::duration_cast<std::chrono::seconds>(now - last_time);
                         if (dur.count() > THREAD_MAX_IDLE_TIME)
                         {
-                            std::cout << threadId << " exit because idle time is too long!" << std::endl;
+                            Logger::log(LOG_INFO, "%lu exit because idle time is too long!", threadId);
                             threads_.erase(threadId);
+                            current_ = nullptr;
                             curThreadSize_ --;
                             idleThreadSize_ --;
                             return ;
@@ -144,7 +160,7 @@ void ThreadPool::threadFunc(ulong threadId)
             }
 
             task = taskQue_.front();
-            taskQue_.pop();
+            taskQue_.pop_front();
             idleThreadSize_ --;
             taskSize_ --;
             if (taskQue_.size() > 0)
@@ -163,11 +179,39 @@ void ThreadPool::threadFunc(ulong threadId)
     }
 }
 
+bool ThreadPool::runPendingTask(Task* preferred)
+{
+    std::shared_ptr<Task> task;
+    {
+        std::unique_lock<std::mutex> lk(taskQueMtx_);
+        if (taskQue_.empty()) return false;
+
+        auto it = taskQue_.begin();
+        if (preferred != nullptr)
+        {
+            // 子任务通常刚提交 从队尾开始找
+            auto rit = std::find_if(taskQue_.rbegin(), taskQue_.rend(),
+                                    [&](const std::shared_ptr<Task>& t) {return t.get() == preferred;});
+            if (rit != taskQue_.rend()) it = (rit + 1).base();
+        }
+        task = std::move(*it);
+        taskQue_.erase(it);
+        taskSize_ --;
+        notFull_.notify_all();
+    }
+    // 本线程没有回到空闲状态 idleThreadSize_不变
+    if (task != nullptr)
+    {
+        task->exec();
+    }
+    return true;
+}
+
 // --------------------Thread类方法实现-------------------------------
 
-ulong Thread::idIdx_ = 0;
+std::atomic<ulong> Thread::idIdx_(0);
 
-Thread::Thread(ThreadFunc func) : func_(func), threadId_(idIdx_ ++)
+Thread::Thread(ThreadFunc func) : func_(func), threadId_(idIdx_.fetch_add(1, std::memory_order_relaxed))
 {}
 
 Thread::~Thread()
@@ -183,37 +227,53 @@ void Thread::start()
 // --------------------Task类方法实现-------------------------------
 void Task::exec()
 {
-    result_->setVal(run());
-}
-
-void Task::setResult(Result* result)
-{
-    this->result_ = result;
+    // run抛出异常时也要设置done_ 否则等待结果的线程永远阻塞
+    try
+    {
+        value_ = run();
+    }
+    catch (...)
+    {
+        exception_ = std::current_exception();
+    }
+    done_.set();
 }
 
 
 // --------------------Result类方法实现-------------------------------
 Result::Result(std::shared_ptr<Task> task, bool isValid) :
-    task_(task),
+    task_(std::move(task)),
     isValid_(isValid)
 {
-    task_->setResult(this);
 }
 
 // 用户调用
 Any Result::get()
 {
-    if (!isValid_)
+    if (!isValid())
     {
-        return "";
+        throw std::runtime_error("task queue is full, task rejected");
     }
-    sem_.wait();
-    return std::move(res_);
+    ThreadPool* pool = ThreadPool::current_;
+    if (pool != nullptr)
+    {
+        // 只在第一次查找等待的任务 不在队列中说明已经被取走 之后不会再回到队列
+        Task* preferred = task_.get();
+        while (!task_->done_.isSet())
+        {
+            if (!pool->runPendingTask(preferred))
+            {
+                task_->done_.waitFor(HELP_WAIT_INTERVAL);
+            }
+            preferred = nullptr;
+        }
+    }
+    task_->done_.wait();
+    if (task_->exception_)
+    {
+        std::rethrow_exception(task_->exception_);
+    }
+    return std::move(task_->value_);
 }
 
-// 执行任务的线程调用
-void Result::setVal(Any any)
-{
-    this->res_ = std::move(any);
-    sem_.post();
-}
\ No newline at end of file
+THREADPOOL_V1_END
@@ -0,0 +1,80 @@
+#include "threadpool.h"
+#include "check.h"
+
+#include <array>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+
+// Any和Event: 类型不匹配时抛出异常、大对象放在堆上、取出后再取、事件的等待和超时
+
+template <typename T>
+static bool castFails(Any& any)
+{
+    try
+    {
+        any.cast<T>();
+    }
+    catch (const char*)
+    {
+        return true;
+    }
+    return false;
+}
+
+static void testAny()
+{
+    // 类型不匹配 值保留 之后仍可以按正确的类型取出
+    Any number(42);
+    CHECK(castFails<long>(number));
+    CHECK(!number.empty());
+    CHECK(number.cast<int>() == 42);
+
+    // 取出后为空 再取抛出异常
+    CHECK(number.empty());
+    CHECK(castFails<int>(number));
+
+    // 超过内部缓冲区的类型放在堆上 移动后仍然可以取出
+    using Big = std::array<long, 16>;
+    Big big;
+    for (int i = 0; i < 16; i++) big[i] = i * i;
+    static_assert(sizeof(Big) > Any::INLINE_SIZE, "must not fit inline");
+    Any heap(big);
+    Any moved(std::move(heap));
+    CHECK(heap.empty());
+    CHECK(moved.cast<Big>()[15] == 225);
+    CHECK(castFails<Big>(moved));
+
+    // 只能移动的类型
+    Any owned(std::make_unique<std::string>("owned"));
+    CHECK(*owned.cast<std::unique_ptr<std::string>>() == "owned");
+}
+
+static void testEvent()
+{
+    // 先set后wait立即返回
+    Event ready;
+    ready.set();
+    CHECK(ready.isSet());
+    ready.wait();
+    CHECK(ready.waitFor(std::chrono::milliseconds(0)));
+
+    // 超时后仍然可以继续等待 另一个线程set后wait返回
+    Event later;
+    CHECK(!later.waitFor(std::chrono::milliseconds(5)));
+    std::thread setter([&]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        later.set();
+    });
+    later.wait();
+    CHECK(later.isSet());
+    setter.join();
+}
+
+int main()
+{
+    testAny();
+    testEvent();
+    return 0;
+}
@@ -0,0 +1,18 @@
+#ifndef CHECK_H__
+#define CHECK_H__
+
+#include <cstdio>
+#include <cstdlib>
+
+// 测试用的断言 失败时打印位置并以非0退出 不受NDEBUG影响
+#define CHECK(cond) \
+    do \
+    { \
+        if (!(cond)) \
+        { \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            std::exit(1); \
+        } \
+    } while (0)
+
+#endif
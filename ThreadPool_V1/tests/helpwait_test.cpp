@@ -0,0 +1,38 @@
+#include "threadpool.h"
+#include "check.h"
+
+#include <memory>
+
+// 等待结果时执行其他任务: 只有一个线程的线程池上 任务提交子任务并用Result::get等待不会死锁
+
+// 递归计算斐波那契数 每一层都提交两个子任务并等待
+class FibTask : public Task
+{
+    public:
+        FibTask(ThreadPool& pool, int n) : pool_(pool), n_(n) {}
+        Any run() override
+        {
+            if (n_ < 2) return n_;
+            Result a = pool_.submitTask(std::make_shared<FibTask>(pool_, n_ - 1));
+            Result b = pool_.submitTask(std::make_shared<FibTask>(pool_, n_ - 2));
+            return a.get().cast<int>() + b.get().cast<int>();
+        }
+    private:
+        ThreadPool& pool_;
+        int n_;
+};
+
+int main()
+{
+    Logger::setLevel(LOG_OFF);
+    ThreadPool pool;
+    pool.setMode(MODE_FIXED);
+    pool.setTaskQueThreshHold(1024);
+    pool.start(1);
+
+    // 一层: 父任务等待自己刚提交的子任务
+    CHECK(pool.submitTask(std::make_shared<FibTask>(pool, 2)).get().cast<int>() == 1);
+    // 多层: 等待的子任务本身也在等待
+    CHECK(pool.submitTask(std::make_shared<FibTask>(pool, 12)).get().cast<int>() == 144);
+    return 0;
+}
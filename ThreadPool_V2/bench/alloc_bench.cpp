@@ -0,0 +1,206 @@
+#include "threadpool.h"
+
+#include <iostream>
+#include <iomanip>
+#include <atomic>
+#include <vector>
+#include <future>
+#include <functional>
+#include <cstdlib>
+#include <new>
+#include <algorithm>
+#include <thread>
+#include <memory_resource>
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// 统计每个任务的堆内存分配次数和进程的峰值内存
+// 每个测试在单独fork出的子进程中运行 峰值RSS互不影响
+// 用法: ./alloc_bench [任务数]
+
+static std::atomic_long gAllocCount(0);
+
+void* operator new(size_t size)
+{
+    gAllocCount.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size == 0 ? 1 : size))
+    {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+    std::free(p);
+}
+
+// std::pmr::new_delete_resource使用带对齐参数的版本
+void* operator new(size_t size, std::align_val_t align)
+{
+    gAllocCount.fetch_add(1, std::memory_order_relaxed);
+    size_t alignment = std::max(sizeof(void*), (size_t)align);
+    if (void* p = std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment))
+    {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p, std::align_val_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, size_t, std::align_val_t) noexcept
+{
+    std::free(p);
+}
+
+// 原来的打包方式: make_shared<packaged_task> + std::bind + std::function
+static double legacyWrap(long tasks)
+{
+    std::vector<std::future<int>> results;
+    results.reserve(tasks);
+    long before = gAllocCount.load();
+    for (long i = 0; i < tasks; i++)
+    {
+        auto task = std::make_shared<std::packaged_task<int()>>(std::bind([](int x) {return x;}, (int)i));
+        results.emplace_back(task->get_future());
+        std::function<void()> fn([task]() {(*task)();});
+        fn();
+    }
+    return double(gAllocCount.load() - before) / tasks;
+}
+
+// 现在的打包方式: promise从线程本地缓存分配共享状态 函数和promise直接放入UniqueFunction
+static double uniqueWrap(long tasks, long round)
+{
+    std::vector<std::future<int>> results;
+    results.reserve(round);
+    long count = 0;
+    long before = 0;
+    for (long r = 0; r <= tasks / round; r++)
+    {
+        if (r == 1) before = gAllocCount.load(); // 第一轮用于预热线程本地缓存
+        for (long i = 0; i < round; i++)
+        {
+            std::promise<int> promise(std::allocator_arg, TaskAllocator<char>());
+            results.emplace_back(promise.get_future());
+            ThreadPool::Task fn([promise = std::move(promise), x = (int)i]() mutable {
+                setPromiseResult(promise, [&]() {return x;});
+            });
+            fn();
+        }
+        for (auto& res : results) res.get();
+        results.clear();
+        if (r > 0) count += round;
+    }
+    return double(gAllocCount.load() - before) / count;
+}
+
+// 经过线程池提交 每轮提交round个任务再全部等待 模拟反复的扇出/扇入
+// 共享状态在提交线程分配、在工作线程释放 resource为nullptr时使用默认的TaskMemoryCache
+static double poolSubmit(SchedMode mode, long tasks, long round, std::pmr::memory_resource* resource = nullptr)
+{
+    ThreadPool pool;
+    pool.setSchedMode(mode);
+    pool.setTaskQueThreshHold(round);
+    pool.setMemoryResource(resource);
+    pool.start(4);
+
+    std::vector<std::future<int>> results;
+    results.reserve(round);
+    long count = 0;
+    long before = 0;
+    for (long r = 0; r <= tasks / round; r++)
+    {
+        if (r == 1) before = gAllocCount.load(); // 第一轮让任务队列和线程本地缓存达到稳定容量
+        for (long i = 0; i < round; i++)
+        {
+            results.emplace_back(pool.submitTask([](int x) {return x;}, (int)i));
+        }
+        for (auto& res : results) res.get();
+        results.clear();
+        if (r > 0) count += round;
+    }
+    return double(gAllocCount.load() - before) / count;
+}
+
+// 线程池线程递归提交子任务 任务节点进入双端队列后大多被其他线程窃取并释放
+static double forkJoin(long tasks, std::pmr::memory_resource* resource = nullptr)
+{
+    ThreadPool pool;
+    pool.setSchedMode(SCHED_WORK_STEALING);
+    pool.setTaskQueThreshHold(1024);
+    pool.setMemoryResource(resource);
+    pool.start(4);
+
+    std::atomic_long done(0);
+    long before = 0;
+    const long fanout = 1000;
+    for (long r = 0; r <= tasks / fanout; r++)
+    {
+        if (r == 1) before = gAllocCount.load();
+        long target = (r + 1) * fanout;
+        pool.post([&pool, &done, fanout]() {
+            for (long i = 0; i < fanout; i++)
+            {
+                pool.post([&done]() {done.fetch_add(1, std::memory_order_relaxed);});
+            }
+        });
+        while (done.load() < target) std::this_thread::yield();
+    }
+    return double(gAllocCount.load() - before) / (tasks / fanout * fanout);
+}
+
+// 在子进程中运行一个测试 输出每个任务的分配次数和子进程的峰值RSS
+template <typename F>
+static void runCase(const char* name, F&& func)
+{
+    std::cout.flush();
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        double allocs = func();
+        rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        std::cout << std::setw(40) << name << std::setw(14) << allocs << usage.ru_maxrss / 1024.0 << std::endl;
+        std::cout.flush();
+        _exit(0);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+}
+
+int main(int argc, char* argv[])
+{
+    Logger::setLevel(LOG_WARN);
+    long tasks = argc > 1 ? std::atol(argv[1]) : 100000;
+    long round = 1000;
+
+    std::cout << std::fixed << std::setprecision(2) << std::left;
+    std::cout << std::setw(40) << "case" << std::setw(14) << "allocs/task" << "peak RSS(MB)" << std::endl;
+    runCase("make_shared + bind + std::function", [&]() {return legacyWrap(tasks);});
+    runCase("promise in UniqueFunction", [&]() {return uniqueWrap(tasks, round);});
+    runCase("submitTask(shared queue)", [&]() {return poolSubmit(SCHED_SHARED_QUEUE, tasks, round);});
+    runCase("submitTask(lockfree queue)", [&]() {return poolSubmit(SCHED_LOCKFREE_QUEUE, tasks, round);});
+    runCase("submitTask(work stealing)", [&]() {return poolSubmit(SCHED_WORK_STEALING, tasks, round);});
+    runCase("submitTask(stealing, new_delete)", [&]() {
+        return poolSubmit(SCHED_WORK_STEALING, tasks, round, std::pmr::new_delete_resource());
+    });
+    runCase("submitTask(stealing, pmr pool)", [&]() {
+        std::pmr::synchronized_pool_resource resource;
+        return poolSubmit(SCHED_WORK_STEALING, tasks, round, &resource);
+    });
+    runCase("fork-join post(work stealing)", [&]() {return forkJoin(tasks);});
+    runCase("fork-join post(new_delete)", [&]() {return forkJoin(tasks, std::pmr::new_delete_resource());});
+    return 0;
+}
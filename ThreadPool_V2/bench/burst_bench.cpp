@@ -0,0 +1,130 @@
+#include "threadpool.h"
+#include "v1_adapter.h"
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+
+// cached模式下突发提交的延迟
+// 每轮新建一个只有少量初始线程的线程池 一次性提交burst个阻塞任务(sleep模拟IO)
+// 统计每次submit调用本身的耗时和整批任务的完成时间
+// V1在提交路径上持锁创建线程并输出日志 V2由扩容线程在提交路径之外创建线程
+// 用法: ./burst_bench [每轮任务数] [任务耗时ms] [轮数]
+
+using Clock = std::chrono::steady_clock;
+
+struct BurstResult
+{
+    std::vector<double> submitUs;  // 每次提交的耗时
+    double makespanMs = 0;         // 每轮从第一次提交到所有任务完成的平均时间
+    int peakThreads = -1;         // V1没有线程数接口 不统计
+};
+
+static const int INIT_THREADS = 2;
+static const int MAX_THREADS = 64;
+
+static void runV2(SchedMode mode, int burst, int taskMs, int rounds, BurstResult& result)
+{
+    for (int r = 0; r < rounds; r++)
+    {
+        ThreadPool pool;
+        pool.setMode(MODE_CACHED);
+        pool.setSchedMode(mode);
+        pool.setCachedModeThreadSizeLimit(MAX_THREADS);
+        pool.setTaskQueThreshHold(burst * 2);
+        pool.start(INIT_THREADS);
+
+        std::atomic_int done(0);
+        auto begin = Clock::now();
+        for (int i = 0; i < burst; i++)
+        {
+            auto t0 = Clock::now();
+            pool.post([&done, taskMs]() {
+                std::this_thread::sleep_for(std::chrono::milliseconds(taskMs));
+                done++;
+            });
+            result.submitUs.push_back(std::chrono::duration<double, std::micro>(Clock::now() - t0).count());
+        }
+        while (done.load() < burst)
+        {
+            result.peakThreads = std::max(result.peakThreads, pool.getThreadSize());
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+        }
+        result.makespanMs += std::chrono::duration<double, std::milli>(Clock::now() - begin).count() / rounds;
+    }
+}
+
+static void runV1(int burst, int taskMs, int rounds, BurstResult& result)
+{
+    for (int r = 0; r < rounds; r++)
+    {
+        V1Pool pool(INIT_THREADS, burst * 2, MAX_THREADS);
+        std::atomic_int done(0);
+        std::vector<V1Pool::Handle> handles;
+        handles.reserve(burst);
+        auto begin = Clock::now();
+        for (int i = 0; i < burst; i++)
+        {
+            auto t0 = Clock::now();
+            handles.push_back(pool.submit([&done, taskMs]() {
+                std::this_thread::sleep_for(std::chrono::milliseconds(taskMs));
+                done++;
+            }));
+            result.submitUs.push_back(std::chrono::duration<double, std::micro>(Clock::now() - t0).count());
+        }
+        for (auto& handle : handles)
+        {
+            handle.wait();
+        }
+        result.makespanMs += std::chrono::duration<double, std::milli>(Clock::now() - begin).count() / rounds;
+    }
+}
+
+static double percentile(std::vector<double>& v, double p)
+{
+    std::sort(v.begin(), v.end());
+    return v[std::min(v.size() - 1, (size_t)(v.size() * p / 100))];
+}
+
+int main(int argc, char* argv[])
+{
+    Logger::setLevel(LOG_WARN);
+    int burst = argc > 1 ? std::atoi(argv[1]) : 256;
+    int taskMs = argc > 2 ? std::atoi(argv[2]) : 5;
+    int rounds = argc > 3 ? std::atoi(argv[3]) : 5;
+
+    struct Row
+    {
+        const char* name;
+        BurstResult result;
+    };
+    std::vector<Row> rows;
+    rows.push_back({"v1-cached", {}});
+    runV1(burst, taskMs, rounds, rows.back().result);
+    const char* names[] = {"v2-shared", "v2-stealing", "v2-lockfree"};
+    for (int mode = SCHED_SHARED_QUEUE; mode <= SCHED_LOCKFREE_QUEUE; mode++)
+    {
+        rows.push_back({names[mode], {}});
+        runV2((SchedMode)mode, burst, taskMs, rounds, rows.back().result);
+    }
+
+    std::cout << "burst = " << burst << " tasks x " << taskMs << "ms, threads " << INIT_THREADS << " -> " << MAX_THREADS
+              << ", rounds = " << rounds << std::endl;
+    std::cout << std::fixed << std::setprecision(1) << std::left;
+    std::cout << std::setw(14) << "impl" << std::setw(14) << "submit p50" << std::setw(14) << "submit p99"
+              << std::setw(14) << "submit max" << std::setw(14) << "makespan" << "peak threads" << std::endl;
+    for (auto& row : rows)
+    {
+        auto& v = row.result.submitUs;
+        std::cout << std::setw(14) << row.name << std::setw(14) << percentile(v, 50) << std::setw(14) << percentile(v, 99)
+                  << std::setw(14) << v.back() << std::setw(14) << row.result.makespanMs;
+        if (row.result.peakThreads < 0) std::cout << "-" << std::endl;
+        else std::cout << row.result.peakThreads << std::endl;
+    }
+    std::cout << "(submit in us, makespan in ms)" << std::endl;
+    return 0;
+}
@@ -0,0 +1,129 @@
+#include "threadpool.h"
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+
+// 一个租户持续灌入任务占满线程池时 另一个租户的任务从提交到开始执行的延迟
+// 不分组时两个租户的任务在同一个队列中排队 分组后按权重轮转 安静租户的延迟不受积压影响
+// 用法: ./fairshare_bench [探测次数] [灌入任务耗时us]
+
+using Clock = std::chrono::steady_clock;
+
+static void spinFor(std::chrono::microseconds dur)
+{
+    auto end = Clock::now() + dur;
+    while (Clock::now() < end) {}
+}
+
+struct LatencyResult
+{
+    double p50;
+    double p99;
+    double max;
+    long noisy;                    // 测试期间完成的灌入任务数
+    TaskGroupStats quietStats;     // 分组时安静租户所在组的统计
+};
+
+static LatencyResult run(SchedMode mode, int threads, bool grouped, int probes, int workUs)
+{
+    ThreadPool pool;
+    pool.setSchedMode(mode);
+    pool.setTaskQueThreshHold(4096);
+    pool.start(threads);
+
+    TaskGroup noisyGroup;
+    TaskGroup quietGroup;
+    if (grouped)
+    {
+        noisyGroup = pool.createTaskGroup("noisy");
+        quietGroup = pool.createTaskGroup("quiet");
+    }
+
+    // 灌入任务的租户保持backlog个任务在队列中排队
+    const int backlog = threads * 256;
+    std::atomic_int outstanding(0);
+    std::atomic_long completed(0);
+    std::atomic_bool stop(false);
+    std::thread producer([&]() {
+        while (!stop.load(std::memory_order_relaxed))
+        {
+            if (outstanding.load(std::memory_order_relaxed) >= backlog)
+            {
+                std::this_thread::yield();
+                continue;
+            }
+            outstanding++;
+            pool.submitTask(noisyGroup, [&, workUs]() {
+                spinFor(std::chrono::microseconds(workUs));
+                completed++;
+                outstanding--;
+            });
+        }
+    });
+
+    // 等待队列积压起来
+    while (outstanding.load() < backlog) std::this_thread::yield();
+
+    std::vector<double> latencies;
+    latencies.reserve(probes);
+    for (int i = 0; i < probes; i++)
+    {
+        auto submitted = Clock::now();
+        auto res = pool.submitTask(quietGroup, [submitted]() {
+            return std::chrono::duration<double, std::micro>(Clock::now() - submitted).count();
+        });
+        latencies.push_back(res.get());
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+
+    stop = true;
+    producer.join();
+    while (outstanding.load() > 0) std::this_thread::yield();
+
+    std::sort(latencies.begin(), latencies.end());
+    LatencyResult result;
+    result.p50 = latencies[latencies.size() / 2];
+    result.p99 = latencies[std::min(latencies.size() - 1, latencies.size() * 99 / 100)];
+    result.max = latencies.back();
+    result.noisy = completed.load();
+    if (grouped)
+    {
+        result.quietStats = pool.stats().groups[quietGroup.id];
+    }
+    return result;
+}
+
+int main(int argc, char* argv[])
+{
+    Logger::setLevel(LOG_WARN);
+    int probes = argc > 1 ? std::atoi(argv[1]) : 200;
+    int workUs = argc > 2 ? std::atoi(argv[2]) : 50;
+    int hw = std::thread::hardware_concurrency();
+    int threads = hw > 1 ? hw : 1;
+
+    std::cout << "threads = " << threads << ", noisy task = " << workUs << "us, probes = " << probes << std::endl;
+    std::cout << std::fixed << std::setprecision(1) << std::left;
+    std::cout << std::setw(12) << "mode" << std::setw(10) << "groups"
+              << std::setw(14) << "p50(us)" << std::setw(14) << "p99(us)" << std::setw(14) << "max(us)"
+              << std::setw(12) << "noisy" << "quiet group p99 wait(us)" << std::endl;
+
+    const char* names[] = {"shared", "stealing", "lockfree"};
+    for (int mode = SCHED_SHARED_QUEUE; mode <= SCHED_LOCKFREE_QUEUE; mode++)
+    {
+        for (bool grouped : {false, true})
+        {
+            LatencyResult r = run((SchedMode)mode, threads, grouped, probes, workUs);
+            std::cout << std::setw(12) << names[mode] << std::setw(10) << (grouped ? "yes" : "no")
+                      << std::setw(14) << r.p50 << std::setw(14) << r.p99 << std::setw(14) << r.max << std::setw(12) << r.noisy;
+            if (grouped) std::cout << r.quietStats.queueWait.percentile(99) / 1000.0;
+            else std::cout << "-";
+            std::cout << std::endl;
+        }
+    }
+    return 0;
+}
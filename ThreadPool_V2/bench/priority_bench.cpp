@@ -0,0 +1,113 @@
+#include "threadpool.h"
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+
+// 后台任务持续占满线程池时 探测任务从提交到开始执行的延迟
+// 分别以普通优先级和高优先级提交探测任务 对比p50/p99
+// 用法: ./priority_bench [探测次数] [后台任务耗时us]
+
+using Clock = std::chrono::steady_clock;
+
+static void spinFor(std::chrono::microseconds dur)
+{
+    auto end = Clock::now() + dur;
+    while (Clock::now() < end) {}
+}
+
+struct LatencyResult
+{
+    double p50;
+    double p99;
+    double max;
+    long background;  // 测试期间完成的后台任务数
+};
+
+static LatencyResult run(SchedMode mode, int threads, Priority probePriority, int probes, int workUs)
+{
+    ThreadPool pool;
+    pool.setSchedMode(mode);
+    pool.setTaskQueThreshHold(4096);
+    pool.start(threads);
+
+    // 后台生产者保持backlog个普通优先级任务在队列中排队
+    const int backlog = threads * 64;
+    std::atomic_int outstanding(0);
+    std::atomic_long completed(0);
+    std::atomic_bool stop(false);
+    std::thread producer([&]() {
+        while (!stop.load(std::memory_order_relaxed))
+        {
+            if (outstanding.load(std::memory_order_relaxed) >= backlog)
+            {
+                std::this_thread::yield();
+                continue;
+            }
+            outstanding++;
+            pool.submitTask([&, workUs]() {
+                spinFor(std::chrono::microseconds(workUs));
+                completed++;
+                outstanding--;
+            });
+        }
+    });
+
+    // 等待队列积压起来
+    while (outstanding.load() < backlog) std::this_thread::yield();
+
+    std::vector<double> latencies;
+    latencies.reserve(probes);
+    for (int i = 0; i < probes; i++)
+    {
+        auto submitted = Clock::now();
+        auto res = pool.submitTask(probePriority, [submitted]() {
+            return std::chrono::duration<double, std::micro>(Clock::now() - submitted).count();
+        });
+        latencies.push_back(res.get());
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+
+    stop = true;
+    producer.join();
+    while (outstanding.load() > 0) std::this_thread::yield();
+
+    std::sort(latencies.begin(), latencies.end());
+    LatencyResult result;
+    result.p50 = latencies[latencies.size() / 2];
+    result.p99 = latencies[std::min(latencies.size() - 1, latencies.size() * 99 / 100)];
+    result.max = latencies.back();
+    result.background = completed.load();
+    return result;
+}
+
+int main(int argc, char* argv[])
+{
+    Logger::setLevel(LOG_WARN);
+    int probes = argc > 1 ? std::atoi(argv[1]) : 500;
+    int workUs = argc > 2 ? std::atoi(argv[2]) : 50;
+    int hw = std::thread::hardware_concurrency();
+    int threads = hw > 1 ? hw : 1;
+
+    std::cout << "threads = " << threads << ", background task = " << workUs << "us, probes = " << probes << std::endl;
+    std::cout << std::fixed << std::setprecision(1) << std::left;
+    std::cout << std::setw(12) << "mode" << std::setw(10) << "probe"
+              << std::setw(14) << "p50(us)" << std::setw(14) << "p99(us)" << std::setw(14) << "max(us)" << "background" << std::endl;
+
+    const char* names[] = {"shared", "stealing", "lockfree"};
+    for (int mode = SCHED_SHARED_QUEUE; mode <= SCHED_LOCKFREE_QUEUE; mode++)
+    {
+        Priority priorities[] = {PRIORITY_NORMAL, PRIORITY_HIGH};
+        for (Priority priority : priorities)
+        {
+            LatencyResult r = run((SchedMode)mode, threads, priority, probes, workUs);
+            std::cout << std::setw(12) << names[mode] << std::setw(10) << (priority == PRIORITY_HIGH ? "high" : "normal")
+                      << std::setw(14) << r.p50 << std::setw(14) << r.p99 << std::setw(14) << r.max << r.background << std::endl;
+        }
+    }
+    return 0;
+}
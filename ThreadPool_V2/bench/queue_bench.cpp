@@ -0,0 +1,205 @@
+#include "threadpool.h"
+#include "mpmcqueue.h"
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <vector>
+#include <queue>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <future>
+
+// 对比加锁队列和无锁环形队列的单次入队/出队开销 线程池submitTask的提交开销 逐个提交和批量提交的扇出开销
+// 以及线程每次取一个和批量取出任务时执行微小任务的开销
+// 用法: ./queue_bench [操作次数]
+
+using Clock = std::chrono::steady_clock;
+
+static double nsPerOp(Clock::time_point begin, Clock::time_point end, long ops)
+{
+    return std::chrono::duration<double, std::nano>(end - begin).count() / ops;
+}
+
+// 加锁队列 与原来taskQue_ + taskQueMtx_的结构一致
+class LockedQueue
+{
+    public:
+        bool tryPush(long v)
+        {
+            std::lock_guard<std::mutex> lk(mtx_);
+            que_.push(v);
+            return true;
+        }
+        bool tryPop(long& v)
+        {
+            std::lock_guard<std::mutex> lk(mtx_);
+            if (que_.empty()) return false;
+            v = que_.front();
+            que_.pop();
+            return true;
+        }
+    private:
+        std::mutex mtx_;
+        std::queue<long> que_;
+};
+
+// producers个线程入队 consumers个线程出队 返回每个元素的平均耗时
+template <typename Queue>
+static double runQueue(Queue& que, int producers, int consumers, long ops)
+{
+    std::atomic_long consumed(0);
+    std::vector<std::thread> threads;
+    long perProducer = ops / producers;
+    long total = perProducer * producers;
+
+    auto begin = Clock::now();
+    for (int i = 0; i < producers; i++)
+    {
+        threads.emplace_back([&]() {
+            for (long n = 0; n < perProducer; n++)
+            {
+                while (!que.tryPush(n)) std::this_thread::yield();
+            }
+        });
+    }
+    for (int i = 0; i < consumers; i++)
+    {
+        threads.emplace_back([&]() {
+            long v;
+            while (consumed.load(std::memory_order_relaxed) < total)
+            {
+                if (que.tryPop(v)) consumed.fetch_add(1, std::memory_order_relaxed);
+                else std::this_thread::yield();
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+    return nsPerOp(begin, Clock::now(), total);
+}
+
+// 只统计提交阶段的耗时 队列容量足够大 不会因为队列满而等待
+static double runSubmit(SchedMode mode, int threads, long ops)
+{
+    ThreadPool pool;
+    pool.setSchedMode(mode);
+    pool.setTaskQueThreshHold(ops);
+    pool.start(threads);
+
+    std::vector<std::future<void>> results;
+    results.reserve(ops);
+    auto begin = Clock::now();
+    for (long i = 0; i < ops; i++)
+    {
+        results.emplace_back(pool.submitTask([]() {}));
+    }
+    auto end = Clock::now();
+    for (auto& res : results) res.get();
+    return nsPerOp(begin, end, ops);
+}
+
+// 每轮扇出fanout个任务再全部等待 batch为true时使用submitRange一次提交
+static double runFanOut(SchedMode mode, int threads, long ops, long fanout, bool batch)
+{
+    ThreadPool pool;
+    pool.setSchedMode(mode);
+    pool.setTaskQueThreshHold(fanout);
+    pool.start(threads);
+
+    std::vector<std::future<void>> results;
+    results.reserve(fanout);
+    auto begin = Clock::now();
+    for (long r = 0; r < ops / fanout; r++)
+    {
+        if (batch)
+        {
+            results = pool.submitRange(fanout, [](size_t) {return []() {};});
+        }
+        else
+        {
+            for (long i = 0; i < fanout; i++)
+            {
+                results.emplace_back(pool.submitTask([]() {}));
+            }
+        }
+        for (auto& res : results) res.get();
+        results.clear();
+    }
+    return nsPerOp(begin, Clock::now(), ops / fanout * fanout);
+}
+
+// 提交线程用tryPostRange批量放入空任务 线程每次最多取出batch个 统计全部执行完的平均耗时
+static double runDrain(SchedMode mode, int threads, long ops, int batch)
+{
+    const long chunk = 1000;
+    ThreadPool pool;
+    pool.setSchedMode(mode);
+    pool.setTaskQueThreshHold(16 * chunk);
+    pool.setDequeueBatch(batch);
+    pool.start(threads);
+
+    std::atomic_long done(0);
+    long total = ops / chunk * chunk;
+    auto begin = Clock::now();
+    for (long r = 0; r < total / chunk; r++)
+    {
+        size_t pushed = 0;
+        while (pushed < (size_t)chunk)
+        {
+            size_t n = pool.tryPostRange(chunk - pushed, [&](size_t) {return [&]() {done.fetch_add(1, std::memory_order_relaxed);};});
+            if (n == 0) std::this_thread::yield();
+            pushed += n;
+        }
+    }
+    while (done.load(std::memory_order_relaxed) < total) std::this_thread::yield();
+    return nsPerOp(begin, Clock::now(), total);
+}
+
+int main(int argc, char* argv[])
+{
+    Logger::setLevel(LOG_WARN);
+    long ops = argc > 1 ? std::atol(argv[1]) : 1000000;
+
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << std::left << std::setw(22) << "queue(P x C)" << std::setw(16) << "locked(ns/op)" << "lockfree(ns/op)" << std::endl;
+    int shapes[][2] = {{1, 1}, {2, 2}, {4, 1}, {1, 4}, {4, 4}};
+    for (auto& shape : shapes)
+    {
+        LockedQueue locked;
+        MpmcQueue<long> lockfree(1024);
+        double a = runQueue(locked, shape[0], shape[1], ops);
+        double b = runQueue(lockfree, shape[0], shape[1], ops);
+        std::cout << std::setw(22) << (std::to_string(shape[0]) + " x " + std::to_string(shape[1]))
+                  << std::setw(16) << a << b << std::endl;
+    }
+
+    std::cout << std::endl << std::setw(22) << "submitTask(threads)" << std::setw(16) << "shared(ns/op)" << "lockfree(ns/op)" << std::endl;
+    int hw = std::thread::hardware_concurrency();
+    for (int n = 1; n <= (hw > 1 ? hw : 1); n *= 2)
+    {
+        double a = runSubmit(SCHED_SHARED_QUEUE, n, ops / 4);
+        double b = runSubmit(SCHED_LOCKFREE_QUEUE, n, ops / 4);
+        std::cout << std::setw(22) << n << std::setw(16) << a << b << std::endl;
+    }
+
+    std::cout << std::endl << std::setw(22) << "fan-out 1000(mode)" << std::setw(16) << "single(ns/task)" << "batch(ns/task)" << std::endl;
+    const char* names[] = {"shared", "stealing", "lockfree"};
+    for (int mode = SCHED_SHARED_QUEUE; mode <= SCHED_LOCKFREE_QUEUE; mode++)
+    {
+        int threads = hw > 1 ? hw : 1;
+        double a = runFanOut((SchedMode)mode, threads, ops / 4, 1000, false);
+        double b = runFanOut((SchedMode)mode, threads, ops / 4, 1000, true);
+        std::cout << std::setw(22) << names[mode] << std::setw(16) << a << b << std::endl;
+    }
+
+    std::cout << std::endl << std::setw(22) << "drain(mode)" << std::setw(16) << "single(ns/task)" << "batch 16(ns/task)" << std::endl;
+    for (int mode : {SCHED_SHARED_QUEUE, SCHED_LOCKFREE_QUEUE})
+    {
+        int threads = hw > 1 ? hw : 1;
+        double a = runDrain((SchedMode)mode, threads, ops, 1);
+        double b = runDrain((SchedMode)mode, threads, ops, 16);
+        std::cout << std::setw(22) << names[mode] << std::setw(16) << a << b << std::endl;
+    }
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,105 @@
+#include "threadpool.h"
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <vector>
+#include <atomic>
+#include <future>
+
+// 对比共享队列和工作窃取两种调度模式在不同线程数下的扩展性
+// 用法: ./steal_bench [任务数] [递归深度]
+
+using Clock = std::chrono::steady_clock;
+
+// 外部线程一次性提交大量空任务
+static double runFlat(SchedMode mode, int threads, int tasks)
+{
+    ThreadPool pool;
+    pool.setSchedMode(mode);
+    pool.setTaskQueThreshHold(tasks);
+    pool.start(threads);
+
+    std::vector<std::future<void>> results;
+    results.reserve(tasks);
+    auto begin = Clock::now();
+    for (int i = 0; i < tasks; i++)
+    {
+        results.emplace_back(pool.submitTask([]() {}));
+    }
+    for (auto& res : results)
+    {
+        res.get();
+    }
+    auto end = Clock::now();
+    return std::chrono::duration<double, std::milli>(end - begin).count();
+}
+
+// 任务内部递归提交子任务 模拟分治类负载
+static void forkTask(ThreadPool* pool, int depth, std::atomic_int* leaves, int total, std::promise<void>* done)
+{
+    if (depth == 0)
+    {
+        if (leaves->fetch_add(1) + 1 == total)
+        {
+            done->set_value();
+        }
+        return ;
+    }
+    pool->submitTask(forkTask, pool, depth - 1, leaves, total, done);
+    pool->submitTask(forkTask, pool, depth - 1, leaves, total, done);
+}
+
+static double runNested(SchedMode mode, int threads, int depth)
+{
+    ThreadPool pool;
+    int total = 1 << depth;
+    pool.setSchedMode(mode);
+    pool.setTaskQueThreshHold(total * 2);
+    pool.start(threads);
+
+    std::atomic_int leaves(0);
+    std::promise<void> done;
+    auto begin = Clock::now();
+    pool.submitTask(forkTask, &pool, depth, &leaves, total, &done);
+    done.get_future().wait();
+    auto end = Clock::now();
+    return std::chrono::duration<double, std::milli>(end - begin).count();
+}
+
+int main(int argc, char* argv[])
+{
+    Logger::setLevel(LOG_WARN);
+    int tasks = argc > 1 ? std::atoi(argv[1]) : 200000;
+    int depth = argc > 2 ? std::atoi(argv[2]) : 16;
+
+    int hw = std::thread::hardware_concurrency();
+    std::vector<int> threadCounts;
+    for (int n = 1; n < hw; n *= 2)
+    {
+        threadCounts.push_back(n);
+    }
+    threadCounts.push_back(hw > 0 ? hw : 1);
+
+    std::cout << std::left << std::setw(10) << "scenario" << std::setw(10) << "threads"
+              << std::setw(14) << "shared(ms)" << std::setw(14) << "stealing(ms)" << "speedup" << std::endl;
+    std::cout << std::fixed << std::setprecision(2);
+
+    for (int n : threadCounts)
+    {
+        double shared = runFlat(SCHED_SHARED_QUEUE, n, tasks);
+        double stealing = runFlat(SCHED_WORK_STEALING, n, tasks);
+        std::cout << std::setw(10) << "flat" << std::setw(10) << n << std::setw(14) << shared
+                  << std::setw(14) << stealing << shared / stealing << std::endl;
+    }
+
+    for (int n : threadCounts)
+    {
+        double shared = runNested(SCHED_SHARED_QUEUE, n, depth);
+        double stealing = runNested(SCHED_WORK_STEALING, n, depth);
+        std::cout << std::setw(10) << "nested" << std::setw(10) << n << std::setw(14) << shared
+                  << std::setw(14) << stealing << shared / stealing << std::endl;
+    }
+
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,125 @@
+#include "threadpool.h"
+#include "strand.h"
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <mutex>
+
+// 按实体保证顺序的两种做法: 任务中对实体加互斥锁 / 每个实体一个Strand
+// 统计每个操作的平均耗时、线程池线程阻塞在实体锁上的总时间 以及同一个实体的操作乱序执行的次数
+// 用法: ./strand_bench [操作次数] [每个操作耗时ns] [线程数]
+
+using Clock = std::chrono::steady_clock;
+
+static void spinFor(std::chrono::nanoseconds dur)
+{
+    auto end = Clock::now() + dur;
+    while (Clock::now() < end) {}
+}
+
+struct Entity
+{
+    std::mutex mtx;
+    long next = 0;       // 下一个应该执行的操作序号
+};
+
+struct Result
+{
+    double nsPerOp;
+    double blockedMs;    // 线程池线程等待实体锁的总时间
+    long reordered;      // 同一个实体的操作没有按提交顺序执行的次数
+};
+
+static Result runMutex(int threads, int keys, long ops, std::chrono::nanoseconds work)
+{
+    ThreadPool pool;
+    pool.setTaskQueThreshHold(4096);
+    pool.start(threads);
+
+    std::vector<Entity> entities(keys);
+    std::atomic_long done(0);
+    std::atomic_long blockedNs(0);
+    std::atomic_long reordered(0);
+    auto begin = Clock::now();
+    for (long i = 0; i < ops; i++)
+    {
+        Entity& e = entities[i % keys];
+        long seq = i / keys;
+        pool.post([&, seq]() {
+            if (!e.mtx.try_lock())
+            {
+                auto t = Clock::now();
+                e.mtx.lock();
+                blockedNs += std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - t).count();
+            }
+            if (e.next != seq) reordered++;
+            e.next = seq + 1;
+            spinFor(work);
+            e.mtx.unlock();
+            done++;
+        });
+    }
+    while (done.load() < ops) std::this_thread::yield();
+    double ns = std::chrono::duration<double, std::nano>(Clock::now() - begin).count() / ops;
+    return Result{ns, blockedNs.load() / 1e6, reordered.load()};
+}
+
+static Result runStrand(int threads, int keys, long ops, std::chrono::nanoseconds work)
+{
+    ThreadPool pool;
+    pool.setTaskQueThreshHold(4096);
+    pool.start(threads);
+
+    std::vector<Entity> entities(keys);
+    std::atomic_long done(0);
+    std::vector<long> reorderedPerKey(keys); // 只在对应实体的Strand中访问 不会并发
+    auto begin = Clock::now();
+    {
+        KeyedStrands strands(pool, 1024);
+        for (long i = 0; i < ops; i++)
+        {
+            int key = i % keys;
+            long seq = i / keys;
+            strands.post(key, [&, key, seq]() {
+                Entity& e = entities[key];
+                if (e.next != seq) reorderedPerKey[key]++;
+                e.next = seq + 1;
+                spinFor(work);
+                done++;
+            });
+        }
+        while (done.load() < ops) std::this_thread::yield();
+    }
+    double ns = std::chrono::duration<double, std::nano>(Clock::now() - begin).count() / ops;
+    long reordered = 0;
+    for (long r : reorderedPerKey) reordered += r;
+    return Result{ns, 0, reordered};
+}
+
+int main(int argc, char* argv[])
+{
+    Logger::setLevel(LOG_WARN);
+    long ops = argc > 1 ? std::atol(argv[1]) : 200000;
+    std::chrono::nanoseconds work(argc > 2 ? std::atol(argv[2]) : 1000);
+    int hw = std::thread::hardware_concurrency();
+    int threads = argc > 3 ? std::atoi(argv[3]) : hw > 1 ? hw : 1;
+
+    std::cout << "threads = " << threads << ", ops = " << ops << ", work = " << work.count() << "ns" << std::endl;
+    std::cout << std::fixed << std::setprecision(1) << std::left;
+    std::cout << std::setw(8) << "keys" << std::setw(10) << "method" << std::setw(14) << "ns/op"
+              << std::setw(14) << "blocked(ms)" << "reordered" << std::endl;
+    for (int keys : {1, 4, 64, 1024})
+    {
+        Result m = runMutex(threads, keys, ops, work);
+        Result s = runStrand(threads, keys, ops, work);
+        std::cout << std::setw(8) << keys << std::setw(10) << "mutex" << std::setw(14) << m.nsPerOp
+                  << std::setw(14) << m.blockedMs << m.reordered << std::endl;
+        std::cout << std::setw(8) << keys << std::setw(10) << "strand" << std::setw(14) << s.nsPerOp
+                  << std::setw(14) << s.blockedMs << s.reordered << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,458 @@
+#include "threadpool.h"
+#include "v1_adapter.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <future>
+#include <memory>
+#include <algorithm>
+#include <cstring>
+
+// 线程池综合性能测试 同一场景下对比V1(Task/Result)、V2(packaged_task/future)的三种调度模式和std::async
+// 场景:
+//   empty          空任务吞吐 每批提交WINDOW个空任务再全部等待
+//   latency        线程池空闲时单个任务从提交到开始执行的延迟
+//   fanout         每轮扇出FANOUT个小任务再汇总 统计每轮耗时
+//   nested         每个根任务在线程池线程中再提交NESTED_CHILDREN个子任务
+//   mixed          长任务和短任务混合 统计短任务从提交到完成的延迟
+//   producer_heavy threads个线程同时提交 线程池只有1个线程
+//   consumer_heavy 1个线程提交 线程池有threads个线程
+// 用法: ./threadpool_bench [--threads=1,2,4] [--tasks=20000] [--scenario=empty,latency] [--impl=v1,v2-shared]
+//                          [--json=result.json] [--csv=result.csv]
+
+using Clock = std::chrono::steady_clock;
+
+const int QUE_THRESHHOLD = 4096;   // 所有线程池使用相同的任务队列上限
+const int WINDOW = 1024;           // 每批最多提交的任务数 同时限制std::async同时存在的线程数
+const int FANOUT = 64;
+const int NESTED_CHILDREN = 15;
+const int MIXED_LONG_EVERY = 20;   // 每20个任务中有1个长任务
+const auto MIXED_LONG_WORK = std::chrono::microseconds(500);
+const auto MIXED_SHORT_WORK = std::chrono::microseconds(2);
+const auto SMALL_WORK = std::chrono::microseconds(1);
+
+static void spinFor(std::chrono::nanoseconds dur)
+{
+    auto end = Clock::now() + dur;
+    while (Clock::now() < end) {}
+}
+
+static double usSince(Clock::time_point begin, Clock::time_point end)
+{
+    return std::chrono::duration<double, std::micro>(end - begin).count();
+}
+
+// --------------------被测实现的统一封装-------------------------------
+
+class V1Runner
+{
+    public:
+        using Handle = V1Pool::Handle;
+        explicit V1Runner(int threads) : pool_(threads, QUE_THRESHHOLD) {}
+        template <typename F>
+        Handle submit(F&& func) { return pool_.submit(std::forward<F>(func)); }
+        static void wait(Handle& handle) { handle.wait(); }
+    private:
+        V1Pool pool_;
+};
+
+class V2Runner
+{
+    public:
+        using Handle = std::future<void>;
+        V2Runner(int threads, SchedMode mode)
+        {
+            pool_.setSchedMode(mode);
+            pool_.setTaskQueThreshHold(QUE_THRESHHOLD);
+            pool_.start(threads);
+        }
+        template <typename F>
+        Handle submit(F&& func) { return pool_.submitTask(std::forward<F>(func)); }
+        static void wait(Handle& handle) { handle.get(); }
+    private:
+        ThreadPool pool_;
+};
+
+// 每个任务一个线程 作为没有线程池时的基准
+class AsyncRunner
+{
+    public:
+        using Handle = std::future<void>;
+        explicit AsyncRunner(int) {}
+        template <typename F>
+        Handle submit(F&& func) { return std::async(std::launch::async, std::forward<F>(func)); }
+        static void wait(Handle& handle) { handle.get(); }
+};
+
+template <typename Runner>
+static void waitAll(std::vector<typename Runner::Handle>& handles)
+{
+    for (auto& handle : handles) Runner::wait(handle);
+    handles.clear();
+}
+
+// --------------------测试场景-------------------------------
+
+struct Record
+{
+    std::string scenario;
+    std::string impl;
+    int threads = 0;
+    long tasks = 0;
+    double elapsedMs = 0;
+    double throughput = 0;  // 任务数/秒
+    double p50Us = 0;       // 场景相关的延迟 没有时为0
+    double p99Us = 0;
+};
+
+static void setLatency(Record& record, std::vector<double>& samples)
+{
+    if (samples.empty()) return;
+    std::sort(samples.begin(), samples.end());
+    record.p50Us = samples[samples.size() / 2];
+    record.p99Us = samples[std::min(samples.size() - 1, samples.size() * 99 / 100)];
+}
+
+static void setElapsed(Record& record, long tasks, Clock::time_point begin, Clock::time_point end)
+{
+    record.tasks = tasks;
+    record.elapsedMs = usSince(begin, end) / 1000;
+    record.throughput = tasks / (record.elapsedMs / 1000);
+}
+
+template <typename Make>
+static Record runEmpty(Make& make, int threads, long tasks)
+{
+    auto runner = make(threads);
+    using Runner = typename decltype(runner)::element_type;
+    std::vector<typename Runner::Handle> handles;
+    handles.reserve(WINDOW);
+
+    Record record;
+    auto begin = Clock::now();
+    for (long done = 0; done < tasks; )
+    {
+        for (int i = 0; i < WINDOW && done < tasks; i++, done++)
+        {
+            handles.emplace_back(runner->submit([]() {}));
+        }
+        waitAll<Runner>(handles);
+    }
+    setElapsed(record, tasks, begin, Clock::now());
+    return record;
+}
+
+template <typename Make>
+static Record runLatency(Make& make, int threads, long tasks)
+{
+    auto runner = make(threads);
+    using Runner = typename decltype(runner)::element_type;
+    long samples = std::max(100L, tasks / 20);
+    std::vector<double> latencies;
+    latencies.reserve(samples);
+
+    Record record;
+    auto begin = Clock::now();
+    for (long i = 0; i < samples; i++)
+    {
+        Clock::time_point started;
+        auto submitted = Clock::now();
+        auto handle = runner->submit([&started]() {started = Clock::now();});
+        Runner::wait(handle);
+        latencies.push_back(usSince(submitted, started));
+        // 让线程池回到空闲状态 测量的是唤醒空闲线程的延迟
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    setElapsed(record, samples, begin, Clock::now());
+    setLatency(record, latencies);
+    return record;
+}
+
+template <typename Make>
+static Record runFanOut(Make& make, int threads, long tasks)
+{
+    auto runner = make(threads);
+    using Runner = typename decltype(runner)::element_type;
+    long rounds = std::max(1L, tasks / FANOUT);
+    std::vector<typename Runner::Handle> handles;
+    handles.reserve(FANOUT);
+    std::vector<long> partial(FANOUT);
+    std::vector<double> roundUs;
+    roundUs.reserve(rounds);
+
+    Record record;
+    long checksum = 0;
+    auto begin = Clock::now();
+    for (long r = 0; r < rounds; r++)
+    {
+        auto roundBegin = Clock::now();
+        for (int i = 0; i < FANOUT; i++)
+        {
+            handles.emplace_back(runner->submit([&partial, i, r]() {
+                spinFor(SMALL_WORK);
+                partial[i] = r + i;
+            }));
+        }
+        waitAll<Runner>(handles);
+        for (long v : partial) checksum += v;
+        roundUs.push_back(usSince(roundBegin, Clock::now()));
+    }
+    setElapsed(record, rounds * FANOUT, begin, Clock::now());
+    setLatency(record, roundUs);
+    if (checksum < 0) std::cerr << checksum;
+    return record;
+}
+
+template <typename Make>
+static Record runNested(Make& make, int threads, long tasks)
+{
+    auto runner = make(threads);
+    using Runner = typename decltype(runner)::element_type;
+    using Handle = typename Runner::Handle;
+    // 每批的根任务数 子任务总数不超过WINDOW
+    const long batchRoots = WINDOW / (NESTED_CHILDREN + 1);
+    long roots = std::max(1L, tasks / (NESTED_CHILDREN + 1));
+    std::vector<Handle> rootHandles;
+    std::vector<Handle> childHandles(batchRoots * NESTED_CHILDREN);
+    std::atomic_long executed(0);
+
+    Record record;
+    auto begin = Clock::now();
+    for (long base = 0; base < roots; base += batchRoots)
+    {
+        long n = std::min(batchRoots, roots - base);
+        for (long i = 0; i < n; i++)
+        {
+            Runner* pool = runner.get();
+            rootHandles.emplace_back(runner->submit([pool, i, &childHandles, &executed]() {
+                for (int k = 0; k < NESTED_CHILDREN; k++)
+                {
+                    childHandles[i * NESTED_CHILDREN + k] = pool->submit([&executed]() {
+                        executed.fetch_add(1, std::memory_order_relaxed);
+                    });
+                }
+            }));
+        }
+        // 根任务完成后子任务的句柄都已经写入
+        waitAll<Runner>(rootHandles);
+        for (long i = 0; i < n * NESTED_CHILDREN; i++)
+        {
+            Runner::wait(childHandles[i]);
+        }
+    }
+    setElapsed(record, roots * (NESTED_CHILDREN + 1), begin, Clock::now());
+    if (executed != roots * NESTED_CHILDREN) std::cerr << "nested: lost child tasks" << std::endl;
+    return record;
+}
+
+template <typename Make>
+static Record runMixed(Make& make, int threads, long tasks)
+{
+    auto runner = make(threads);
+    using Runner = typename decltype(runner)::element_type;
+    long count = std::max<long>(MIXED_LONG_EVERY, std::min<long>(WINDOW, tasks / 10));
+    std::vector<typename Runner::Handle> handles;
+    handles.reserve(count);
+    std::vector<Clock::time_point> submitted(count), finished(count);
+
+    Record record;
+    auto begin = Clock::now();
+    for (long i = 0; i < count; i++)
+    {
+        bool isLong = i % MIXED_LONG_EVERY == 0;
+        submitted[i] = Clock::now();
+        handles.emplace_back(runner->submit([&finished, i, isLong]() {
+            spinFor(isLong ? MIXED_LONG_WORK : MIXED_SHORT_WORK);
+            finished[i] = Clock::now();
+        }));
+    }
+    waitAll<Runner>(handles);
+    setElapsed(record, count, begin, Clock::now());
+
+    std::vector<double> shortUs;
+    for (long i = 0; i < count; i++)
+    {
+        if (i % MIXED_LONG_EVERY != 0) shortUs.push_back(usSince(submitted[i], finished[i]));
+    }
+    setLatency(record, shortUs);
+    return record;
+}
+
+// producers个线程各自提交tasks/producers个空任务 线程池有workers个线程
+template <typename Make>
+static Record runProducers(Make& make, int producers, int workers, long tasks)
+{
+    auto runner = make(workers);
+    using Runner = typename decltype(runner)::element_type;
+    long perProducer = std::max(1L, tasks / producers);
+
+    Record record;
+    std::vector<std::thread> threads;
+    auto begin = Clock::now();
+    for (int p = 0; p < producers; p++)
+    {
+        threads.emplace_back([&]() {
+            std::vector<typename Runner::Handle> handles;
+            handles.reserve(WINDOW / producers + 1);
+            for (long done = 0; done < perProducer; )
+            {
+                for (long i = 0; i < WINDOW / producers + 1 && done < perProducer; i++, done++)
+                {
+                    handles.emplace_back(runner->submit([]() {}));
+                }
+                waitAll<Runner>(handles);
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+    setElapsed(record, perProducer * producers, begin, Clock::now());
+    return record;
+}
+
+// --------------------参数和输出-------------------------------
+
+struct Options
+{
+    std::vector<int> threads;
+    long tasks = 20000;
+    std::vector<std::string> scenarios;
+    std::vector<std::string> impls;
+    std::string json;
+    std::string csv;
+
+    bool selected(const std::vector<std::string>& list, const std::string& name) const
+    {
+        return list.empty() || std::find(list.begin(), list.end(), name) != list.end();
+    }
+};
+
+static std::vector<std::string> split(const std::string& str)
+{
+    std::vector<std::string> items;
+    std::stringstream ss(str);
+    std::string item;
+    while (std::getline(ss, item, ','))
+    {
+        if (!item.empty()) items.push_back(item);
+    }
+    return items;
+}
+
+static bool parseArgs(int argc, char* argv[], Options& opt)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        auto value = [&](const char* key) -> const char* {
+            size_t len = std::strlen(key);
+            return arg.compare(0, len, key) == 0 ? arg.c_str() + len : nullptr;
+        };
+        if (const char* v = value("--threads="))
+        {
+            for (auto& n : split(v)) opt.threads.push_back(std::max(1, std::atoi(n.c_str())));
+        }
+        else if (const char* v = value("--tasks=")) opt.tasks = std::max(1L, std::atol(v));
+        else if (const char* v = value("--scenario=")) opt.scenarios = split(v);
+        else if (const char* v = value("--impl=")) opt.impls = split(v);
+        else if (const char* v = value("--json=")) opt.json = v;
+        else if (const char* v = value("--csv=")) opt.csv = v;
+        else
+        {
+            std::cerr << "usage: " << argv[0] << " [--threads=1,2,4] [--tasks=N] [--scenario=a,b] [--impl=a,b]"
+                      << " [--json=file] [--csv=file]" << std::endl;
+            return false;
+        }
+    }
+    if (opt.threads.empty())
+    {
+        int hw = std::max(4u, std::thread::hardware_concurrency());
+        for (int n = 1; n <= hw; n *= 2) opt.threads.push_back(n);
+    }
+    return true;
+}
+
+static void printRecord(const Record& r)
+{
+    std::cout << std::left << std::setw(16) << r.scenario << std::setw(14) << r.impl << std::setw(9) << r.threads
+              << std::right << std::setw(10) << r.tasks << std::setw(12) << r.elapsedMs
+              << std::setw(14) << (long)r.throughput << std::setw(12) << r.p50Us << std::setw(12) << r.p99Us << std::endl;
+}
+
+static void writeCsv(const std::string& path, const std::vector<Record>& records)
+{
+    std::ofstream out(path);
+    out << "scenario,impl,threads,tasks,elapsed_ms,throughput,p50_us,p99_us\n";
+    for (auto& r : records)
+    {
+        out << r.scenario << ',' << r.impl << ',' << r.threads << ',' << r.tasks << ',' << r.elapsedMs << ','
+            << r.throughput << ',' << r.p50Us << ',' << r.p99Us << '\n';
+    }
+}
+
+static void writeJson(const std::string& path, const std::vector<Record>& records)
+{
+    std::ofstream out(path);
+    out << "[\n";
+    for (size_t i = 0; i < records.size(); i++)
+    {
+        auto& r = records[i];
+        out << "  {\"scenario\": \"" << r.scenario << "\", \"impl\": \"" << r.impl << "\", \"threads\": " << r.threads
+            << ", \"tasks\": " << r.tasks << ", \"elapsed_ms\": " << r.elapsedMs << ", \"throughput\": " << r.throughput
+            << ", \"p50_us\": " << r.p50Us << ", \"p99_us\": " << r.p99Us << "}" << (i + 1 < records.size() ? "," : "") << "\n";
+    }
+    out << "]\n";
+}
+
+template <typename Make>
+static void runImpl(const std::string& impl, Make make, const Options& opt, std::vector<Record>& records)
+{
+    if (!opt.selected(opt.impls, impl)) return;
+
+    auto add = [&](const char* scenario, int threads, Record record) {
+        record.scenario = scenario;
+        record.impl = impl;
+        record.threads = threads;
+        printRecord(record);
+        records.push_back(record);
+    };
+    for (int threads : opt.threads)
+    {
+        if (opt.selected(opt.scenarios, "empty")) add("empty", threads, runEmpty(make, threads, opt.tasks));
+        if (opt.selected(opt.scenarios, "latency")) add("latency", threads, runLatency(make, threads, opt.tasks));
+        if (opt.selected(opt.scenarios, "fanout")) add("fanout", threads, runFanOut(make, threads, opt.tasks));
+        if (opt.selected(opt.scenarios, "nested")) add("nested", threads, runNested(make, threads, opt.tasks));
+        if (opt.selected(opt.scenarios, "mixed")) add("mixed", threads, runMixed(make, threads, opt.tasks));
+        if (opt.selected(opt.scenarios, "producer_heavy")) add("producer_heavy", threads, runProducers(make, threads, 1, opt.tasks));
+        if (opt.selected(opt.scenarios, "consumer_heavy")) add("consumer_heavy", threads, runProducers(make, 1, threads, opt.tasks));
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    Logger::setLevel(LOG_WARN);
+    Options opt;
+    if (!parseArgs(argc, argv, opt)) return 1;
+
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << std::left << std::setw(16) << "scenario" << std::setw(14) << "impl" << std::setw(9) << "threads"
+              << std::right << std::setw(10) << "tasks" << std::setw(12) << "ms" << std::setw(14) << "tasks/s"
+              << std::setw(12) << "p50(us)" << std::setw(12) << "p99(us)" << std::endl;
+
+    std::vector<Record> records;
+    runImpl("v1", [](int n) {return std::make_unique<V1Runner>(n);}, opt, records);
+    runImpl("v2-shared", [](int n) {return std::make_unique<V2Runner>(n, SCHED_SHARED_QUEUE);}, opt, records);
+    runImpl("v2-stealing", [](int n) {return std::make_unique<V2Runner>(n, SCHED_WORK_STEALING);}, opt, records);
+    runImpl("v2-lockfree", [](int n) {return std::make_unique<V2Runner>(n, SCHED_LOCKFREE_QUEUE);}, opt, records);
+    runImpl("std::async", [](int n) {return std::make_unique<AsyncRunner>(n);}, opt, records);
+
+    if (!opt.json.empty()) writeJson(opt.json, records);
+    if (!opt.csv.empty()) writeCsv(opt.csv, records);
+    return 0;
+}
@@ -0,0 +1,66 @@
+#include "threadpool.h"
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <thread>
+#include <atomic>
+
+// 追踪对短任务吞吐的影响: 同一批空任务分别在关闭和开启追踪时执行 比较每个任务的平均耗时
+// 库需要用-DTHREADPOOL_TRACING=ON编译 否则两列结果相同 每个线程的缓冲区只有RING_SIZE条记录 任务数不宜太多
+// 用法: ./trace_bench [任务数] [输出文件]
+
+using Clock = std::chrono::steady_clock;
+
+const int ROUNDS = 5; // 每种设置重复的次数 取最快的一次
+
+static double run(SchedMode mode, int threads, long tasks)
+{
+    ThreadPool pool;
+    pool.setSchedMode(mode);
+    pool.setTaskQueThreshHold(4096);
+    pool.start(threads);
+
+    std::atomic_long done(0);
+    auto begin = Clock::now();
+    for (long i = 0; i < tasks; i++)
+    {
+        pool.post([&]() {done.fetch_add(1, std::memory_order_relaxed);});
+    }
+    while (done.load() < tasks) std::this_thread::yield();
+    return std::chrono::duration<double, std::nano>(Clock::now() - begin).count() / tasks;
+}
+
+int main(int argc, char* argv[])
+{
+    long tasks = argc > 1 ? std::atol(argv[1]) : 4000;
+    const char* path = argc > 2 ? argv[2] : "trace.json";
+    int hw = std::thread::hardware_concurrency();
+    int threads = hw > 1 ? hw : 1;
+    Logger::setLevel(LOG_WARN);
+
+    std::cout << "threads = " << threads << ", tasks = " << tasks << std::endl;
+    std::cout << std::fixed << std::setprecision(1) << std::left;
+    std::cout << std::setw(12) << "mode" << std::setw(14) << "off(ns/task)" << std::setw(14) << "on(ns/task)" << "dropped" << std::endl;
+
+    const char* names[] = {"shared", "stealing", "lockfree"};
+    for (int mode = SCHED_SHARED_QUEUE; mode <= SCHED_LOCKFREE_QUEUE; mode++)
+    {
+        double off = 0;
+        double on = 0;
+        for (int i = 0; i < ROUNDS; i++)
+        {
+            double t = run((SchedMode)mode, threads, tasks);
+            if (i == 0 || t < off) off = t;
+            Tracer::enable(true);
+            t = run((SchedMode)mode, threads, tasks);
+            Tracer::enable(false);
+            if (i == 0 || t < on) on = t;
+            // 每轮之后取走记录 避免缓冲区满
+            Tracer::writeChromeTrace(mode == SCHED_SHARED_QUEUE && i == ROUNDS - 1 ? path : "/dev/null");
+        }
+        std::cout << std::setw(12) << names[mode] << std::setw(14) << off << std::setw(14) << on << Tracer::droppedCount() << std::endl;
+    }
+    std::cout << "trace written to " << path << std::endl;
+    return 0;
+}
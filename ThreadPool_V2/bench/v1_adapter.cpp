@@ -0,0 +1,54 @@
+// V1的源码作为单独的目标(threadpool_v1)编译 和本文件一样定义THREADPOOL_V1_NAMESPACE=v1
+#include "../../ThreadPool_V1/include/threadpool.h"
+#include "v1_adapter.h"
+
+namespace
+{
+class FuncTask : public v1::Task
+{
+    public:
+        explicit FuncTask(std::function<void()> func) : func_(std::move(func)) {}
+        v1::Any run() override
+        {
+            func_();
+            return 0;
+        }
+    private:
+        std::function<void()> func_;
+};
+}
+
+V1Pool::Handle::Handle() = default;
+V1Pool::Handle::Handle(Handle&&) noexcept = default;
+V1Pool::Handle& V1Pool::Handle::operator=(Handle&&) noexcept = default;
+V1Pool::Handle::~Handle() = default;
+
+void V1Pool::Handle::wait()
+{
+    if (result_ != nullptr && result_->isValid())
+    {
+        result_->get();
+    }
+}
+
+V1Pool::V1Pool(int threads, int queThreshHold, int maxThreads) : pool_(new v1::ThreadPool())
+{
+    // 和各bench对V2日志的设置一致 线程创建和退出的日志不混进结果表格
+    v1::Logger::setLevel(v1::LOG_WARN);
+    pool_->setTaskQueThreshHold(queThreshHold);
+    if (maxThreads > 0)
+    {
+        pool_->setMode(v1::MODE_CACHED);
+        pool_->setCachedModeThreadSizeLimit(maxThreads);
+    }
+    pool_->start(threads);
+}
+
+V1Pool::~V1Pool() = default;
+
+V1Pool::Handle V1Pool::submit(std::function<void()> func)
+{
+    Handle handle;
+    handle.result_.reset(new v1::Result(pool_->submitTask(std::make_shared<FuncTask>(std::move(func)))));
+    return handle;
+}
@@ -0,0 +1,43 @@
+#ifndef V1_ADAPTER_H__
+#define V1_ADAPTER_H__
+
+#include <functional>
+#include <memory>
+
+// ThreadPool_V1的最小封装 供threadpool_bench和V2放在一起对比
+// V1和V2的类名相同 V1和本封装编译时定义THREADPOOL_V1_NAMESPACE=v1 V1的类型都在命名空间v1中
+namespace v1
+{
+class ThreadPool;
+class Result;
+}
+
+class V1Pool
+{
+    public:
+        // 等待一个任务完成 对应V1的Result
+        class Handle
+        {
+            public:
+                Handle();
+                Handle(Handle&&) noexcept;
+                Handle& operator=(Handle&&) noexcept;
+                ~Handle();
+                void wait();
+            private:
+                friend class V1Pool;
+                std::unique_ptr<v1::Result> result_;
+        };
+
+        // maxThreads大于0时使用cached模式 线程数上限为maxThreads
+        explicit V1Pool(int threads, int queThreshHold, int maxThreads = 0);
+        ~V1Pool();
+
+        // 把func包装成Task子类提交
+        Handle submit(std::function<void()> func);
+
+    private:
+        std::unique_ptr<v1::ThreadPool> pool_;
+};
+
+#endif
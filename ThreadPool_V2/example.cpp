@@ -1,4 +1,5 @@
 #include "./include/threadpool.h"
+#include "./include/parallel.h"
 
 #include <iostream>
 #include <chrono>
@@ -18,6 +19,16 @@ int sum(int begin, int end)
 
 int main()
 {
+    {
+        // 数据并行: 不用再手动拆分区间 调用线程也参与计算
+        ThreadPool threadPool;
+        threadPool.start(4);
+        long long total = parallelReduce(threadPool, 1, 100001, 0LL,
+            [](int i) {return (long long)i;},
+            [](long long a, long long b) {return a + b;});
+        std::cout << "parallelReduce: " << total << std::endl;
+    }
+
     {
         ThreadPool threadPool;
         threadPool.setMode(MODE_CACHED);
@@ -0,0 +1,91 @@
+#ifndef CANCELLATION_H__
+#define CANCELLATION_H__
+
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+
+// 协作式取消
+// CancellationSource由发起请求的一方持有 token随任务一起提交(见TaskOptions)
+// 提交时和线程池线程取出任务时各检查一次 已经取消的任务不会执行 future中保存TaskCancelledError
+// 正在执行的任务通过token.isCancelled()或CancellationToken::current()自行检查 检查只是一次原子读
+//   CancellationSource source;
+//   auto f = pool.submitTask(TaskOptions{PRIORITY_NORMAL, source.token()}, work);
+//   source.cancel(); // 客户端超时
+class TaskCancelledError : public std::runtime_error
+{
+    public:
+        explicit TaskCancelledError(const char* what = "task cancelled") : std::runtime_error(what) {}
+};
+
+namespace detail
+{
+struct CancelState
+{
+    std::atomic_bool cancelled{false};
+};
+}
+
+// 默认构造的token永远不会被取消
+class CancellationToken
+{
+    public:
+        CancellationToken() = default;
+
+        bool isCancelled() const
+        {
+            return state_ != nullptr && state_->cancelled.load(std::memory_order_acquire);
+        }
+
+        void throwIfCancelled() const
+        {
+            if (isCancelled()) throw TaskCancelledError();
+        }
+
+        // 是否可能被取消 默认构造的token返回false
+        bool cancellable() const { return state_ != nullptr; }
+
+        // 当前线程正在执行的任务提交时带的token 不在任务中或者任务没有token时返回默认构造的token
+        static const CancellationToken& current()
+        {
+            static const CancellationToken none;
+            return current_ != nullptr ? *current_ : none;
+        }
+
+        // 执行任务期间设置current() 嵌套执行(例如提交线程上直接执行)时恢复外层的token
+        class Scope
+        {
+            public:
+                explicit Scope(const CancellationToken& token) : prev_(current_) { current_ = &token; }
+                ~Scope() { current_ = prev_; }
+                Scope(const Scope&) = delete;
+                Scope& operator=(const Scope&) = delete;
+            private:
+                const CancellationToken* prev_;
+        };
+
+    private:
+        friend class CancellationSource;
+        explicit CancellationToken(std::shared_ptr<detail::CancelState> state) : state_(std::move(state)) {}
+
+        std::shared_ptr<detail::CancelState> state_;
+        static inline thread_local const CancellationToken* current_ = nullptr;
+};
+
+class CancellationSource
+{
+    public:
+        CancellationSource() : state_(std::make_shared<detail::CancelState>()) {}
+
+        CancellationToken token() const { return CancellationToken(state_); }
+
+        // 取消所有持有token的任务 可以重复调用
+        void cancel() { state_->cancelled.store(true, std::memory_order_release); }
+
+        bool isCancelled() const { return state_->cancelled.load(std::memory_order_acquire); }
+
+    private:
+        std::shared_ptr<detail::CancelState> state_;
+};
+
+#endif
@@ -0,0 +1,243 @@
+#ifndef CORO_H__
+#define CORO_H__
+
+#include "threadpool.h"
+#include "poolfuture.h"
+
+// C++20协程支持 用C++17编译时本文件为空
+// 用法:
+//   CoTask<int> handler(ThreadPool& pool)
+//   {
+//       co_await pool.schedule();          // 切换到线程池线程
+//       int v = co_await submitAsync(pool, compute);  // 等待PoolFuture不占用线程
+//       co_return v + 1;
+//   }
+//   int r = syncWait(handler(pool));
+// CoTask是惰性的 被co_await或syncWait时才开始执行 完成后通过对称转移直接恢复等待它的协程
+#ifdef THREADPOOL_HAS_COROUTINES
+
+#include <coroutine>
+#include <optional>
+#include <exception>
+#include <future>
+#include <utility>
+
+template <typename T = void>
+class CoTask;
+
+namespace detail
+{
+
+class CoPromiseBase
+{
+    public:
+        // 协程结束时恢复等待它的协程 没有等待者时挂起 由CoTask析构销毁
+        struct FinalAwaiter
+        {
+            bool await_ready() const noexcept { return false; }
+            template <typename Promise>
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept
+            {
+                std::coroutine_handle<> continuation = handle.promise().continuation_;
+                return continuation ? continuation : std::noop_coroutine();
+            }
+            void await_resume() const noexcept {}
+        };
+
+        std::suspend_always initial_suspend() const noexcept { return {}; }
+        FinalAwaiter final_suspend() const noexcept { return {}; }
+        void unhandled_exception() { exception_ = std::current_exception(); }
+
+        void setContinuation(std::coroutine_handle<> continuation) { continuation_ = continuation; }
+
+    protected:
+        std::coroutine_handle<> continuation_;
+        std::exception_ptr exception_;
+};
+
+template <typename T>
+class CoPromise : public CoPromiseBase
+{
+    public:
+        CoTask<T> get_return_object();
+
+        template <typename V>
+        void return_value(V&& value) { value_.emplace(std::forward<V>(value)); }
+
+        T result()
+        {
+            if (exception_) std::rethrow_exception(exception_);
+            return std::move(*value_);
+        }
+
+    private:
+        std::optional<T> value_;
+};
+
+template <>
+class CoPromise<void> : public CoPromiseBase
+{
+    public:
+        CoTask<void> get_return_object();
+
+        void return_void() {}
+
+        void result()
+        {
+            if (exception_) std::rethrow_exception(exception_);
+        }
+};
+
+}
+
+// 惰性协程任务 只能移动 被co_await一次
+template <typename T>
+class CoTask
+{
+    public:
+        using promise_type = detail::CoPromise<T>;
+        using Handle = std::coroutine_handle<promise_type>;
+
+        CoTask() = default;
+        explicit CoTask(Handle handle) : handle_(handle) {}
+        CoTask(CoTask&& other) noexcept : handle_(std::exchange(other.handle_, nullptr)) {}
+        CoTask& operator=(CoTask&& other) noexcept
+        {
+            if (this != &other)
+            {
+                if (handle_) handle_.destroy();
+                handle_ = std::exchange(other.handle_, nullptr);
+            }
+            return *this;
+        }
+        ~CoTask()
+        {
+            if (handle_) handle_.destroy();
+        }
+
+        bool valid() const { return static_cast<bool>(handle_); }
+
+        class Awaiter
+        {
+            public:
+                explicit Awaiter(Handle handle) : handle_(handle) {}
+                // 空的(默认构造或已经移走的)CoTask不挂起 在await_resume中抛出异常
+                bool await_ready() const noexcept { return !handle_ || handle_.done(); }
+                // 记录等待者后直接转移到被等待的协程 不经过任务队列
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+                {
+                    handle_.promise().setContinuation(awaiting);
+                    return handle_;
+                }
+                T await_resume()
+                {
+                    if (!handle_) throw std::future_error(std::future_errc::no_state);
+                    return handle_.promise().result();
+                }
+            private:
+                Handle handle_;
+        };
+
+        Awaiter operator co_await() && { return Awaiter(handle_); }
+
+    private:
+        Handle handle_;
+};
+
+namespace detail
+{
+
+template <typename T>
+CoTask<T> CoPromise<T>::get_return_object()
+{
+    return CoTask<T>(std::coroutine_handle<CoPromise<T>>::from_promise(*this));
+}
+
+inline CoTask<void> CoPromise<void>::get_return_object()
+{
+    return CoTask<void>(std::coroutine_handle<CoPromise<void>>::from_promise(*this));
+}
+
+// 立即开始执行、结束时自动销毁的协程 只用于syncWait
+struct DetachedCoroutine
+{
+    struct promise_type
+    {
+        DetachedCoroutine get_return_object() { return {}; }
+        std::suspend_never initial_suspend() const noexcept { return {}; }
+        std::suspend_never final_suspend() const noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+
+template <typename T>
+DetachedCoroutine runInto(CoTask<T> task, std::shared_ptr<FutureState<T>> state)
+{
+    try
+    {
+        if constexpr (std::is_void<T>::value)
+        {
+            co_await std::move(task);
+            state->setValue();
+        }
+        else
+        {
+            state->setValue(co_await std::move(task));
+        }
+    }
+    catch (...)
+    {
+        state->setException(std::current_exception());
+    }
+}
+
+}
+
+// 在当前线程启动task并阻塞等待结果 task中co_await pool.schedule()之后的部分在线程池上执行
+template <typename T>
+T syncWait(CoTask<T> task)
+{
+    auto state = detail::makeState<T>();
+    detail::runInto(std::move(task), state);
+    state->wait();
+    return state->take();
+}
+
+// 把CoTask转换为PoolFuture 立即在当前线程开始执行 pool为then注册的续延所在的线程池
+template <typename T>
+PoolFuture<T> toFuture(CoTask<T> task, ThreadPool* pool = nullptr)
+{
+    auto state = detail::makeState<T>();
+    detail::runInto(std::move(task), state);
+    return detail::FutureAccess::make(std::move(state), pool);
+}
+
+// co_await PoolFuture 结果就绪时在完成它的线程上恢复协程 等待期间不占用线程
+template <typename T>
+class PoolFutureAwaiter
+{
+    public:
+        explicit PoolFutureAwaiter(PoolFuture<T>&& future) : state_(detail::FutureAccess::release(future)) {}
+        bool await_ready() const noexcept { return state_->ready(); }
+        // 注册续延后结果可能被其他线程写入并立即恢复协程 之后不能再访问本对象
+        // 注册前结果已经就绪时返回false 协程不挂起直接继续 不在await_suspend中嵌套恢复
+        bool await_suspend(std::coroutine_handle<> handle)
+        {
+            detail::FutureState<T>* state = state_.get();
+            return state->trySetCallback([handle]() {handle.resume();});
+        }
+        T await_resume() { return state_->take(); }
+    private:
+        std::shared_ptr<detail::FutureState<T>> state_;
+};
+
+template <typename T>
+PoolFutureAwaiter<T> operator co_await(PoolFuture<T>&& future)
+{
+    return PoolFutureAwaiter<T>(std::move(future));
+}
+
+#endif
+
+#endif
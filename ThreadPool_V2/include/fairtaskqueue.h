@@ -0,0 +1,120 @@
+#ifndef FAIRTASKQUEUE_H__
+#define FAIRTASKQUEUE_H__
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "ringqueue.h"
+
+// 非线程安全的多组公平队列 由调用者加锁保护
+// 按权重做差额轮转(DRR): 每个组轮到时获得weight个任务的额度 额度用完或者队列空了之后轮到下一个组
+// 有任务的组按轮转顺序放在active_中 出队时间复杂度O(1)
+// 每个组有自己的队列上限 一个组积压的任务不会占用其他组的位置
+template <typename T>
+class FairTaskQueue
+{
+    public:
+        FairTaskQueue() : size_(0) {}
+
+        // 添加一个组 返回组号 weight不小于1
+        int addGroup(int weight, size_t capacity)
+        {
+            groups_.emplace_back(new Group(weight > 0 ? weight : 1, capacity > 0 ? capacity : 1));
+            return groups_.size() - 1;
+        }
+
+        size_t groupCount() const { return groups_.size(); }
+
+        bool full(int group) const { return groups_[group]->que.size() >= groups_[group]->capacity; }
+
+        // 调用者需要先检查full
+        void push(int group, T&& item)
+        {
+            Group& g = *groups_[group];
+            g.que.emplace(std::move(item));
+            if (!g.scheduled)
+            {
+                g.scheduled = true;
+                active_.emplace(group);
+            }
+            size_++;
+        }
+
+        // 取出下一个任务 队列为空时返回false
+        bool pop(T& item)
+        {
+            while (!active_.empty())
+            {
+                int index = active_.front();
+                Group& g = *groups_[index];
+                if (g.que.empty())
+                {
+                    // popOldest取空的组 轮到时再移出轮转
+                    retire(g);
+                    continue;
+                }
+
+                // 新的一轮 获得weight个任务的额度
+                if (g.deficit <= 0) g.deficit = g.weight;
+                item = std::move(g.que.front());
+                g.que.pop();
+                g.deficit--;
+                size_--;
+
+                if (g.que.empty())
+                {
+                    retire(g);
+                }
+                else if (g.deficit == 0)
+                {
+                    active_.pop();
+                    active_.emplace(index);
+                }
+                return true;
+            }
+            return false;
+        }
+
+        // 取出组中最早入队的任务 用于丢弃旧任务
+        bool popOldest(int group, T& item)
+        {
+            Group& g = *groups_[group];
+            if (g.que.empty()) return false;
+            item = std::move(g.que.front());
+            g.que.pop();
+            size_--;
+            return true;
+        }
+
+        size_t size() const { return size_; }
+        size_t size(int group) const { return groups_[group]->que.size(); }
+        size_t capacity(int group) const { return groups_[group]->capacity; }
+        int weight(int group) const { return groups_[group]->weight; }
+        bool empty() const { return size_ == 0; }
+
+    private:
+        struct Group
+        {
+            Group(int w, size_t cap) : weight(w), capacity(cap), deficit(0), scheduled(false) {}
+            RingQueue<T> que;
+            int weight;
+            size_t capacity;
+            int deficit;       // 本轮剩余的额度
+            bool scheduled;    // 是否在active_中
+        };
+
+        // 当前组移出轮转 下次有任务时重新排到末尾 剩余额度作废
+        void retire(Group& g)
+        {
+            g.deficit = 0;
+            g.scheduled = false;
+            active_.pop();
+        }
+
+        std::vector<std::unique_ptr<Group>> groups_;
+        RingQueue<int> active_;
+        size_t size_;
+};
+
+#endif
@@ -0,0 +1,137 @@
+#ifndef MPMCQUEUE_H__
+#define MPMCQUEUE_H__
+
+#include <atomic>
+#include <memory>
+#include <new>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <type_traits>
+
+// 有界多生产者多消费者无锁队列(Vyukov) 容量向上取整为2的幂
+// 每个槽位带一个序号 生产者和消费者各自只竞争enqueuePos_/dequeuePos_和目标槽位所在的缓存行
+template <typename T>
+class MpmcQueue
+{
+    public:
+        explicit MpmcQueue(size_t capacity)
+        {
+            size_t cap = 2;
+            while (cap < capacity) cap <<= 1;
+            mask_ = cap - 1;
+            cells_.reset(new Cell[cap]);
+            for (size_t i = 0; i < cap; i++)
+            {
+                cells_[i].seq.store(i, std::memory_order_relaxed);
+            }
+            enqueuePos_.store(0, std::memory_order_relaxed);
+            dequeuePos_.store(0, std::memory_order_relaxed);
+        }
+
+        ~MpmcQueue()
+        {
+            // 析构时队列中剩余的元素
+            size_t end = enqueuePos_.load(std::memory_order_relaxed);
+            for (size_t pos = dequeuePos_.load(std::memory_order_relaxed); pos != end; pos++)
+            {
+                Cell& cell = cells_[pos & mask_];
+                if (cell.seq.load(std::memory_order_relaxed) == pos + 1)
+                {
+                    cell.ptr()->~T();
+                }
+            }
+        }
+
+        MpmcQueue(const MpmcQueue&) = delete;
+        MpmcQueue& operator=(const MpmcQueue&) = delete;
+
+        // 队列满时返回false 此时item不会被移动 可以再次尝试
+        template <typename U>
+        bool tryPush(U&& item)
+        {
+            Cell* cell;
+            size_t pos = enqueuePos_.load(std::memory_order_relaxed);
+            for (;;)
+            {
+                cell = &cells_[pos & mask_];
+                size_t seq = cell->seq.load(std::memory_order_acquire);
+                intptr_t dif = (intptr_t)seq - (intptr_t)pos;
+                if (dif == 0)
+                {
+                    if (enqueuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    {
+                        break;
+                    }
+                }
+                else if (dif < 0)
+                {
+                    return false; // 队列满
+                }
+                else
+                {
+                    pos = enqueuePos_.load(std::memory_order_relaxed);
+                }
+            }
+            new (&cell->storage) T(std::forward<U>(item));
+            cell->seq.store(pos + 1, std::memory_order_release);
+            return true;
+        }
+
+        // 队列空时返回false
+        bool tryPop(T& item)
+        {
+            Cell* cell;
+            size_t pos = dequeuePos_.load(std::memory_order_relaxed);
+            for (;;)
+            {
+                cell = &cells_[pos & mask_];
+                size_t seq = cell->seq.load(std::memory_order_acquire);
+                intptr_t dif = (intptr_t)seq - (intptr_t)(pos + 1);
+                if (dif == 0)
+                {
+                    if (dequeuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    {
+                        break;
+                    }
+                }
+                else if (dif < 0)
+                {
+                    return false; // 队列空
+                }
+                else
+                {
+                    pos = dequeuePos_.load(std::memory_order_relaxed);
+                }
+            }
+            item = std::move(*cell->ptr());
+            cell->ptr()->~T();
+            cell->seq.store(pos + mask_ + 1, std::memory_order_release);
+            return true;
+        }
+
+        size_t capacity() const { return mask_ + 1; }
+
+        // 近似大小 仅用于调度参考
+        size_t sizeApprox() const
+        {
+            size_t e = enqueuePos_.load(std::memory_order_relaxed);
+            size_t d = dequeuePos_.load(std::memory_order_relaxed);
+            return e > d ? e - d : 0;
+        }
+
+    private:
+        struct alignas(64) Cell
+        {
+            std::atomic<size_t> seq;
+            typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+            T* ptr() { return reinterpret_cast<T*>(&storage); }
+        };
+
+        std::unique_ptr<Cell[]> cells_;
+        size_t mask_;
+        alignas(64) std::atomic<size_t> enqueuePos_;
+        alignas(64) std::atomic<size_t> dequeuePos_;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,181 @@
+#ifndef PARALLEL_H__
+#define PARALLEL_H__
+
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <iterator>
+
+#include "threadpool.h"
+
+// 数据并行算法 基于ThreadPool实现 调用线程本身也参与计算
+// parallelFor / parallelReduce / parallelTransform
+
+// 分块策略
+enum PartitionMode
+{
+    PARTITION_STATIC,   // 区间预先按块轮流分给各个参与者 先完成的参与者会帮忙处理还没开始的块
+    PARTITION_DYNAMIC,  // 参与者每次领取grainSize个元素
+    PARTITION_GUIDED    // 每次领取剩余元素的1/(2*参与者数) 不少于grainSize 块逐渐变小
+};
+
+struct Partitioner
+{
+    PartitionMode mode;
+    size_t grainSize;   // 块大小 为0时根据区间长度和参与者数自动选择
+
+    Partitioner(PartitionMode m = PARTITION_GUIDED, size_t grain = 0) : mode(m), grainSize(grain) {}
+};
+
+// 一次并行循环的共享状态 区间用[0, total)的偏移表示
+// 通过shared_ptr由调用者和各个辅助任务共同持有 晚启动的辅助任务领取不到块时直接返回
+class ParallelLoop
+{
+    public:
+        ParallelLoop(size_t total, int participants, Partitioner part);
+
+        // 参与者数量: 线程池线程数 + 调用线程 不超过块的数量
+        static int participantsFor(const ThreadPool& pool, size_t total, Partitioner part);
+
+        // 领取一个块[lo, hi) 没有剩余的块时返回false
+        bool claim(int participant, size_t& lo, size_t& hi);
+        // 完成了count个元素
+        void finish(size_t count);
+        // 等待所有元素处理完成 有异常时重新抛出第一个异常
+        void wait();
+
+        void setException(std::exception_ptr e);
+        bool failed() const { return failed_.load(std::memory_order_relaxed); }
+
+    private:
+        size_t total_;
+        int participants_;
+        PartitionMode mode_;
+        size_t grain_;
+
+        // static模式下每个块是否已被领取 以及每个参与者下一次处理自己的第几轮块
+        size_t chunks_;
+        std::unique_ptr<std::atomic_bool[]> claimed_;
+        std::vector<size_t> cursor_;
+
+        alignas(64) std::atomic<size_t> next_; // dynamic/guided模式下一个未领取的偏移 static模式下帮忙扫描的位置
+        alignas(64) std::atomic<size_t> done_; // 已完成的元素数
+
+        std::atomic_bool failed_;
+        std::exception_ptr exception_;
+        std::mutex mtx_;
+        std::condition_variable finishedCond_;
+        bool finished_;
+};
+
+// 在线程池上执行body(participant, lo, hi) 调用线程作为0号参与者
+template <typename Body>
+void runParallelLoop(ThreadPool& pool, size_t total, int participants, Partitioner part, Body& body)
+{
+    if (total == 0) return;
+
+    auto loop = std::make_shared<ParallelLoop>(total, participants, part);
+    Body* bodyPtr = &body;
+    auto work = [loop, bodyPtr](int participant) {
+        size_t lo, hi;
+        while (loop->claim(participant, lo, hi))
+        {
+            // 已经有块抛出异常后 剩余的块只计数不执行
+            if (!loop->failed())
+            {
+                try
+                {
+                    (*bodyPtr)(participant, lo, hi);
+                }
+                catch (...)
+                {
+                    loop->setException(std::current_exception());
+                }
+            }
+            loop->finish(hi - lo);
+        }
+    };
+
+    // 辅助任务只是为了让空闲线程参与 队列满时不等待 剩余的块由已有的参与者完成
+    if (participants > 1)
+    {
+        pool.tryPostRange(participants - 1, [&](size_t i) {
+            return [work, i]() {work((int)i + 1);};
+        });
+    }
+    work(0);
+    loop->wait();
+}
+
+// 对[begin, end)中的每个下标调用func(i)
+template <typename Index, typename Func>
+void parallelFor(ThreadPool& pool, Index begin, Index end, Func&& func, Partitioner part = Partitioner())
+{
+    if (!(begin < end)) return;
+
+    size_t total = end - begin;
+    auto body = [&](int, size_t lo, size_t hi) {
+        for (size_t i = lo; i < hi; i++)
+        {
+            func(Index(begin + i));
+        }
+    };
+    runParallelLoop(pool, total, ParallelLoop::participantsFor(pool, total, part), part, body);
+}
+
+// 每个参与者的部分结果独占一个缓存行
+template <typename T>
+struct alignas(64) PaddedValue
+{
+    T value;
+};
+
+// 返回reduce(identity, func(begin), ..., func(end - 1)) identity需要是reduce的单位元 reduce需要满足结合律和交换律
+template <typename Index, typename T, typename Func, typename Reduce>
+T parallelReduce(ThreadPool& pool, Index begin, Index end, T identity, Func&& func, Reduce&& reduce, Partitioner part = Partitioner())
+{
+    if (!(begin < end)) return identity;
+
+    size_t total = end - begin;
+    int participants = ParallelLoop::participantsFor(pool, total, part);
+    std::vector<PaddedValue<T>> partials(participants, PaddedValue<T>{identity});
+    auto body = [&](int participant, size_t lo, size_t hi) {
+        T acc = std::move(partials[participant].value);
+        for (size_t i = lo; i < hi; i++)
+        {
+            acc = reduce(std::move(acc), func(Index(begin + i)));
+        }
+        partials[participant].value = std::move(acc);
+    };
+    runParallelLoop(pool, total, participants, part, body);
+
+    T result = std::move(identity);
+    for (auto& partial : partials)
+    {
+        result = reduce(std::move(result), std::move(partial.value));
+    }
+    return result;
+}
+
+// out[i] = func(first[i]) 要求随机访问迭代器 返回输出区间的尾后迭代器
+template <typename InputIt, typename OutputIt, typename Func>
+OutputIt parallelTransform(ThreadPool& pool, InputIt first, InputIt last, OutputIt out, Func&& func, Partitioner part = Partitioner())
+{
+    auto n = std::distance(first, last);
+    if (n <= 0) return out;
+
+    size_t total = n;
+    auto body = [&](int, size_t lo, size_t hi) {
+        for (size_t i = lo; i < hi; i++)
+        {
+            out[i] = func(first[i]);
+        }
+    };
+    runParallelLoop(pool, total, ParallelLoop::participantsFor(pool, total, part), part, body);
+    return out + n;
+}
+
+#endif
\ No newline at end of file
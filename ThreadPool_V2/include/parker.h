@@ -0,0 +1,163 @@
+#ifndef PARKER_H__
+#define PARKER_H__
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#ifdef __linux__
+#include <climits>
+#include <ctime>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#else
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#endif
+
+// 自旋等待时降低流水线和功耗开销
+inline void cpuRelax()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    asm volatile("yield");
+#endif
+}
+
+// 等待*addr不再等于old 相当于C++20的std::atomic::wait 可能虚假返回 调用者需要重新检查
+inline void atomicWait(const std::atomic<uint32_t>& addr, uint32_t old)
+{
+#ifdef __linux__
+    syscall(SYS_futex, reinterpret_cast<const uint32_t*>(&addr), FUTEX_WAIT_PRIVATE, old, nullptr, nullptr, 0);
+#else
+    if (addr.load(std::memory_order_acquire) == old) std::this_thread::yield();
+#endif
+}
+
+// 同atomicWait 最多等待timeout
+inline void atomicWaitFor(const std::atomic<uint32_t>& addr, uint32_t old, std::chrono::nanoseconds timeout)
+{
+#ifdef __linux__
+    if (timeout.count() <= 0) return;
+    timespec ts;
+    ts.tv_sec = timeout.count() / 1000000000;
+    ts.tv_nsec = timeout.count() % 1000000000;
+    syscall(SYS_futex, reinterpret_cast<const uint32_t*>(&addr), FUTEX_WAIT_PRIVATE, old, &ts, nullptr, 0);
+#else
+    (void)timeout;
+    if (addr.load(std::memory_order_acquire) == old) std::this_thread::yield();
+#endif
+}
+
+// 唤醒所有在addr上atomicWait的线程
+inline void atomicNotifyAll(const std::atomic<uint32_t>& addr)
+{
+#ifdef __linux__
+    syscall(SYS_futex, reinterpret_cast<const uint32_t*>(&addr), FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0);
+#else
+    (void)addr;
+#endif
+}
+
+// 单个线程的睡眠/唤醒原语 每个线程池线程一个
+// unpark先于park发生时 下一次park直接返回 不会丢失唤醒
+// Linux下直接使用futex 睡眠和唤醒各只需要一次系统调用
+class Parker
+{
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        Parker() : state_(EMPTY) {}
+
+        Parker(const Parker&) = delete;
+        Parker& operator=(const Parker&) = delete;
+
+        void park()
+        {
+            // NOTIFIED -> EMPTY 直接返回 EMPTY -> PARKED 进入睡眠
+            if (state_.fetch_sub(1, std::memory_order_acquire) == NOTIFIED) return;
+            for (;;)
+            {
+                wait(nullptr);
+                int32_t notified = NOTIFIED;
+                if (state_.compare_exchange_strong(notified, EMPTY, std::memory_order_acquire)) return;
+                // 虚假唤醒 继续睡眠
+            }
+        }
+
+        // 睡眠到被唤醒或者超过deadline 返回是否被唤醒
+        bool parkUntil(Clock::time_point deadline)
+        {
+            if (state_.fetch_sub(1, std::memory_order_acquire) == NOTIFIED) return true;
+            for (;;)
+            {
+                auto now = Clock::now();
+                if (now >= deadline) break;
+                wait(&deadline);
+                int32_t notified = NOTIFIED;
+                if (state_.compare_exchange_strong(notified, EMPTY, std::memory_order_acquire)) return true;
+            }
+            // 超时 PARKED -> EMPTY 期间刚好被唤醒时也算作唤醒
+            return state_.exchange(EMPTY, std::memory_order_acquire) == NOTIFIED;
+        }
+
+        void unpark()
+        {
+            if (state_.exchange(NOTIFIED, std::memory_order_release) == PARKED)
+            {
+                wake();
+            }
+        }
+
+    private:
+        static constexpr int32_t PARKED = -1;
+        static constexpr int32_t EMPTY = 0;
+        static constexpr int32_t NOTIFIED = 1;
+
+#ifdef __linux__
+        void wait(const Clock::time_point* deadline)
+        {
+            timespec ts;
+            timespec* timeout = nullptr;
+            if (deadline != nullptr)
+            {
+                auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(*deadline - Clock::now()).count();
+                if (ns <= 0) return;
+                ts.tv_sec = ns / 1000000000;
+                ts.tv_nsec = ns % 1000000000;
+                timeout = &ts;
+            }
+            // state_不是PARKED时立即返回
+            syscall(SYS_futex, reinterpret_cast<int32_t*>(&state_), FUTEX_WAIT_PRIVATE, PARKED, timeout, nullptr, 0);
+        }
+
+        void wake()
+        {
+            syscall(SYS_futex, reinterpret_cast<int32_t*>(&state_), FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+        }
+#else
+        void wait(const Clock::time_point* deadline)
+        {
+            std::unique_lock<std::mutex> lk(mtx_);
+            auto parked = [&]() {return state_.load(std::memory_order_relaxed) != PARKED;};
+            if (deadline != nullptr) cond_.wait_until(lk, *deadline, parked);
+            else cond_.wait(lk, parked);
+        }
+
+        void wake()
+        {
+            std::unique_lock<std::mutex> lk(mtx_);
+            cond_.notify_one();
+        }
+
+        std::mutex mtx_;
+        std::condition_variable cond_;
+#endif
+
+        std::atomic<int32_t> state_;
+};
+
+#endif
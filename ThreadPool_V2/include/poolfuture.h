@@ -0,0 +1,591 @@
+#ifndef POOLFUTURE_H__
+#define POOLFUTURE_H__
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <tuple>
+#include <optional>
+#include <exception>
+#include <future>
+#include <type_traits>
+#include <utility>
+#include <stdexcept>
+#include <initializer_list>
+
+#include "threadpool.h"
+
+// 支持续延的future 值就绪时把then注册的函数作为新任务提交到线程池 等待结果的过程不占用任何线程
+// 用法:
+//   PoolFuture<int> f = submitAsync(pool, func, args...);
+//   PoolFuture<std::string> g = f.then([](int v) {return std::to_string(v);});
+//   PoolFuture<std::vector<int>> all = whenAll(std::move(futures));
+// 线程池需要比所有还没执行的续延活得更久
+
+template <typename T>
+class PoolFuture;
+
+namespace detail
+{
+
+struct Unit {};
+
+template <typename T>
+using StoredType = std::conditional_t<std::is_void<T>::value, Unit, T>;
+
+// 共享状态 用三个标志位实现无锁的状态机:
+//   RESULT   生产者已经写入值或异常
+//   CALLBACK 消费者已经注册续延
+//   WAITERS  有线程在wait中睡眠
+// 值和续延各自在设置对应标志位之前写入 后设置标志位的一方负责调用续延
+template <typename T>
+class FutureState
+{
+    public:
+        FutureState() : state_(0) {}
+
+        template <typename... V>
+        void setValue(V&&... value)
+        {
+            value_.emplace(std::forward<V>(value)...);
+            publish();
+        }
+
+        void setException(std::exception_ptr e)
+        {
+            exception_ = e;
+            publish();
+        }
+
+        // 只能调用一次 结果已经就绪时在当前线程立即调用callback 否则由生产者线程调用
+        void setCallback(UniqueFunction<void()> callback)
+        {
+            callback_ = std::move(callback);
+            if (state_.fetch_or(CALLBACK, std::memory_order_acq_rel) & RESULT)
+            {
+                runCallback();
+            }
+        }
+
+        // 和setCallback相同 但结果已经就绪时不调用callback而是返回false
+        // 用于协程的await_suspend: 不能在挂起的过程中恢复协程 由调用者直接继续执行
+        bool trySetCallback(UniqueFunction<void()> callback)
+        {
+            callback_ = std::move(callback);
+            if (state_.fetch_or(CALLBACK, std::memory_order_acq_rel) & RESULT)
+            {
+                callback_ = nullptr;
+                return false;
+            }
+            return true;
+        }
+
+        bool ready() const { return state_.load(std::memory_order_acquire) & RESULT; }
+
+        void wait()
+        {
+            // 先短暂自旋 大多数短任务不需要进入睡眠
+            for (int i = 0; i < 64; i++)
+            {
+                if (ready()) return;
+                cpuRelax();
+            }
+            uint32_t s = state_.fetch_or(WAITERS, std::memory_order_acq_rel) | WAITERS;
+            while (!(s & RESULT))
+            {
+                atomicWait(state_, s);
+                s = state_.load(std::memory_order_acquire);
+            }
+        }
+
+        // 最多睡眠timeout 返回时结果不一定就绪
+        void waitFor(std::chrono::nanoseconds timeout)
+        {
+            uint32_t s = state_.fetch_or(WAITERS, std::memory_order_acq_rel) | WAITERS;
+            if (!(s & RESULT))
+            {
+                atomicWaitFor(state_, s, timeout);
+            }
+        }
+
+        // 结果就绪后取出 值被移走 只能调用一次
+        T take()
+        {
+            if (exception_)
+            {
+                std::rethrow_exception(exception_);
+            }
+            if constexpr (!std::is_void<T>::value)
+            {
+                return std::move(*value_);
+            }
+        }
+
+        std::exception_ptr exception() const { return exception_; }
+
+    private:
+        static constexpr uint32_t RESULT = 1;
+        static constexpr uint32_t CALLBACK = 2;
+        static constexpr uint32_t WAITERS = 4;
+
+        void publish()
+        {
+            uint32_t prev = state_.fetch_or(RESULT, std::memory_order_acq_rel);
+            if (prev & CALLBACK)
+            {
+                runCallback();
+            }
+            if (prev & WAITERS)
+            {
+                atomicNotifyAll(state_);
+            }
+        }
+
+        void runCallback()
+        {
+            // 续延通常持有本状态的shared_ptr 调用后释放以打破循环引用
+            UniqueFunction<void()> callback = std::move(callback_);
+            callback();
+        }
+
+        std::atomic<uint32_t> state_;
+        std::optional<StoredType<T>> value_;
+        std::exception_ptr exception_;
+        UniqueFunction<void()> callback_;
+};
+
+template <typename T>
+std::shared_ptr<FutureState<T>> makeState(std::pmr::memory_resource* resource = nullptr)
+{
+    // 共享状态默认从线程本地缓存分配
+    return std::allocate_shared<FutureState<T>>(TaskAllocator<FutureState<T>>(resource));
+}
+
+// 提交到线程池的任务持有的共享状态 任务被丢弃(OVERFLOW_DROP_OLDEST)而没有执行时 析构中写入broken_promise异常
+template <typename T>
+class StateGuard
+{
+    public:
+        explicit StateGuard(std::shared_ptr<FutureState<T>> state) : state_(std::move(state)) {}
+        StateGuard(StateGuard&&) = default;
+        ~StateGuard()
+        {
+            if (state_ != nullptr && !state_->ready())
+            {
+                state_->setException(std::make_exception_ptr(std::future_error(std::future_errc::broken_promise)));
+            }
+        }
+
+        FutureState<T>& operator*() const { return *state_; }
+
+    private:
+        std::shared_ptr<FutureState<T>> state_;
+};
+
+// 执行func并把返回值或异常写入state
+template <typename T, typename F>
+void fulfil(FutureState<T>& state, F&& func)
+{
+    try
+    {
+        if constexpr (std::is_void<T>::value)
+        {
+            func();
+            state.setValue();
+        }
+        else
+        {
+            state.setValue(func());
+        }
+    }
+    catch (...)
+    {
+        state.setException(std::current_exception());
+    }
+}
+
+// then(func)中func的返回值类型 void的future调用func() 否则调用func(value)
+template <typename T, typename F, bool = std::is_void<T>::value>
+struct ThenResult
+{
+    using type = std::invoke_result_t<F, T>;
+};
+
+template <typename T, typename F>
+struct ThenResult<T, F, true>
+{
+    using type = std::invoke_result_t<F>;
+};
+
+// 在线程池上执行续延 没有线程池时直接在当前线程执行
+template <typename F>
+void schedule(ThreadPool* pool, F&& func)
+{
+    if (pool != nullptr)
+    {
+        pool->post(std::forward<F>(func));
+    }
+    else
+    {
+        func();
+    }
+}
+
+// 组合函数访问PoolFuture内部的入口
+struct FutureAccess
+{
+    template <typename T>
+    static PoolFuture<T> make(std::shared_ptr<FutureState<T>> state, ThreadPool* pool)
+    {
+        return PoolFuture<T>(std::move(state), pool);
+    }
+
+    // 取出共享状态 future随之失效
+    template <typename T>
+    static std::shared_ptr<FutureState<T>> release(PoolFuture<T>& future) { return std::move(future.state_); }
+
+    template <typename T>
+    static ThreadPool* pool(const PoolFuture<T>& future) { return future.pool_; }
+};
+
+}
+
+template <typename T>
+class PoolFuture
+{
+    public:
+        PoolFuture() : pool_(nullptr) {}
+        PoolFuture(PoolFuture&&) = default;
+        PoolFuture& operator=(PoolFuture&&) = default;
+
+        bool valid() const { return state_ != nullptr; }
+        bool ready() const { return state_ != nullptr && state_->ready(); }
+
+        // 阻塞等待结果 不使用互斥锁和条件变量
+        // 在所属线程池的线程上调用时 等待期间执行队列中的其他任务(见ThreadPool::wait)
+        void wait() const
+        {
+            if (pool_ != nullptr)
+            {
+                detail::FutureState<T>* state = state_.get();
+                pool_->helpUntil([state]() {return state->ready();},
+                                 [state]() {state->waitFor(ThreadPool::HELP_WAIT_INTERVAL);});
+            }
+            state_->wait();
+        }
+
+        // 等待并取出结果 有异常时重新抛出 调用后future失效
+        T get()
+        {
+            wait();
+            auto state = std::move(state_);
+            return state->take();
+        }
+
+        // 结果就绪后在线程池上执行func(value) 返回func结果的future 调用后本future失效
+        // 本future保存的是异常时不调用func 异常直接传递给返回的future
+        template <typename F>
+        auto then(F&& func) -> PoolFuture<typename detail::ThenResult<T, F>::type>
+        {
+            using R = typename detail::ThenResult<T, F>::type;
+            auto prev = std::move(state_);
+            auto next = detail::makeState<R>(pool_ != nullptr ? pool_->getMemoryResource() : nullptr);
+            ThreadPool* pool = pool_;
+            detail::FutureState<T>* raw = prev.get();
+            raw->setCallback([pool, prev = std::move(prev), next, func = std::forward<F>(func)]() mutable {
+                if (prev->exception())
+                {
+                    // 异常不需要经过线程池
+                    next->setException(prev->exception());
+                    return ;
+                }
+                detail::schedule(pool, [prev = std::move(prev), next = detail::StateGuard<R>(std::move(next)), func = std::move(func)]() mutable {
+                    detail::fulfil(*next, [&]() -> R {
+                        if constexpr (std::is_void<T>::value)
+                        {
+                            prev->take();
+                            return func();
+                        }
+                        else
+                        {
+                            return func(prev->take());
+                        }
+                    });
+                });
+            });
+            return PoolFuture<R>(std::move(next), pool);
+        }
+
+    private:
+        template <typename U>
+        friend class PoolFuture;
+        template <typename U>
+        friend class PoolPromise;
+        friend struct detail::FutureAccess;
+
+        PoolFuture(std::shared_ptr<detail::FutureState<T>> state, ThreadPool* pool) : state_(std::move(state)), pool_(pool) {}
+
+        std::shared_ptr<detail::FutureState<T>> state_;
+        ThreadPool* pool_; // then注册的续延在这个线程池上执行
+};
+
+namespace detail
+{
+
+// 取第一个绑定了线程池的future的线程池 组合结果的then在它上面执行
+template <typename T>
+ThreadPool* poolOf(const std::vector<PoolFuture<T>>& futures)
+{
+    for (auto& future : futures)
+    {
+        ThreadPool* pool = FutureAccess::pool(future);
+        if (pool != nullptr) return pool;
+    }
+    return nullptr;
+}
+
+}
+
+// 手动设置结果的promise 用于把回调式的接口接入PoolFuture
+// 销毁时还没有设置结果的话 future得到std::future_error(broken_promise)
+template <typename T>
+class PoolPromise
+{
+    public:
+        PoolPromise() : state_(detail::makeState<T>()) {}
+        PoolPromise(PoolPromise&&) = default;
+        PoolPromise& operator=(PoolPromise&&) = default;
+        ~PoolPromise()
+        {
+            if (state_ != nullptr && !satisfied_)
+            {
+                state_->setException(std::make_exception_ptr(std::future_error(std::future_errc::broken_promise)));
+            }
+        }
+
+        // pool为then注册的续延所在的线程池
+        PoolFuture<T> getFuture(ThreadPool* pool = nullptr) { return PoolFuture<T>(state_, pool); }
+
+        template <typename... V>
+        void setValue(V&&... value)
+        {
+            satisfied_ = true;
+            state_->setValue(std::forward<V>(value)...);
+        }
+
+        void setException(std::exception_ptr e)
+        {
+            satisfied_ = true;
+            state_->setException(e);
+        }
+
+    private:
+        std::shared_ptr<detail::FutureState<T>> state_;
+        bool satisfied_ = false;
+};
+
+// 提交任务 返回PoolFuture 队列满时按线程池的溢出策略处理 被拒绝时future中保存TaskRejectedError
+template <typename Func, typename... Args>
+auto submitAsync(ThreadPool& pool, Func&& func, Args&&... args) -> PoolFuture<decltype(func(args...))>
+{
+    using RTtype = decltype(func(args...));
+    auto state = detail::makeState<RTtype>(pool.getMemoryResource());
+    ThreadPool::Task task(std::allocator_arg, pool.getMemoryResource(), [guard = detail::StateGuard<RTtype>(state), func = std::forward<Func>(func),
+                           args = std::make_tuple(std::forward<Args>(args)...)]() mutable {
+        detail::fulfil(*guard, [&]() -> RTtype {return std::apply(func, args);});
+    });
+    if (pool.dispatch(&task, 1) == 0)
+    {
+        // 按溢出策略被拒绝
+        state->setException(std::make_exception_ptr(TaskRejectedError()));
+    }
+    return detail::FutureAccess::make(std::move(state), &pool);
+}
+
+// 所有future完成后得到全部结果 按输入顺序排列 任意一个失败时得到第一个异常
+// 组合过程由完成最后一个输入的线程直接执行 不额外提交任务
+template <typename T>
+auto whenAll(std::vector<PoolFuture<T>> futures)
+    -> PoolFuture<std::conditional_t<std::is_void<T>::value, void, std::vector<detail::StoredType<T>>>>
+{
+    using R = std::conditional_t<std::is_void<T>::value, void, std::vector<detail::StoredType<T>>>;
+    auto out = detail::makeState<R>();
+    ThreadPool* pool = detail::poolOf(futures);
+    if (futures.empty())
+    {
+        detail::fulfil(*out, []() -> R {return R();});
+        return detail::FutureAccess::make(std::move(out), pool);
+    }
+
+    struct Context
+    {
+        std::vector<std::optional<detail::StoredType<T>>> values;
+        std::atomic<size_t> remaining;
+        std::atomic_bool failed{false};
+        std::exception_ptr exception;
+        std::shared_ptr<detail::FutureState<R>> out;
+    };
+    auto ctx = std::make_shared<Context>();
+    ctx->values.resize(futures.size());
+    ctx->remaining.store(futures.size(), std::memory_order_relaxed);
+    ctx->out = out;
+
+    for (size_t i = 0; i < futures.size(); i++)
+    {
+        auto input = detail::FutureAccess::release(futures[i]);
+        detail::FutureState<T>* raw = input.get();
+        raw->setCallback([ctx, i, input = std::move(input)]() {
+            try
+            {
+                if constexpr (std::is_void<T>::value)
+                {
+                    input->take();
+                    ctx->values[i].emplace();
+                }
+                else
+                {
+                    ctx->values[i].emplace(input->take());
+                }
+            }
+            catch (...)
+            {
+                if (!ctx->failed.exchange(true))
+                {
+                    ctx->exception = std::current_exception();
+                }
+            }
+            // acq_rel: 最后一个完成的线程能看到所有结果和异常
+            if (ctx->remaining.fetch_sub(1, std::memory_order_acq_rel) != 1) return ;
+            if (ctx->failed.load(std::memory_order_relaxed))
+            {
+                ctx->out->setException(ctx->exception);
+                return ;
+            }
+            detail::fulfil(*ctx->out, [&]() -> R {
+                if constexpr (!std::is_void<T>::value)
+                {
+                    R result;
+                    result.reserve(ctx->values.size());
+                    for (auto& v : ctx->values) result.push_back(std::move(*v));
+                    return result;
+                }
+            });
+        });
+    }
+    return detail::FutureAccess::make(std::move(out), pool);
+}
+
+namespace detail
+{
+
+template <typename R, typename Context, typename Future, size_t I>
+void attachTupleInput(const std::shared_ptr<Context>& ctx, Future& future, std::integral_constant<size_t, I>)
+{
+    auto input = FutureAccess::release(future);
+    auto* raw = input.get();
+    raw->setCallback([ctx, input = std::move(input)]() {
+        try
+        {
+            std::get<I>(ctx->values).emplace(input->take());
+        }
+        catch (...)
+        {
+            if (!ctx->failed.exchange(true))
+            {
+                ctx->exception = std::current_exception();
+            }
+        }
+        if (ctx->remaining.fetch_sub(1, std::memory_order_acq_rel) != 1) return ;
+        if (ctx->failed.load(std::memory_order_relaxed))
+        {
+            ctx->out->setException(ctx->exception);
+            return ;
+        }
+        fulfil(*ctx->out, [&]() -> R {
+            return std::apply([](auto&... v) {return R(std::move(*v)...);}, ctx->values);
+        });
+    });
+}
+
+template <typename R, typename Context, typename... Futures, size_t... Is>
+void attachTupleInputs(const std::shared_ptr<Context>& ctx, std::index_sequence<Is...>, Futures&... futures)
+{
+    (attachTupleInput<R>(ctx, futures, std::integral_constant<size_t, Is>()), ...);
+}
+
+}
+
+// 多个不同类型的future 结果为tuple
+template <typename... Ts>
+auto whenAll(PoolFuture<Ts>... futures) -> PoolFuture<std::tuple<Ts...>>
+{
+    static_assert(sizeof...(Ts) > 0, "whenAll needs at least one future");
+    static_assert(!std::disjunction<std::is_void<Ts>...>::value, "use whenAll(std::vector<PoolFuture<void>>) for void futures");
+
+    using R = std::tuple<Ts...>;
+    struct Context
+    {
+        std::tuple<std::optional<Ts>...> values;
+        std::atomic<size_t> remaining{sizeof...(Ts)};
+        std::atomic_bool failed{false};
+        std::exception_ptr exception;
+        std::shared_ptr<detail::FutureState<R>> out;
+    };
+    auto ctx = std::make_shared<Context>();
+    ctx->out = detail::makeState<R>();
+    auto out = ctx->out;
+    ThreadPool* pool = nullptr;
+    for (ThreadPool* p : {detail::FutureAccess::pool(futures)...})
+    {
+        if (pool == nullptr) pool = p;
+    }
+    detail::attachTupleInputs<R>(ctx, std::index_sequence_for<Ts...>(), futures...);
+    return detail::FutureAccess::make(std::move(out), pool);
+}
+
+// whenAny的结果: 最先完成的future的下标和值
+template <typename T>
+struct WhenAnyResult
+{
+    size_t index;
+    T value;
+};
+
+// 任意一个future完成时得到它的下标和结果 最先完成的是异常时得到该异常
+template <typename T>
+auto whenAny(std::vector<PoolFuture<T>> futures)
+    -> PoolFuture<std::conditional_t<std::is_void<T>::value, size_t, WhenAnyResult<detail::StoredType<T>>>>
+{
+    using R = std::conditional_t<std::is_void<T>::value, size_t, WhenAnyResult<detail::StoredType<T>>>;
+    auto out = detail::makeState<R>();
+    ThreadPool* pool = detail::poolOf(futures);
+    if (futures.empty())
+    {
+        out->setException(std::make_exception_ptr(std::invalid_argument("whenAny of no futures")));
+        return detail::FutureAccess::make(std::move(out), pool);
+    }
+
+    auto done = std::make_shared<std::atomic_bool>(false);
+    for (size_t i = 0; i < futures.size(); i++)
+    {
+        auto input = detail::FutureAccess::release(futures[i]);
+        detail::FutureState<T>* raw = input.get();
+        raw->setCallback([done, out, i, input = std::move(input)]() {
+            if (done->exchange(true, std::memory_order_acq_rel)) return ;
+            detail::fulfil(*out, [&]() -> R {
+                if constexpr (std::is_void<T>::value)
+                {
+                    input->take();
+                    return i;
+                }
+                else
+                {
+                    return R{i, input->take()};
+                }
+            });
+        });
+    }
+    return detail::FutureAccess::make(std::move(out), pool);
+}
+
+#endif
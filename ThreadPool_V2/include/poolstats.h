@@ -0,0 +1,261 @@
+#ifndef POOLSTATS_H__
+#define POOLSTATS_H__
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// 线程池运行时统计 ThreadPool::stats()返回的快照
+// 每个线程只写自己的计数器(独占缓存行 不需要原子加) 读取快照时才汇总 开销只有每个任务两次读时钟
+// 定义THREADPOOL_NO_STATS时统计代码全部编译为空 stats()只返回线程数和任务数
+// 注意库和使用者需要使用相同的定义 CMake中对应THREADPOOL_STATS选项
+
+// 直方图快照 值的单位为纳秒
+class HistogramSnapshot
+{
+    public:
+        uint64_t count() const { return count_; }
+        uint64_t max() const { return max_; }
+        double mean() const { return count_ == 0 ? 0 : (double)sum_ / count_; }
+        // p取[0, 100] 返回所在桶的上界 相对误差不超过1/8
+        uint64_t percentile(double p) const;
+
+        // 桶i的下界
+        static uint64_t bucketLowerBound(int bucket);
+
+    private:
+        friend class LatencyHistogram;
+        std::vector<uint64_t> counts_;
+        uint64_t count_ = 0;
+        uint64_t sum_ = 0;
+        uint64_t max_ = 0;
+};
+
+struct WorkerStatsSnapshot
+{
+    bool active = false;          // 对应的线程是否仍在运行 退出线程的统计保留 槽位会被新线程复用
+    uint64_t tasksExecuted = 0;
+    uint64_t steals = 0;          // 工作窃取模式下从其他线程窃取的任务数
+    uint64_t parks = 0;           // 自旋后仍然没有任务而睡眠的次数
+    uint64_t helped = 0;          // 在任务中等待future时顺便执行的任务数 也计入tasksExecuted
+    uint64_t busyNs = 0;          // 执行任务的时间
+    uint64_t idleNs = 0;          // 两个任务之间等待的时间
+};
+
+// 任务组(见ThreadPool::createTaskGroup)的统计
+struct TaskGroupStats
+{
+    std::string name;
+    int weight = 0;
+    size_t capacity = 0;          // 组的队列上限
+    size_t queuedTasks = 0;       // 组中还没有开始执行的任务数
+    uint64_t submittedTasks = 0;  // 入队的任务数
+    uint64_t executedTasks = 0;
+    uint64_t rejectedTasks = 0;   // 组的队列满而被拒绝的任务数 包括在提交线程上执行的
+    uint64_t droppedTasks = 0;    // 为新任务腾出位置而丢弃的任务数
+    HistogramSnapshot queueWait;  // 组中任务从入队到开始执行的时间
+    HistogramSnapshot exec;       // 组中任务的执行时间
+};
+
+struct ThreadPoolStats
+{
+    int threads = 0;              // 当前线程数
+    int idleThreads = 0;          // 空闲线程数
+    unsigned queuedTasks = 0;     // 还没有开始执行的任务数
+
+    // 任务队列满时的处理 见OverflowPolicy
+    uint64_t rejectedTasks = 0;   // 被拒绝的任务数(future中保存TaskRejectedError)
+    uint64_t droppedTasks = 0;    // 为新任务腾出位置而丢弃的任务数
+    uint64_t callerRunsTasks = 0; // 在提交线程上直接执行的任务数
+    uint64_t cancelledTasks = 0;  // 开始执行前已经取消或者超过截止时间而没有执行的任务数
+
+    // 以下为所有线程的汇总
+    uint64_t tasksExecuted = 0;
+    uint64_t steals = 0;
+    uint64_t parks = 0;
+    uint64_t helped = 0;
+    uint64_t busyNs = 0;
+    uint64_t idleNs = 0;
+    HistogramSnapshot queueWait;  // 任务从入队到开始执行的时间
+    HistogramSnapshot exec;       // 任务执行时间
+
+    std::vector<WorkerStatsSnapshot> workers;
+    std::vector<TaskGroupStats> groups;
+};
+
+#ifndef THREADPOOL_NO_STATS
+
+inline int64_t statsNow()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// HDR风格的对数线性直方图: 每个2的幂区间再均分为SUB_BUCKETS个桶
+// record只允许一个线程写入 多个线程写入时使用recordConcurrent 其他线程可以随时读取
+class LatencyHistogram
+{
+    public:
+        static constexpr int SUB_BITS = 3;
+        static constexpr int SUB_BUCKETS = 1 << SUB_BITS;
+        static constexpr int BUCKETS = (64 - SUB_BITS + 1) * SUB_BUCKETS;
+
+        LatencyHistogram()
+        {
+            for (auto& c : counts_) c.store(0, std::memory_order_relaxed);
+        }
+
+        void record(int64_t ns)
+        {
+            uint64_t v = ns > 0 ? ns : 0;
+            bump(counts_[bucketIndex(v)], 1);
+            bump(count_, 1);
+            bump(sum_, v);
+            if (v > max_.load(std::memory_order_relaxed)) max_.store(v, std::memory_order_relaxed);
+        }
+
+        // 多个线程同时写入时使用 原子加
+        void recordConcurrent(int64_t ns)
+        {
+            uint64_t v = ns > 0 ? ns : 0;
+            counts_[bucketIndex(v)].fetch_add(1, std::memory_order_relaxed);
+            count_.fetch_add(1, std::memory_order_relaxed);
+            sum_.fetch_add(v, std::memory_order_relaxed);
+            uint64_t m = max_.load(std::memory_order_relaxed);
+            while (v > m && !max_.compare_exchange_weak(m, v, std::memory_order_relaxed)) {}
+        }
+
+        // 累加到快照中
+        void addTo(HistogramSnapshot& snapshot) const;
+
+        static int bucketIndex(uint64_t v)
+        {
+            if (v < (uint64_t)SUB_BUCKETS) return (int)v;
+            int msb = 63 - __builtin_clzll(v);
+            int shift = msb - SUB_BITS;
+            return (shift + 1) * SUB_BUCKETS + (int)((v >> shift) & (SUB_BUCKETS - 1));
+        }
+
+    private:
+        static void bump(std::atomic<uint64_t>& c, uint64_t n)
+        {
+            c.store(c.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+        }
+
+        std::atomic<uint64_t> counts_[BUCKETS];
+        std::atomic<uint64_t> count_{0};
+        std::atomic<uint64_t> sum_{0};
+        std::atomic<uint64_t> max_{0};
+};
+
+// 入队时间 保存在队列中的每个任务上
+struct TaskStamp
+{
+    int64_t enqueueTime = 0;
+    void stamp(int64_t now) { enqueueTime = now; }
+};
+
+// 每个线程一份 独占缓存行避免和其他线程的计数器伪共享
+class alignas(64) WorkerStats
+{
+    public:
+        // 开始执行一个任务 now为当前时间
+        void taskStarted(int64_t now, const TaskStamp& stamp)
+        {
+            if (lastFinish_ != 0) bump(idleNs_, now - lastFinish_);
+            queueWait_.record(now - stamp.enqueueTime);
+            taskStart_ = now;
+        }
+
+        void taskFinished(int64_t now)
+        {
+            bump(tasksExecuted_, 1);
+            bump(busyNs_, now - taskStart_);
+            exec_.record(now - taskStart_);
+            lastFinish_ = now;
+        }
+
+        // 等待future期间执行了一个任务 执行时间已经算在外层任务的busy中 这里不再累加
+        void taskHelped(int64_t start, int64_t end, const TaskStamp& stamp)
+        {
+            bump(tasksExecuted_, 1);
+            bump(helped_, 1);
+            queueWait_.record(start - stamp.enqueueTime);
+            exec_.record(end - start);
+        }
+
+        void threadStarted(int64_t now) { lastFinish_ = now; }
+        void stolen() { bump(steals_, 1); }
+        void parked() { bump(parks_, 1); }
+
+        void snapshot(WorkerStatsSnapshot& worker, ThreadPoolStats& total) const;
+
+    private:
+        static void bump(std::atomic<uint64_t>& c, int64_t n)
+        {
+            c.store(c.load(std::memory_order_relaxed) + (n > 0 ? n : 0), std::memory_order_relaxed);
+        }
+
+        std::atomic<uint64_t> tasksExecuted_{0};
+        std::atomic<uint64_t> steals_{0};
+        std::atomic<uint64_t> parks_{0};
+        std::atomic<uint64_t> helped_{0};
+        std::atomic<uint64_t> busyNs_{0};
+        std::atomic<uint64_t> idleNs_{0};
+        int64_t taskStart_ = 0;   // 只有本线程访问
+        int64_t lastFinish_ = 0;
+        LatencyHistogram queueWait_;
+        LatencyHistogram exec_;
+};
+
+// 每个任务组一份 由执行该组任务的所有线程共同写入
+class GroupStats
+{
+    public:
+        void taskStarted(int64_t now, const TaskStamp& stamp) { queueWait_.recordConcurrent(now - stamp.enqueueTime); }
+        void taskFinished(int64_t start, int64_t end) { exec_.recordConcurrent(end - start); }
+
+        void snapshot(TaskGroupStats& group) const
+        {
+            queueWait_.addTo(group.queueWait);
+            exec_.addTo(group.exec);
+        }
+
+    private:
+        LatencyHistogram queueWait_;
+        LatencyHistogram exec_;
+};
+
+#else
+
+inline int64_t statsNow() { return 0; }
+
+struct TaskStamp
+{
+    void stamp(int64_t) {}
+};
+
+class WorkerStats
+{
+    public:
+        void taskStarted(int64_t, const TaskStamp&) {}
+        void taskFinished(int64_t) {}
+        void taskHelped(int64_t, int64_t, const TaskStamp&) {}
+        void threadStarted(int64_t) {}
+        void stolen() {}
+        void parked() {}
+        void snapshot(WorkerStatsSnapshot&, ThreadPoolStats&) const {}
+};
+
+class GroupStats
+{
+    public:
+        void taskStarted(int64_t, const TaskStamp&) {}
+        void taskFinished(int64_t, int64_t) {}
+        void snapshot(TaskGroupStats&) const {}
+};
+
+#endif
+
+#endif
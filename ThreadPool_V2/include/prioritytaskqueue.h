@@ -0,0 +1,100 @@
+#ifndef PRIORITYTASKQUEUE_H__
+#define PRIORITYTASKQUEUE_H__
+
+#include <cstddef>
+#include <cstdint>
+
+#include "ringqueue.h"
+
+// 任务优先级 数值越小优先级越高
+enum Priority
+{
+    PRIORITY_HIGH,    // 延迟敏感的请求任务
+    PRIORITY_NORMAL,  // 默认优先级
+    PRIORITY_LOW,     // 后台批处理任务
+    PRIORITY_LEVELS
+};
+
+// 非线程安全的多级优先级队列 由调用者加锁保护
+// 每个优先级一个环形队列 用位图记录非空的队列 出队时直接取最低位 时间复杂度O(1)
+// 防饥饿: 低优先级队列每被跳过一次计数加一 达到agingThreshHold后优先处理一次
+template <typename T>
+class PriorityTaskQueue
+{
+    public:
+        PriorityTaskQueue() : nonEmpty_(0), size_(0), agingThreshHold_(32)
+        {
+            for (int i = 0; i < PRIORITY_LEVELS; i++)
+            {
+                starved_[i] = 0;
+            }
+        }
+
+        void setAgingThreshHold(int threshhold) { agingThreshHold_ = threshhold > 0 ? threshhold : 1; }
+
+        void push(T&& item, Priority priority = PRIORITY_NORMAL)
+        {
+            lanes_[priority].emplace(std::move(item));
+            nonEmpty_ |= 1u << priority;
+            size_++;
+        }
+
+        // 队列为空时返回false
+        bool pop(T& item)
+        {
+            if (nonEmpty_ == 0) return false;
+
+            int lane = __builtin_ctz(nonEmpty_);
+            // 除最高优先级以外的非空队列都被跳过了一次
+            for (uint32_t mask = nonEmpty_ & (nonEmpty_ - 1); mask != 0; mask &= mask - 1)
+            {
+                int p = __builtin_ctz(mask);
+                if (++starved_[p] >= agingThreshHold_)
+                {
+                    lane = p;
+                    break;
+                }
+            }
+            starved_[lane] = 0;
+
+            item = std::move(lanes_[lane].front());
+            lanes_[lane].pop();
+            if (lanes_[lane].empty())
+            {
+                nonEmpty_ &= ~(1u << lane);
+            }
+            size_--;
+            return true;
+        }
+
+        // 取出最低优先级队列中最早入队的任务 用于丢弃旧任务
+        // 最低的非空优先级比floor还高时不取 返回false
+        bool popLowest(T& item, Priority floor)
+        {
+            if (nonEmpty_ == 0) return false;
+            int lane = 31 - __builtin_clz(nonEmpty_);
+            if (lane < floor) return false;
+
+            item = std::move(lanes_[lane].front());
+            lanes_[lane].pop();
+            if (lanes_[lane].empty())
+            {
+                nonEmpty_ &= ~(1u << lane);
+            }
+            size_--;
+            return true;
+        }
+
+        size_t size() const { return size_; }
+        size_t size(Priority priority) const { return lanes_[priority].size(); }
+        bool empty() const { return size_ == 0; }
+
+    private:
+        RingQueue<T> lanes_[PRIORITY_LEVELS];
+        uint32_t nonEmpty_;               // 第i位表示优先级i的队列非空
+        int starved_[PRIORITY_LEVELS];    // 每个优先级连续被跳过的次数
+        size_t size_;
+        int agingThreshHold_;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,95 @@
+#ifndef RINGQUEUE_H__
+#define RINGQUEUE_H__
+
+#include <memory>
+#include <new>
+#include <cstddef>
+#include <utility>
+#include <type_traits>
+
+// 非线程安全的环形队列 接口与std::queue一致
+// 容量只增不减 达到稳定容量后入队出队不再分配内存(std::deque每隔几个元素就要分配/释放一个块)
+template <typename T>
+class RingQueue
+{
+    public:
+        RingQueue() : buf_(nullptr), cap_(0), head_(0), size_(0) {}
+        ~RingQueue()
+        {
+            clear();
+            ::operator delete(buf_);
+        }
+
+        RingQueue(const RingQueue&) = delete;
+        RingQueue& operator=(const RingQueue&) = delete;
+
+        template <typename... Args>
+        void emplace(Args&&... args)
+        {
+            if (size_ == cap_)
+            {
+                grow();
+            }
+            new (slot(head_ + size_)) T(std::forward<Args>(args)...);
+            size_++;
+        }
+
+        void push(T&& item) { emplace(std::move(item)); }
+
+        T& front() { return *slot(head_); }
+        T& back() { return *slot(head_ + size_ - 1); }
+
+        void pop()
+        {
+            slot(head_)->~T();
+            head_ = (head_ + 1) & (cap_ - 1);
+            size_--;
+        }
+
+        // 预留容量 避免运行过程中扩容
+        void reserve(size_t capacity)
+        {
+            while (cap_ < capacity)
+            {
+                grow();
+            }
+        }
+
+        void clear()
+        {
+            while (size_ > 0)
+            {
+                pop();
+            }
+        }
+
+        size_t size() const { return size_; }
+        bool empty() const { return size_ == 0; }
+
+    private:
+        T* slot(size_t i) { return buf_ + (i & (cap_ - 1)); }
+
+        void grow()
+        {
+            size_t cap = cap_ == 0 ? 16 : cap_ * 2;
+            T* buf = static_cast<T*>(::operator new(cap * sizeof(T)));
+            for (size_t i = 0; i < size_; i++)
+            {
+                T* old = slot(head_ + i);
+                new (buf + i) T(std::move(*old));
+                old->~T();
+            }
+            ::operator delete(buf_);
+            buf_ = buf;
+            cap_ = cap;
+            head_ = 0;
+        }
+
+    private:
+        T* buf_;
+        size_t cap_;  // 总是2的幂
+        size_t head_;
+        size_t size_;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,119 @@
+#ifndef STRAND_H__
+#define STRAND_H__
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <tuple>
+#include <vector>
+
+#include "threadpool.h"
+
+// 串行执行器 提交到同一个Strand的任务按提交顺序依次执行 不会并发 不同Strand之间并行
+// 用于按实体(会话、账户)保证顺序 任务中访问实体状态不需要加锁 线程池线程也不会互相阻塞
+//   Strand session(pool);
+//   session.post([&]() {state.apply(msg);});
+//   auto f = session.submit([&]() {return state.balance();});
+// 任务放入Strand自己的无锁队列(多生产者单消费者) 队列从空变为非空时才向线程池提交一个执行任务
+// 执行任务连续执行最多STRAND_BATCH个任务后重新排队 一个繁忙的Strand不会长期占用一个线程
+// Strand的队列不限长度 溢出策略只作用于提交到线程池的执行任务
+// Strand需要比提交给它的任务活得更久 析构时等待已经提交的任务执行完 不能在自己的任务中析构
+class Strand
+{
+    public:
+        using Task = ThreadPool::Task;
+        static constexpr int STRAND_BATCH = 64;
+
+        explicit Strand(ThreadPool& pool);
+        ~Strand();
+
+        Strand(const Strand&) = delete;
+        Strand& operator=(const Strand&) = delete;
+
+        // 提交不需要返回值的任务 抛出的异常记录到日志后丢弃 后面的任务照常执行
+        template <typename Func>
+        void post(Func&& func)
+        {
+            enqueue(Task(std::allocator_arg, pool_.getMemoryResource(), std::forward<Func>(func)));
+        }
+
+        // 提交任务 返回结果的future 参数按值保存
+        template <typename Func, typename... Args>
+        auto submit(Func&& func, Args&&...args) -> std::future<decltype(func(args...))>
+        {
+            using RTtype = decltype(func(args...));
+            std::promise<RTtype> promise(std::allocator_arg, TaskAllocator<char>(pool_.getMemoryResource()));
+            std::future<RTtype> result = promise.get_future();
+            enqueue(Task(std::allocator_arg, pool_.getMemoryResource(), [promise = std::move(promise), func = std::forward<Func>(func),
+                          args = std::make_tuple(std::forward<Args>(args)...)]() mutable {
+                setPromiseResult(promise, [&]() -> RTtype {return std::apply(func, args);});
+            }));
+            return result;
+        }
+
+        // 当前线程是否正在执行本Strand的任务
+        bool runningInThisThread() const { return current_ == this; }
+
+        // 还没有执行完的任务数
+        size_t pending() const { return size_.load(std::memory_order_relaxed); }
+
+    private:
+        struct Node
+        {
+            std::atomic<Node*> next{nullptr};
+            Task task;
+        };
+
+        void enqueue(Task&& task);
+        // 在线程池线程上执行队列中的任务
+        void drain();
+        // 取出队首 调用者保证队列不为空
+        Node* pop();
+        void freeNode(Node* node);
+
+        ThreadPool& pool_;
+        // Vyukov无锁队列: 生产者交换tail_后链接next 消费者从head_取 head_始终指向一个已经取走的哑节点
+        alignas(64) std::atomic<Node*> tail_;
+        alignas(64) std::atomic<size_t> size_;   // 队列中的任务数 从0变为1的生产者负责调度执行任务
+        Node* head_;                             // 只有执行任务访问
+        Node stub_;
+
+        static inline thread_local const Strand* current_ = nullptr;
+};
+
+// 按key选择Strand 同一个key总是得到同一个Strand 保证同一个key的任务按顺序执行
+// 固定数量的Strand 不同key的哈希值相同时共用一个Strand 只是多了串行 不影响正确性
+//   KeyedStrands strands(pool);
+//   strands.post(accountId, [=]() {...});
+class KeyedStrands
+{
+    public:
+        explicit KeyedStrands(ThreadPool& pool, size_t count = 256);
+
+        Strand& at(size_t key) { return *strands_[slot(key)]; }
+
+        template <typename Key>
+        Strand& operator[](const Key& key) { return at(std::hash<Key>()(key)); }
+
+        template <typename Key, typename Func>
+        void post(const Key& key, Func&& func)
+        {
+            (*this)[key].post(std::forward<Func>(func));
+        }
+
+        template <typename Key, typename Func, typename... Args>
+        auto submit(const Key& key, Func&& func, Args&&...args) -> std::future<decltype(func(args...))>
+        {
+            return (*this)[key].submit(std::forward<Func>(func), std::forward<Args>(args)...);
+        }
+
+        size_t size() const { return strands_.size(); }
+
+    private:
+        // std::hash对整数是恒等映射 乘法哈希打散连续的key
+        size_t slot(size_t key) const { return (key * 0x9E3779B97F4A7C15ull >> 32) % strands_.size(); }
+
+        std::vector<std::unique_ptr<Strand>> strands_;
+};
+
+#endif
@@ -0,0 +1,269 @@
+#ifndef TASKALLOCATOR_H__
+#define TASKALLOCATOR_H__
+
+#include <cstddef>
+#include <new>
+#include <mutex>
+#include <memory_resource>
+
+// 线程本地的定长内存块缓存 用于promise/future共享状态、工作窃取队列的任务节点和放不进UniqueFunction内部缓冲区的任务
+// 按64字节划分大小等级 释放的内存块放入当前线程的空闲链表 下次分配直接复用
+// 提交线程分配、工作线程释放时内存块会积累在工作线程上 本地链表超过上限后按BATCH_SIZE个一批交给全局中转站
+// 本地链表为空时先从中转站取回一批 跨线程的释放和分配每一批只需要加一次锁
+class TaskMemoryCache
+{
+    public:
+        static constexpr size_t BLOCK_ALIGN = 64;
+        static constexpr size_t MAX_BLOCK_SIZE = 512;
+        static constexpr size_t BATCH_SIZE = 32;                 // 本地链表和中转站之间一次转移的内存块数
+        static constexpr size_t MAX_LOCAL_BLOCKS = 8 * BATCH_SIZE; // 每个大小等级本地最多缓存的内存块数
+        static constexpr size_t MAX_DEPOT_BYTES = 4 * 1024 * 1024; // 每个大小等级中转站最多缓存的字节数
+
+        static void* allocate(size_t size)
+        {
+            if (size > MAX_BLOCK_SIZE)
+            {
+                return ::operator new(size);
+            }
+            if (exited())
+            {
+                // 可能由其他线程释放到缓存中 按大小等级分配
+                return ::operator new(roundUp(size));
+            }
+            FreeList& list = local().lists[index(size)];
+            if (list.head == nullptr)
+            {
+                list.head = depot(index(size)).pop();
+                list.count = list.head != nullptr ? BATCH_SIZE : 0;
+            }
+            if (list.head != nullptr)
+            {
+                Node* node = list.head;
+                list.head = node->next;
+                list.count--;
+                return node;
+            }
+            return ::operator new(roundUp(size));
+        }
+
+        static void deallocate(void* ptr, size_t size) noexcept
+        {
+            if (size > MAX_BLOCK_SIZE || exited())
+            {
+                ::operator delete(ptr);
+                return ;
+            }
+            FreeList& list = local().lists[index(size)];
+            if (list.count >= MAX_LOCAL_BLOCKS)
+            {
+                depot(index(size)).push(list.popBatch(), MAX_DEPOT_BYTES / roundUp(size) / BATCH_SIZE);
+            }
+            Node* node = static_cast<Node*>(ptr);
+            node->next = list.head;
+            list.head = node;
+            list.count++;
+        }
+
+    private:
+        struct Node
+        {
+            Node* next;
+        };
+
+        static constexpr size_t SIZE_CLASSES = MAX_BLOCK_SIZE / BLOCK_ALIGN;
+
+        struct FreeList
+        {
+            Node* head = nullptr;
+            size_t count = 0;
+
+            // 从链表头部摘下BATCH_SIZE个内存块 调用者保证count不小于BATCH_SIZE
+            Node* popBatch()
+            {
+                Node* batch = head;
+                Node* last = head;
+                for (size_t i = 1; i < BATCH_SIZE; i++)
+                {
+                    last = last->next;
+                }
+                head = last->next;
+                last->next = nullptr;
+                count -= BATCH_SIZE;
+                return batch;
+            }
+        };
+
+        static void freeChain(Node* node)
+        {
+            while (node != nullptr)
+            {
+                Node* next = node->next;
+                ::operator delete(node);
+                node = next;
+            }
+        }
+
+        // 全局中转站 保存BATCH_SIZE个内存块组成的链表 每个大小等级一个
+        struct Depot
+        {
+            std::mutex mtx;
+            Node* batches = nullptr;  // 批次之间通过每批第一个内存块之后的第二个指针相连
+            size_t count = 0;
+
+            void push(Node* batch, size_t limit)
+            {
+                {
+                    std::lock_guard<std::mutex> lock(mtx);
+                    if (count < limit)
+                    {
+                        nextBatch(batch) = batches;
+                        batches = batch;
+                        count++;
+                        return ;
+                    }
+                }
+                freeChain(batch);
+            }
+
+            Node* pop()
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                Node* batch = batches;
+                if (batch != nullptr)
+                {
+                    batches = nextBatch(batch);
+                    count--;
+                }
+                return batch;
+            }
+
+            // 内存块至少64字节 第一个指针用于批内链表 第二个指针用于连接批次
+            static Node*& nextBatch(Node* batch) { return reinterpret_cast<Node**>(batch)[1]; }
+        };
+
+        struct Cache
+        {
+            FreeList lists[SIZE_CLASSES];
+            ~Cache()
+            {
+                // 线程退出时完整的批次交给中转站 由其他线程继续使用 剩下的释放
+                exited() = true;
+                for (size_t i = 0; i < SIZE_CLASSES; i++)
+                {
+                    FreeList& list = lists[i];
+                    while (list.count >= BATCH_SIZE)
+                    {
+                        depot(i).push(list.popBatch(), MAX_DEPOT_BYTES / ((i + 1) * BLOCK_ALIGN) / BATCH_SIZE);
+                    }
+                    freeChain(list.head);
+                    list.head = nullptr;
+                    list.count = 0;
+                }
+            }
+        };
+
+        // 0字节的请求也占一个最小的内存块 保证返回的指针互不相同并且可以放入空闲链表
+        static size_t roundUp(size_t size) { return size == 0 ? BLOCK_ALIGN : (size + BLOCK_ALIGN - 1) / BLOCK_ALIGN * BLOCK_ALIGN; }
+        static size_t index(size_t size) { return size == 0 ? 0 : (size - 1) / BLOCK_ALIGN; }
+
+        static Cache& local()
+        {
+            static thread_local Cache cache;
+            return cache;
+        }
+
+        // 中转站不析构 进程退出时其他线程可能仍在释放内存块
+        static Depot& depot(size_t index)
+        {
+            static Depot* depots = new Depot[SIZE_CLASSES];
+            return depots[index];
+        }
+
+        // 线程退出时缓存已经析构 之后的分配和释放直接使用全局堆
+        static bool& exited()
+        {
+            static thread_local bool flag = false;
+            return flag;
+        }
+};
+
+// 以std::pmr::memory_resource形式使用TaskMemoryCache 超过基本对齐的请求使用全局堆
+class TaskMemoryResource : public std::pmr::memory_resource
+{
+    public:
+        static TaskMemoryResource* instance()
+        {
+            static TaskMemoryResource resource;
+            return &resource;
+        }
+
+    private:
+        void* do_allocate(size_t bytes, size_t alignment) override
+        {
+            if (alignment > alignof(std::max_align_t))
+            {
+                return ::operator new(bytes, std::align_val_t(alignment));
+            }
+            return TaskMemoryCache::allocate(bytes);
+        }
+
+        void do_deallocate(void* ptr, size_t bytes, size_t alignment) override
+        {
+            if (alignment > alignof(std::max_align_t))
+            {
+                ::operator delete(ptr, std::align_val_t(alignment));
+                return ;
+            }
+            TaskMemoryCache::deallocate(ptr, bytes);
+        }
+
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+        {
+            return this == &other;
+        }
+};
+
+// 用于std::promise(std::allocator_arg, ...)和std::allocate_shared的标准分配器
+// resource为nullptr时直接使用TaskMemoryCache 否则从指定的memory_resource分配
+template <typename T>
+class TaskAllocator
+{
+    public:
+        using value_type = T;
+
+        TaskAllocator(std::pmr::memory_resource* resource = nullptr) noexcept : resource_(resource) {}
+        template <typename U>
+        TaskAllocator(const TaskAllocator<U>& other) noexcept : resource_(other.resource()) {}
+
+        T* allocate(size_t n)
+        {
+            if (resource_ != nullptr)
+            {
+                return static_cast<T*>(resource_->allocate(n * sizeof(T), alignof(T)));
+            }
+            static_assert(alignof(T) <= alignof(std::max_align_t), "over-aligned type is not supported");
+            return static_cast<T*>(TaskMemoryCache::allocate(n * sizeof(T)));
+        }
+
+        void deallocate(T* ptr, size_t n) noexcept
+        {
+            if (resource_ != nullptr)
+            {
+                resource_->deallocate(ptr, n * sizeof(T), alignof(T));
+                return ;
+            }
+            TaskMemoryCache::deallocate(ptr, n * sizeof(T));
+        }
+
+        std::pmr::memory_resource* resource() const noexcept { return resource_; }
+
+        template <typename U>
+        bool operator==(const TaskAllocator<U>& other) const noexcept { return resource_ == other.resource(); }
+        template <typename U>
+        bool operator!=(const TaskAllocator<U>& other) const noexcept { return resource_ != other.resource(); }
+
+    private:
+        std::pmr::memory_resource* resource_;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,68 @@
+#ifndef TASKGRAPH_H__
+#define TASKGRAPH_H__
+
+#include <vector>
+#include <memory>
+#include <functional>
+#include <atomic>
+#include <mutex>
+
+#include "threadpool.h"
+#include "poolfuture.h"
+
+// 任务依赖图(DAG) 节点的所有前驱完成后立即提交到线程池执行 不需要在任务中阻塞等待其他任务
+// 用法:
+//   TaskGraph graph;
+//   auto a = graph.addNode([]() {...});
+//   auto b = graph.addNode([]() {...});
+//   graph.addEdge(a, b);              // b在a完成后执行
+//   graph.run(pool).get();
+// 图的拓扑只在修改后检查一次 之后可以反复run 每次run使用独立的入度计数器 多个线程可以同时run
+// run期间(返回的future就绪之前)修改图抛出std::logic_error 图需要比run返回的future完成得更晚销毁
+class TaskGraph
+{
+    public:
+        using NodeId = size_t;
+
+        TaskGraph() : prepared_(false), acyclic_(false), activeRuns_(0) {}
+        TaskGraph(const TaskGraph&) = delete;
+        TaskGraph& operator=(const TaskGraph&) = delete;
+
+        // 添加一个节点 返回节点编号
+        // 同一个图多次run重叠时节点函数会被并发调用
+        NodeId addNode(std::function<void()> work);
+
+        // from完成后才执行to
+        void addEdge(NodeId from, NodeId to);
+
+        size_t size() const { return nodes_.size(); }
+
+        // 执行一次整个图 所有节点完成后返回的future就绪
+        // 有节点抛出异常时 还没开始的节点不再执行 future得到第一个异常
+        // 图中有环时返回保存std::logic_error的future
+        PoolFuture<void> run(ThreadPool& pool);
+
+    private:
+        struct Node
+        {
+            std::function<void()> work;
+            std::vector<NodeId> successors;
+            int predecessors = 0;
+        };
+        struct Run;
+
+        // 修改后第一次run时计算入口节点并检查是否有环 调用者持有prepareMtx_
+        void prepare();
+        // 还有run没有完成时抛出std::logic_error
+        void checkIdle() const;
+        static void execute(std::shared_ptr<Run> run, NodeId id);
+
+        std::vector<Node> nodes_;
+        std::vector<NodeId> roots_;
+        bool prepared_;
+        bool acyclic_;
+        std::mutex prepareMtx_;             // 同时run时只有一个线程执行prepare
+        mutable std::atomic_int activeRuns_; // 还没有完成的run的数量
+};
+
+#endif
@@ -11,7 +11,31 @@
 #include <functional>
 #include <unordered_map>
 #include <future>
-#include <iostream>
+#include <tuple>
+#include <optional>
+#include <stdexcept>
+#include <string>
+
+#include "wsdeque.h"
+#include "mpmcqueue.h"
+#include "ringqueue.h"
+#include "uniquefunction.h"
+#include "taskallocator.h"
+#include "prioritytaskqueue.h"
+#include "fairtaskqueue.h"
+#include "parker.h"
+#include "poolstats.h"
+#include "tracer.h"
+#include "topology.h"
+#include "timingwheel.h"
+#include "logger.h"
+#include "cancellation.h"
+
+// C++20编译时提供协程支持 见coro.h
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#include <coroutine>
+#define THREADPOOL_HAS_COROUTINES 1
+#endif
 
 // 线程模式
 enum PoolMode
@@ -20,6 +44,97 @@ enum PoolMode
     MODE_CACHED  // 动态线程数
 };
 
+// 任务调度模式
+enum SchedMode
+{
+    SCHED_SHARED_QUEUE,   // 所有线程共享一个加锁的任务队列
+    SCHED_WORK_STEALING,  // 每个线程拥有自己的双端队列 空闲时从注入队列或其他线程窃取任务
+    SCHED_LOCKFREE_QUEUE  // 所有线程共享一个有界无锁环形队列 只有线程需要睡眠时才使用条件变量
+};
+
+// 任务队列满时的处理策略
+// 作用于submitTask、submitTaskOnNode、submitBatch、submitRange、submitAsync 以及post和co_await schedule()
+// post和schedule()没有future可以报告失败 被拒绝时总是在提交线程上执行
+enum OverflowPolicy
+{
+    OVERFLOW_BLOCK,        // 等待腾出位置 超过提交超时(默认1秒)后拒绝
+    OVERFLOW_REJECT,       // 不等待 立即拒绝
+    OVERFLOW_CALLER_RUNS,  // 不等待 在提交线程上直接执行
+    OVERFLOW_DROP_OLDEST   // 丢弃队列中最早入队的任务为新任务腾出位置 优先丢弃低优先级的任务 不会丢弃比新任务优先级高的任务
+                           // 被丢弃的任务直接析构: submitTask和submitAsync的future得到broken_promise异常
+                           // post、定时任务、任务图和协程提交的任务不会被丢弃 被挤出队列时在提交新任务的线程上执行
+};
+
+// 任务被拒绝时future中保存的异常
+class TaskRejectedError : public std::runtime_error
+{
+    public:
+        TaskRejectedError() : std::runtime_error("task queue is full, task rejected") {}
+};
+
+// submitTask的可选参数
+struct TaskOptions
+{
+    Priority priority = PRIORITY_NORMAL;
+    CancellationToken token;     // 开始执行前已经取消的任务不执行
+    // 到这个时刻还没有开始执行的任务不执行 默认没有截止时间
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+    const char* label = nullptr; // 追踪中显示的任务名 需要在写出trace之前一直有效 见tracer.h
+};
+
+// 任务组的句柄 由ThreadPool::createTaskGroup返回 默认构造的句柄无效
+struct TaskGroup
+{
+    int id = -1;
+    bool valid() const { return id >= 0; }
+};
+
+// 执行函数并把返回值或异常写入promise
+template <typename R, typename F>
+void setPromiseResult(std::promise<R>& promise, F&& func)
+{
+    try
+    {
+        promise.set_value(func());
+    }
+    catch (...)
+    {
+        promise.set_exception(std::current_exception());
+    }
+}
+
+template <typename F>
+void setPromiseResult(std::promise<void>& promise, F&& func)
+{
+    try
+    {
+        func();
+        promise.set_value();
+    }
+    catch (...)
+    {
+        promise.set_exception(std::current_exception());
+    }
+}
+
+// 执行没有future保存结果的任务(post、Strand) 异常记录到日志后丢弃 不会终止线程池线程 也不会中断后续任务
+template <typename F>
+void runDetached(F& func, const char* source)
+{
+    try
+    {
+        func();
+    }
+    catch (const std::exception& e)
+    {
+        Logger::log(LOG_ERROR, "%s task threw an exception: %s", source, e.what());
+    }
+    catch (...)
+    {
+        Logger::log(LOG_ERROR, "%s task threw an unknown exception", source);
+    }
+}
+
 // 线程类型 
 class Thread
 {
@@ -31,7 +146,7 @@ class Thread
         ulong getId() const {return threadId_;}
     private:
         ThreadFunc func_;
-        static ulong idIdx_;
+        static std::atomic<ulong> idIdx_; // 所有线程池共用 cached模式下controller线程在锁外创建线程
         ulong threadId_;
         std::packaged_task<int()> task;
 };
@@ -47,13 +162,64 @@ class ThreadPool
         void start(int initThreadSize = std::thread::hardware_concurrency());
         void setMode(PoolMode mode);
 
+        // 设置任务调度模式 需要在start之前调用
+        void setSchedMode(SchedMode mode);
+
         // 设置任务队列上限
         void setTaskQueThreshHold(int threshhold);
 
         // 设置cached模式下的线程数目上限
         void setCachedModeThreadSizeLimit(int threashHold);
 
-        using Task = std::function<void()>;
+        // 设置cached模式下线程的空闲时间上限 超过后线程退出 线程数不会低于start时的初始线程数
+        void setCachedModeIdleTimeout(std::chrono::milliseconds timeout);
+
+        // 设置cached模式下每个采样周期(1ms)最多创建的线程数
+        void setCachedModeSpawnRate(int threadsPerTick);
+
+        // 设置任务队列满时的处理策略 默认OVERFLOW_BLOCK 需要在start之前调用
+        void setOverflowPolicy(OverflowPolicy policy);
+
+        // 设置OVERFLOW_BLOCK策略下提交等待的最长时间 默认1秒 需要在start之前调用
+        void setSubmitTimeout(std::chrono::milliseconds timeout);
+
+        // 设置防饥饿阈值 低优先级任务最多连续被高优先级任务插队threshhold次 需要在start之前调用
+        void setPriorityAgingThreshHold(int threshhold);
+
+        // 设置线程每次从任务队列中最多取出的任务数 取出后依次执行 加锁和计数器更新每批一次 适合很短的任务
+        // 实际取出的数量是队列中的任务数平均分给所有线程(向上取整) 队列较短时仍然每次取一个 不会让其他线程空等
+        // 默认1(不批量) 最大DEQUEUE_BATCH_MAX 工作窃取模式下线程从自己的双端队列取任务 不需要批量 需要在start之前调用
+        void setDequeueBatch(int maxBatch);
+        static constexpr int DEQUEUE_BATCH_MAX = 64;
+
+        // 设置空闲线程的等待策略: 先自旋spinCount次 再让出CPU yieldCount次 仍然没有任务时park睡眠
+        // 都为0时没有任务立即睡眠(单核机器上的默认值) 需要在start之前调用
+        void setIdleStrategy(int spinCount, int yieldCount);
+
+        // 设置线程绑核策略 绑核后每个NUMA节点拥有自己的任务队列(共享队列模式除外)
+        // 任务优先在提交线程所在的节点上执行 需要在start之前调用
+        void setAffinity(AffinityMode mode);
+
+        // 设置任务和共享状态使用的内存资源 包括promise的共享状态、submitAsync和then的PoolFuture共享状态、工作窃取队列的任务节点、
+        // Strand的任务节点 以及submitTask/post/submitAsync/定时任务/Strand提交的放不进Task内部缓冲区的可调用对象
+        // 不包括: 带TaskOptions的任务附带的取消信息、时间轮的节点块、任务组和任务图的状态、协程帧 它们使用全局堆
+        // nullptr(默认)表示使用线程本地缓存TaskMemoryCache 资源需要比线程池和所有future活得更久 需要在start之前调用
+        void setMemoryResource(std::pmr::memory_resource* resource);
+        std::pmr::memory_resource* getMemoryResource() const {return memResource_;}
+
+        // 当前线程数
+        int getThreadSize() const {return curThreadSize_;}
+
+        // 任务队列对应的NUMA节点数 未绑核或共享队列模式下为1
+        int getNumaNodeCount() const {return nodeCount_;}
+
+        // 运行时统计快照: 每个线程执行的任务数、窃取和睡眠次数、忙碌和空闲时间 以及排队时间和执行时间的直方图
+        ThreadPoolStats stats() const;
+
+        // 只能移动的任务类型 小任务直接保存在内部缓冲区中 入队不需要分配内存
+        using Task = UniqueFunction<void()>;
+        // 定时任务和提交超时使用的时钟
+        using TimerClock = std::chrono::steady_clock;
 
 
         // 提交任务
@@ -62,61 +228,567 @@ class ThreadPool
         template <typename Func, typename... Args>
         auto submitTask(Func&& func, Args&&...args) -> std::future<decltype(func(args...))>
         {
-            // 打包用户提交的任务
+            return submitTask(PRIORITY_NORMAL, std::forward<Func>(func), std::forward<Args>(args)...);
+        }
+
+        // 按优先级提交任务 高优先级的任务先出队 低优先级的任务不会被无限推迟
+        // 队列满时按溢出策略处理 被拒绝的任务返回保存TaskRejectedError的future
+        template <typename Func, typename... Args>
+        auto submitTask(Priority priority, Func&& func, Args&&...args) -> std::future<decltype(func(args...))>
+        {
             using RTtype = decltype(func(args...));
-            auto task = std::make_shared<std::packaged_task<RTtype()>>(
-                std::bind(std::forward<Func>(func), std::forward<Args>(args)...)  //--> void operator()(){ // 绑定的函数  }
-            );
-            std::future<RTtype> result = task->get_future();
+            std::future<RTtype> result;
+            Task task = packageCall(result, std::forward<Func>(func), std::forward<Args>(args)...);
+            if (dispatch(&task, 1, priority) == 0)
+            {
+                return rejectedFuture<RTtype>();
+            }
+            return result;
+        }
 
-            std::unique_lock<std::mutex> lk(taskQueMtx_);
-            if (!notFull_.wait_for(lk, std::chrono::seconds(1), [&]() {return taskQue_.size() < taskQueMaxThreshHold_;}))
+        // 带取消token和截止时间的提交 提交时已经取消或过期的任务不入队
+        // token和截止时间随任务一起排队 线程池线程取出任务时先检查 已经取消或过期的任务不执行也不计入统计
+        // future中保存TaskCancelledError 执行期间可以通过CancellationToken::current()检查是否被取消
+        template <typename Func, typename... Args>
+        auto submitTask(const TaskOptions& options, Func&& func, Args&&...args) -> std::future<decltype(func(args...))>
+        {
+            using RTtype = decltype(func(args...));
+            TaskControl control{options.token, options.deadline};
+            if (const char* reason = checkCancelled(control))
             {
-                std::cerr << "task queue is full, submit task fail, retry later." << std::endl;
-                auto task = std::make_shared<std::packaged_task<RTtype()>>(
-                    []() ->RTtype {return RTtype();}
-                );
-                (*task)();
-                return task->get_future();
+                return cancelledFuture<RTtype>(reason);
             }
+            std::future<RTtype> result;
+            Task task = packageTask(result,
+                [func = std::forward<Func>(func), args = std::make_tuple(std::forward<Args>(args)...)]() mutable -> RTtype {
+                    throwIfCancelled();
+                    return std::apply(func, args);
+                });
+            Tracer::LabelScope label(options.label);
+            ControlScope scope(&control);
+            if (dispatch(&task, 1, options.priority) == 0)
+            {
+                return rejectedFuture<RTtype>();
+            }
+            return result;
+        }
 
-            // taskQue_.push(task); 
-            taskQue_.emplace([task]() {
-                (*task)(); // 线程池能接收的task是void() 所以需要封装一层
-            });
+        // 创建任务组 多个租户共用一个线程池时每个租户一个组
+        // 组之间按权重公平调度(差额轮转): 都有积压时 各组执行的任务数之比等于权重之比
+        // 每个组有自己的队列上限maxQueued(为0时等于任务队列上限) 一个组的积压不会占满其他组的位置
+        // 分组任务和未分组任务轮流执行 组内按提交顺序执行 不区分优先级 stats().groups[group.id]为组的统计
+        TaskGroup createTaskGroup(const std::string& name, int weight = 1, size_t maxQueued = 0);
+
+        // 提交到任务组 组的队列满时按溢出策略处理 被拒绝的任务返回保存TaskRejectedError的future
+        // 无效的组按未分组任务提交
+        template <typename Func, typename... Args>
+        auto submitTask(TaskGroup group, Func&& func, Args&&...args) -> std::future<decltype(func(args...))>
+        {
+            using RTtype = decltype(func(args...));
+            std::future<RTtype> result;
+            Task task = packageCall(result, std::forward<Func>(func), std::forward<Args>(args)...);
+            if (!dispatchGroup(group, task))
+            {
+                return rejectedFuture<RTtype>();
+            }
+            return result;
+        }
 
-            taskSize_++;
+        // 不等待的提交 队列满时返回std::nullopt 不受溢出策略影响
+        template <typename Func, typename... Args>
+        auto trySubmit(Func&& func, Args&&...args) -> std::optional<std::future<decltype(func(args...))>>
+        {
+            std::future<decltype(func(args...))> result;
+            Task task = packageCall(result, std::forward<Func>(func), std::forward<Args>(args)...);
+            if (pushTasks(&task, 1, TimerClock::duration::zero(), false) == 0)
+            {
+                rejectedTasks_.fetch_add(1, std::memory_order_relaxed);
+                return std::nullopt;
+            }
+            return result;
+        }
+
+        // 队列满时最多等待到deadline 仍然放不下时返回保存TaskRejectedError的future 不受溢出策略影响
+        template <typename Func, typename... Args>
+        auto submitTaskUntil(TimerClock::time_point deadline, Func&& func, Args&&...args) -> std::future<decltype(func(args...))>
+        {
+            using RTtype = decltype(func(args...));
+            std::future<RTtype> result;
+            Task task = packageCall(result, std::forward<Func>(func), std::forward<Args>(args)...);
+            if (pushTasks(&task, 1, deadline - TimerClock::now(), false) == 0)
+            {
+                rejectedTasks_.fetch_add(1, std::memory_order_relaxed);
+                return rejectedFuture<RTtype>();
+            }
+            return result;
+        }
 
-            notEmpty_.notify_all();
+        template <typename Rep, typename Period, typename Func, typename... Args>
+        auto submitTaskFor(std::chrono::duration<Rep, Period> timeout, Func&& func, Args&&...args) -> std::future<decltype(func(args...))>
+        {
+            return submitTaskUntil(TimerClock::now() + std::chrono::duration_cast<TimerClock::duration>(timeout),
+                std::forward<Func>(func), std::forward<Args>(args)...);
+        }
 
-            // cached模式下 当前任务数大于空闲线程数并且当前已经创建的线程总数没有超过设定的阈值 就创建一个新的线程
-            if (poolMode_ == MODE_CACHED && taskQue_.size() > idleThreadSize_ && curThreadSize_ < threadSizeThreshHold_)
-            {   
-                auto ptr = std::make_unique<Thread>(std::bind(&ThreadPool::threadFunc, this, std::placeholders::_1));
-                ulong id = ptr->getId();
-                std::cout << "create new thread, id = " << id << std::endl;
-                threads_[id] = std::move(ptr);
-                threads_[id]->start();
-                idleThreadSize_ ++;
-                curThreadSize_ ++;
+        // 提交到指定NUMA节点的任务队列 优先由该节点上的线程执行 其他节点空闲时仍然可以取走
+        template <typename Func, typename... Args>
+        auto submitTaskOnNode(int node, Func&& func, Args&&...args) -> std::future<decltype(func(args...))>
+        {
+            using RTtype = decltype(func(args...));
+            std::future<RTtype> result;
+            Task task = packageCall(result, std::forward<Func>(func), std::forward<Args>(args)...);
+            if (dispatch(&task, 1, PRIORITY_NORMAL, node) == 0)
+            {
+                return rejectedFuture<RTtype>();
             }
             return result;
         }
 
+        // 批量提交[first, last)中的可调用对象 所有任务在一次加锁内入队 最多唤醒min(任务数, 空闲线程数)个线程
+        template <typename InputIt>
+        auto submitBatch(InputIt first, InputIt last) -> std::vector<std::future<decltype((*first)())>>
+        {
+            using RTtype = decltype((*first)());
+            std::vector<std::future<RTtype>> results;
+            std::vector<Task> tasks;
+            for (; first != last; ++first)
+            {
+                results.emplace_back();
+                tasks.emplace_back(packageTask(results.back(), *first));
+            }
+            finishBatch(tasks, results);
+            return results;
+        }
+
+        // 带取消token和截止时间的批量提交 所有任务共用options 检查方式同submitTask(options, ...)
+        template <typename InputIt>
+        auto submitBatch(const TaskOptions& options, InputIt first, InputIt last) -> std::vector<std::future<decltype((*first)())>>
+        {
+            using RTtype = decltype((*first)());
+            std::vector<std::future<RTtype>> results;
+            TaskControl control{options.token, options.deadline};
+            if (const char* reason = checkCancelled(control))
+            {
+                for (; first != last; ++first)
+                {
+                    results.push_back(cancelledFuture<RTtype>(reason));
+                }
+                return results;
+            }
+            std::vector<Task> tasks;
+            for (; first != last; ++first)
+            {
+                results.emplace_back();
+                tasks.emplace_back(packageTask(results.back(), [func = *first]() mutable -> RTtype {
+                    throwIfCancelled();
+                    return func();
+                }));
+            }
+            Tracer::LabelScope label(options.label);
+            ControlScope scope(&control);
+            finishBatch(tasks, results, options.priority);
+            return results;
+        }
+
+        // 批量提交count个任务 第i个任务由gen(i)生成
+        template <typename Generator>
+        auto submitRange(size_t count, Generator&& gen) -> std::vector<std::future<decltype(gen(size_t())())>>
+        {
+            using RTtype = decltype(gen(size_t())());
+            std::vector<std::future<RTtype>> results(count);
+            std::vector<Task> tasks;
+            tasks.reserve(count);
+            for (size_t i = 0; i < count; i++)
+            {
+                tasks.emplace_back(packageTask(results[i], gen(i)));
+            }
+            finishBatch(tasks, results);
+            return results;
+        }
+
+
+
+        // 提交不需要返回值的任务 不创建future 按溢出策略没能入队时在当前线程直接执行 保证任务一定会被执行
+        // 任务抛出的异常没有地方保存 记录到日志后丢弃
+        template <typename Func>
+        void post(Func&& func, Priority priority = PRIORITY_NORMAL)
+        {
+            Task task(std::allocator_arg, memResource_, [func = std::forward<Func>(func)]() mutable {
+                runDetached(func, "posted");
+            });
+            MustRunScope mustRun;
+            if (pushWithPolicy(&task, 1, priority) == 0)
+            {
+                callerRunsTasks_.fetch_add(1, std::memory_order_relaxed);
+                task();
+            }
+        }
+
+        // 带取消token和截止时间的post 提交时或者取出时已经取消或过期的任务直接丢弃
+        template <typename Func>
+        void post(const TaskOptions& options, Func&& func)
+        {
+            TaskControl control{options.token, options.deadline};
+            if (checkCancelled(control) != nullptr) return;
+            Task task(std::allocator_arg, memResource_, [func = std::forward<Func>(func)]() mutable {
+                if (cancelReason_ == nullptr) runDetached(func, "posted");
+            });
+            Tracer::LabelScope label(options.label);
+            ControlScope scope(&control);
+            MustRunScope mustRun;
+            if (pushWithPolicy(&task, 1, options.priority) == 0)
+            {
+                callerRunsTasks_.fetch_add(1, std::memory_order_relaxed);
+                runInline(task);
+            }
+        }
+
+        // 按溢出策略提交一批已经打包好的任务 返回入队或者在提交线程上执行了的任务数
+        // 没有处理的任务(被拒绝)留在tasks的末尾 由调用者通知各自的future 用于submitAsync等组合接口
+        size_t dispatch(Task* tasks, size_t count, Priority priority = PRIORITY_NORMAL, int node = -1);
+
+        // 等待future就绪 std::future和std::shared_future都可以 之后由调用者get
+        // 在本线程池的线程上调用时 等待期间执行队列中的其他任务 不会因为所有线程都在等待子任务而死锁
+        // 递归分治的任务可以在固定数量的线程上运行 工作窃取模式下优先执行本线程刚提交的子任务
+        template <typename Future>
+        void wait(const Future& future)
+        {
+            helpUntil([&]() {return future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;},
+                      [&]() {future.wait_for(HELP_WAIT_INTERVAL);});
+            future.wait();
+        }
+
+        // 在本线程池的线程上执行队列中的任务直到ready()返回true 队列为空时调用idle()短暂等待
+        // 不在本线程池的线程上时直接返回 由调用者自己阻塞等待
+        template <typename Ready, typename Idle>
+        void helpUntil(Ready&& ready, Idle&& idle)
+        {
+            if (!isWorkerThread()) return;
+            while (!ready())
+            {
+                if (!runPendingTask())
+                {
+                    idle();
+                }
+            }
+        }
+
+        // 当前线程是否是本线程池的线程
+        bool isWorkerThread() const { return curPool_ == this; }
+
+        // 等待期间队列为空时每次最多阻塞的时间 之后重新检查队列
+        static constexpr std::chrono::microseconds HELP_WAIT_INTERVAL{100};
 
+        // 延迟和周期任务 由一个定时线程推进时间轮 到期后像post一样放入任务队列 等待期间不占用线程池线程
+        // 精度为1ms 任务不会早于指定时间执行 线程池析构时还没到期的任务直接丢弃
+        // 线程池还没有start时返回无效的TimerId
+
+        template <typename Func>
+        TimerId submitAt(TimerClock::time_point when, Func&& func)
+        {
+            return addTimer(when, Task(std::allocator_arg, memResource_, std::forward<Func>(func)), TimerClock::duration::zero());
+        }
+
+        template <typename Rep, typename Period, typename Func>
+        TimerId submitAfter(std::chrono::duration<Rep, Period> delay, Func&& func)
+        {
+            return submitAt(TimerClock::now() + std::chrono::duration_cast<TimerClock::duration>(delay), std::forward<Func>(func));
+        }
+
+        // 第一次在period之后执行 之后每隔period执行一次 上一次还没执行完时跳过这一次
+        template <typename Rep, typename Period, typename Func>
+        TimerId submitEvery(std::chrono::duration<Rep, Period> period, Func&& func)
+        {
+            auto interval = std::chrono::duration_cast<TimerClock::duration>(period);
+            return addTimer(TimerClock::now() + interval, Task(std::allocator_arg, memResource_, std::forward<Func>(func)), interval);
+        }
+
+        // 取消还没有到期的定时任务 周期任务取消后不再执行(已经放入任务队列的那一次仍会执行) 返回是否取消成功
+        bool cancelTimer(TimerId id);
+
+#ifdef THREADPOOL_HAS_COROUTINES
+        // co_await pool.schedule() 挂起当前协程 由线程池线程恢复执行
+        // 协程句柄直接作为任务入队 不创建future 队列满(等待超时)时在当前线程继续执行
+        class ScheduleAwaiter
+        {
+            public:
+                ScheduleAwaiter(ThreadPool* pool, Priority priority) : pool_(pool), priority_(priority) {}
+                bool await_ready() const noexcept { return false; }
+                bool await_suspend(std::coroutine_handle<> handle)
+                {
+                    // 入队后协程可能立即在其他线程恢复并销毁本对象 之后不能再访问成员
+                    ThreadPool* pool = pool_;
+                    Task task([handle]() {handle.resume();});
+                    MustRunScope mustRun;
+                    return pool->pushWithPolicy(&task, 1, priority_) == 1;
+                }
+                void await_resume() const noexcept {}
+            private:
+                ThreadPool* pool_;
+                Priority priority_;
+        };
+
+        ScheduleAwaiter schedule(Priority priority = PRIORITY_NORMAL) { return ScheduleAwaiter(this, priority); }
+#endif
+
+        // 批量提交不需要返回值的任务 第i个任务由gen(i)生成 不创建future
+        // 队列满时不等待 返回成功入队的任务数 没能入队的任务直接丢弃
+        template <typename Generator>
+        size_t tryPostRange(size_t count, Generator&& gen)
+        {
+            std::vector<Task> tasks;
+            tasks.reserve(count);
+            for (size_t i = 0; i < count; i++)
+            {
+                tasks.emplace_back(gen(i));
+            }
+            return pushTasks(tasks.data(), tasks.size(), TimerClock::duration::zero(), false);
+        }
 
         ThreadPool(const ThreadPool&) = delete;
         ThreadPool& operator=(const ThreadPool&) = delete;
 
     private:
+        // 任务组的名字和计数器 创建后地址不变
+        struct GroupInfo
+        {
+            explicit GroupInfo(const std::string& n) : name(n) {}
+            std::string name;
+            std::atomic<uint64_t> submitted{0};
+            std::atomic<uint64_t> executed{0};
+            std::atomic<uint64_t> rejected{0};
+            std::atomic<uint64_t> dropped{0};
+            GroupStats stats;
+        };
+
+        // 取消token和截止时间 由TaskOptions提交的任务带着它排队
+        struct TaskControl
+        {
+            CancellationToken token;
+            TimerClock::time_point deadline;
+            // 已经取消或者超过截止时间时返回原因 否则返回nullptr
+            const char* cancelReason() const
+            {
+                if (token.isCancelled()) return "task cancelled";
+                if (deadline != TimerClock::time_point::max() && TimerClock::now() > deadline) return "task deadline exceeded";
+                return nullptr;
+            }
+        };
+
+        // 作用域内当前线程提交的任务带上control 由TaskOptions的提交接口设置 入队时复制到QueuedTask
+        class ControlScope
+        {
+            public:
+                explicit ControlScope(const TaskControl* control) : prev_(submitControl_) { submitControl_ = control; }
+                ~ControlScope() { submitControl_ = prev_; }
+                ControlScope(const ControlScope&) = delete;
+                ControlScope& operator=(const ControlScope&) = delete;
+            private:
+                const TaskControl* prev_;
+        };
+
+        // 作用域内当前线程提交的任务不能被OVERFLOW_DROP_OLDEST丢弃 用于post、schedule()和定时任务
+        // 这些任务没有future可以报告丢弃 任务图和协程依赖它们一定执行
+        class MustRunScope
+        {
+            public:
+                MustRunScope() : prev_(submitMustRun_) { submitMustRun_ = true; }
+                ~MustRunScope() { submitMustRun_ = prev_; }
+                MustRunScope(const MustRunScope&) = delete;
+                MustRunScope& operator=(const MustRunScope&) = delete;
+            private:
+                bool prev_;
+        };
+
+        // 队列中保存的任务 统计开启时附带入队时间
+        struct QueuedTask : TaskStamp, TraceStamp
+        {
+            Task task;
+            GroupInfo* group = nullptr; // 所属的任务组 未分组的任务为nullptr
+            std::unique_ptr<TaskControl> control; // 没有取消token和截止时间的任务为nullptr
+            bool mustRun = false;       // 被挤出队列时不丢弃 见MustRunScope
+            QueuedTask() = default;
+            QueuedTask(Task&& t, int64_t now, GroupInfo* g = nullptr) : task(std::move(t)), group(g), mustRun(submitMustRun_)
+            {
+                stamp(now);
+                traceSubmit();
+                if (submitControl_ != nullptr) control.reset(new TaskControl(*submitControl_));
+            }
+        };
+
         // 定义每个线程的任务函数 std::bind绑定到Thread中
         void threadFunc(ulong threadId);
         // 检查线程池的运行状态
         bool checkRunningState() const;
+        // 将一批任务放入任务队列 返回成功放入的任务数 tasks中前若干个会被移走
+        // 队列满时最多等待timeout(不大于0时不等待) evict为true时丢弃队列中最早的任务腾出位置
+        // node为-1时使用提交线程所在的NUMA节点
+        size_t pushTasks(Task* tasks, size_t count, TimerClock::duration timeout, bool evict,
+                         Priority priority = PRIORITY_NORMAL, int node = -1);
+        // 按溢出策略等待或者丢弃旧任务 不在提交线程上执行
+        size_t pushWithPolicy(Task* tasks, size_t count, Priority priority = PRIORITY_NORMAL, int node = -1);
+        // 按溢出策略把任务放入组的队列 返回是否入队或者在提交线程上执行了
+        bool dispatchGroup(TaskGroup group, Task& task);
+
+        // 把可调用对象和promise打包成Task promise的共享状态从memResource_分配
+        template <typename RTtype, typename Func>
+        Task packageTask(std::future<RTtype>& result, Func&& func)
+        {
+            std::promise<RTtype> promise(std::allocator_arg, TaskAllocator<char>(memResource_));
+            result = promise.get_future();
+            return Task(std::allocator_arg, memResource_, [promise = std::move(promise), func = std::forward<Func>(func)]() mutable {
+                setPromiseResult(promise, func);
+            });
+        }
+
+        // 打包用户提交的任务 参数按值保存 调用时以左值传入(与std::bind语义一致)
+        template <typename RTtype, typename Func, typename... Args>
+        Task packageCall(std::future<RTtype>& result, Func&& func, Args&&...args)
+        {
+            return packageTask(result,
+                [func = std::forward<Func>(func), args = std::make_tuple(std::forward<Args>(args)...)]() mutable -> RTtype {
+                    return std::apply(func, args);
+                });
+        }
+
+        // 已经取消或者超过截止时间时计数并返回原因 否则返回nullptr
+        const char* checkCancelled(const TaskControl& control)
+        {
+            const char* reason = control.cancelReason();
+            if (reason != nullptr) cancelledTasks_.fetch_add(1, std::memory_order_relaxed);
+            return reason;
+        }
+
+        // 带TaskOptions的任务包装在开始时调用 取出时发现已经取消的任务只为了通知future而被调用
+        static void throwIfCancelled()
+        {
+            if (cancelReason_ != nullptr) throw TaskCancelledError(cancelReason_);
+        }
+
+        // 取出的任务已经取消或过期时不执行 只调用包装通知future 返回true
+        bool skipCancelled(QueuedTask& item);
+        // 执行取出的任务 带取消token的任务执行期间设置CancellationToken::current()
+        void runTask(QueuedTask& item);
+        // 在提交线程上执行没能入队的任务 同样检查当前ControlScope的token和截止时间
+        void runInline(Task& task);
+        // 处理为新任务腾出位置而挤出队列的任务 必须执行的任务在当前线程上执行 其余的丢弃 在锁外调用
+        void finishEvicted(std::vector<QueuedTask>& evicted);
+
+        template <typename RTtype>
+        static std::future<RTtype> cancelledFuture(const char* reason)
+        {
+            std::promise<RTtype> cancelled;
+            cancelled.set_exception(std::make_exception_ptr(TaskCancelledError(reason)));
+            return cancelled.get_future();
+        }
+
+        // 提交被拒绝时返回的future 保存TaskRejectedError
+        template <typename RTtype>
+        static std::future<RTtype> rejectedFuture()
+        {
+            std::promise<RTtype> rejected;
+            rejected.set_exception(std::make_exception_ptr(TaskRejectedError()));
+            return rejected.get_future();
+        }
+
+        // 批量入队 被拒绝的任务返回保存TaskRejectedError的future
+        template <typename RTtype>
+        void finishBatch(std::vector<Task>& tasks, std::vector<std::future<RTtype>>& results, Priority priority = PRIORITY_NORMAL)
+        {
+            size_t handled = dispatch(tasks.data(), tasks.size(), priority);
+            for (size_t i = handled; i < tasks.size(); i++)
+            {
+                results[i] = rejectedFuture<RTtype>();
+            }
+        }
+        // cached模式的扩容线程 根据积压的任务数和积压持续的时间创建新线程 创建线程不占用提交路径
+        void controllerFunc();
+        // 提交者发现任务数超过空闲线程数时通知扩容线程
+        void requestGrowth();
+        // 创建一个新线程并启动 不需要持有taskQueMtx_
+        void spawnThread();
+        // 空闲超时的线程退出前减少线程数 已经等于初始线程数时返回false 线程继续等待
+        bool retireThread();
+        // 定时任务 第一次使用时启动定时线程
+        TimerId addTimer(TimerClock::time_point when, Task task, TimerClock::duration period);
+        void timerFunc();
+        uint64_t timerTick(TimerClock::time_point when) const;
+        // 获取一个任务 工作窃取模式下依次尝试自己的双端队列、注入队列和其他线程
+        bool findTask(QueuedTask& task);
+        // 获取一个未分组的任务
+        bool findUngroupedTask(QueuedTask& task);
+        bool popGroupTask(QueuedTask& task);
+        // 分组任务执行完成后更新组的统计
+        void groupTaskFinished(GroupInfo& group, int64_t start, int64_t end);
+        // 获取最多max个任务 返回取出的数量 数量按队列长度和线程数自适应(见setDequeueBatch)
+        size_t findTasks(QueuedTask* tasks, size_t max);
+        // 等待future的线程池线程取出并执行一个任务 先执行本线程批量取出后还没执行的任务 队列为空时返回false
+        bool runPendingTask();
+        bool popSharedTask(QueuedTask& task);
+        size_t popSharedTasks(QueuedTask* tasks, size_t max);
+        bool popLockFreeTask(QueuedTask& task);
+        bool popLane(int lane, QueuedTask& task);
+        bool popQueue(MpmcQueue<QueuedTask>& que, QueuedTask& task);
+        // 放入无锁队列 所有队列中的任务总数达到上限时返回false 失败时item不会被移动
+        bool pushLane(MpmcQueue<QueuedTask>& que, QueuedTask& item);
+        // 丢弃node上优先级不高于priority的最早入队的任务 优先丢弃低优先级的
+        bool evictLane(int node, Priority priority, QueuedTask& oldest);
+        // 无锁队列 每个NUMA节点每个优先级一个
+        MpmcQueue<QueuedTask>& laneQue(int node, int lane) { return *lfQues_[node * PRIORITY_LEVELS + lane]; }
+        // 提交的任务进入哪个NUMA节点的队列
+        int submitNode(int hint) const;
+        bool stealTask(int self, QueuedTask& task);
+        // 工作窃取队列中的任务节点 从memResource_分配 通常由其他线程释放
+        QueuedTask* newQueuedTask(Task&& task, int64_t now);
+        void deleteQueuedTask(QueuedTask* ptr);
+        // 没有任务时自旋、让出CPU然后park等待 返回false表示线程应该退出
+        bool waitForTask(ulong threadId, Parker& parker, std::chrono::high_resolution_clock::time_point& lastTime);
+        // 从睡眠列表中移除自己 返回true表示已经被唤醒者取走(并消耗了这次唤醒)
+        bool cancelPark(Parker& parker);
+        // 唤醒count个park的线程 all为false时扣除正在自旋的线程数 优先唤醒node上的线程
+        void wakeWorkers(size_t count, bool all = false, int node = -1);
+        // 线程退出前回收资源
+        void exitThread(ulong threadId, bool idleTimeout);
+        // 线程启动时领取一个统计槽位 退出时归还 槽位中的计数保留
+        WorkerStats* claimStats(int& slot);
+        // 按绑核策略把线程绑定到第slot个CPU上
+        void placeThread(int slot);
+        void releaseStats(WorkerStats* stats);
+
+
+        // 工作窃取模式下每个线程私有的数据
+        struct Worker
+        {
+            ThreadPool* pool;
+            int index;
+            WorkStealingDeque<QueuedTask*> deque; // 本线程提交的子任务
+            uint32_t seed;                  // 随机选择窃取对象
+        };
+        static thread_local ThreadPool* curPool_; // 当前线程所属的线程池 非线程池线程为nullptr
+        static thread_local Worker* curWorker_; // 当前线程所属的Worker 非线程池线程为nullptr
+        static thread_local WorkerStats* curStats_; // 当前线程的统计 非线程池线程为nullptr
+        // 线程批量取出的任务 next之前的已经开始执行 之后的不在任何队列中 只能由本线程执行
+        struct PendingBatch
+        {
+            QueuedTask* tasks;
+            size_t next;
+            size_t count;
+        };
+        static thread_local PendingBatch* curBatch_; // 当前线程正在执行的一批任务 非线程池线程为nullptr
+        static thread_local int curNode_;           // 当前线程所在的NUMA节点 非线程池线程为-1
+        static thread_local const TaskControl* submitControl_; // 当前线程正在提交的任务的取消token 见ControlScope
+        static thread_local const char* cancelReason_;         // 正在通知一个已经取消的任务 见throwIfCancelled
+        static thread_local bool submitMustRun_;               // 当前线程正在提交的任务不能丢弃 见MustRunScope
 
+        struct ParkedThread
+        {
+            Parker* parker;
+            int node;
+        };
 
     private:
         PoolMode poolMode_;   // 当前线程池的工作模式
+        SchedMode schedMode_; // 当前线程池的调度模式
 
        
         std::unordered_map<ulong, std::unique_ptr<Thread>> threads_; // 线程列表
@@ -125,17 +797,79 @@ class ThreadPool
         std::atomic_int idleThreadSize_;   // 空闲线程的个数
         std::atomic_int curThreadSize_; // 当前线程数
 
-        std::queue<Task> taskQue_; // 任务队列
+        PriorityTaskQueue<QueuedTask> taskQue_; // 任务队列 每个优先级一个队列
         std::atomic_uint taskSize_;  // 任务数量
         int taskQueMaxThreshHold_;      // 任务数量上限
+        int agingThreshHold_;           // 低优先级任务最多连续被插队的次数
+        int dequeueBatch_;              // 线程每次最多取出的任务数
+
+        // 任务组 所有调度模式下都由一把锁保护 与未分组任务的队列互不影响
+        mutable std::mutex groupMtx_;
+        std::condition_variable groupNotFull_;          // 组的队列未满
+        FairTaskQueue<QueuedTask> groupQue_;            // 由groupMtx_保护
+        std::vector<std::unique_ptr<GroupInfo>> groups_; // 由groupMtx_保护 下标为组号
+        std::atomic_uint groupTaskSize_;                // groupQue_中的任务数 也计入taskSize_
+        int groupFullWaiters_;                          // 等待在groupNotFull_上的提交者数量 由groupMtx_保护
 
         std::mutex taskQueMtx_; 
         std::condition_variable notFull_;  // 任务队列未满
-        std::condition_variable notEmpty_; // 任务队列不空
         std::atomic_bool isPoolRunning_;   // 线程启动状态
 
         std::condition_variable exitCond_; // 等待线程池中所有资源回收
 
+        // cached模式的扩容
+        std::thread controller_;
+        Parker controllerParker_;
+        std::atomic_bool growPending_;             // 已经通知过扩容线程 避免每次提交都unpark
+        std::chrono::milliseconds idleTimeout_;
+        int spawnPerTick_;
+
+        // 定时任务
+        std::mutex timerMtx_;
+        std::unique_ptr<TimingWheel> wheel_;       // 由timerMtx_保护
+        std::thread timerThread_;
+        Parker timerParker_;
+        TimerClock::time_point timerEpoch_;        // 时间轮的第0个tick
+        uint64_t timerWakeTick_;                   // 定时线程下一次醒来的tick 由timerMtx_保护
+
+        // 无锁队列模式的任务队列 工作窃取模式下作为外部线程提交任务的注入队列 每个NUMA节点每个优先级一个队列
+        std::vector<std::unique_ptr<MpmcQueue<QueuedTask>>> lfQues_;
+        std::atomic_int laneTaskSize_;                 // lfQues_中的任务总数 所有队列共用taskQueMaxThreshHold_的上限
+        std::atomic_int fullWaiters_;                  // 因队列满而等待在notFull_上的提交者数量
+
+        // 工作窃取模式
+        std::vector<std::unique_ptr<Worker>> workers_; // 每个线程一个槽位 数量为线程数上限
+        std::vector<int> freeWorkerSlots_;             // 空闲槽位 由taskQueMtx_保护
+
+        // 空闲线程
+        std::mutex idleMtx_;
+        std::vector<ParkedThread> parked_;             // park的线程 由idleMtx_保护
+        std::atomic_int sleepingThreadSize_;           // park的线程数
+        std::atomic_int spinningThreadSize_;           // 正在自旋等待任务的线程数
+        int spinCount_;
+        int yieldCount_;
+
+        // 绑核
+        AffinityMode affinityMode_;
+        std::vector<CpuTopology::Cpu> placement_;      // 第i个线程绑定的CPU
+        int nodeCount_;                                // 任务队列对应的NUMA节点数
+
+        std::pmr::memory_resource* memResource_;       // nullptr表示TaskMemoryCache
+
+        // 任务队列满时的处理
+        OverflowPolicy overflowPolicy_;
+        TimerClock::duration submitTimeout_;
+        std::atomic<uint64_t> rejectedTasks_;
+        std::atomic<uint64_t> droppedTasks_;
+        std::atomic<uint64_t> callerRunsTasks_;
+        std::atomic<uint64_t> cancelledTasks_;         // 因取消或者超过截止时间而没有执行的任务数
+
+        // 运行时统计 每个线程一个槽位
+        mutable std::mutex statsMtx_;
+        std::vector<std::unique_ptr<WorkerStats>> workerStats_;
+        std::vector<bool> statsActive_;
+        std::vector<int> freeStatsSlots_;
+
 };
 
 #endif
\ No newline at end of file
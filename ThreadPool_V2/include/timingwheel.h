@@ -0,0 +1,98 @@
+#ifndef TIMINGWHEEL_H__
+#define TIMINGWHEEL_H__
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "uniquefunction.h"
+
+// 定时器编号 用于取消 默认构造的编号无效
+struct TimerId
+{
+    void* node = nullptr;
+    uint64_t seq = 0;
+    bool valid() const { return node != nullptr; }
+};
+
+// 分层时间轮 时间以tick为单位(由使用者决定tick的长度)
+// 第0层256个槽 每个槽一个tick 第1到4层各64个槽 每层一个槽覆盖下一层的一整圈
+// 插入和取消都是O(1) 推进时只有到达上一层槽的边界才把该槽中的定时器重新分配到下一层
+// 非线程安全 由使用者加锁
+class TimingWheel
+{
+    public:
+        using Task = UniqueFunction<void()>;
+
+        TimingWheel();
+        ~TimingWheel();
+        TimingWheel(const TimingWheel&) = delete;
+        TimingWheel& operator=(const TimingWheel&) = delete;
+
+        // expire时刻到期 已经过去的时刻在下一次推进时到期
+        // period大于0时为周期定时器 每次到期后在expire + period重新插入 直到被取消
+        TimerId add(uint64_t expire, Task task, uint64_t period = 0);
+
+        // 取消还没有到期的定时器 返回是否取消成功 已经到期的一次性定时器返回false
+        bool cancel(TimerId id);
+
+        // 推进到now(包含) 到期的任务追加到expired中
+        // 周期任务上一次还没执行完时跳过这一次 错过的多次只执行一次
+        void advance(uint64_t now, std::vector<Task>& expired);
+
+        // 下一次需要推进的时刻: 第0层最近的非空槽 或者需要重新分配上层槽的时刻 没有定时器时返回UINT64_MAX
+        uint64_t nextTick() const;
+
+        // 下一个要处理的tick
+        uint64_t current() const { return cur_; }
+        size_t size() const { return count_; }
+
+    private:
+        static constexpr int ROOT_BITS = 8;
+        static constexpr int LEVEL_BITS = 6;
+        static constexpr int LEVELS = 5;
+        static constexpr int ROOT_SLOTS = 1 << ROOT_BITS;
+        static constexpr int LEVEL_SLOTS = 1 << LEVEL_BITS;
+        static constexpr int SLOTS = ROOT_SLOTS + (LEVELS - 1) * LEVEL_SLOTS;
+        static constexpr uint64_t MAX_DELTA = (uint64_t(1) << (ROOT_BITS + (LEVELS - 1) * LEVEL_BITS)) - 1;
+
+        // 周期任务 多次到期共享同一个可调用对象
+        struct Periodic
+        {
+            Task func;
+            std::atomic_bool running{false};
+        };
+
+        // 侵入式双向链表 槽的表头是哨兵
+        struct Link
+        {
+            Link* prev;
+            Link* next;
+        };
+
+        struct Node : Link
+        {
+            uint64_t expire;
+            uint64_t seq;       // 每次回收加1 使旧的TimerId失效
+            uint64_t period;
+            int slot;           // 所在的槽 -1表示已经回收
+            Task task;
+            std::shared_ptr<Periodic> periodic;
+        };
+
+        void place(Node* node);
+        void unlink(Node* node);
+        void cascade(int level, int index);
+        Node* allocNode();
+        void freeNode(Node* node);
+
+        Link slots_[SLOTS];
+        uint64_t rootBits_[ROOT_SLOTS / 64];  // 第0层非空槽的位图
+        uint64_t cur_;
+        size_t count_;
+        Node* freeList_;                      // 回收的节点 地址不会失效 旧的TimerId通过seq识别
+        std::vector<std::unique_ptr<Node[]>> blocks_;
+};
+
+#endif
@@ -0,0 +1,55 @@
+#ifndef TOPOLOGY_H__
+#define TOPOLOGY_H__
+
+#include <string>
+#include <vector>
+
+// 线程绑核策略
+enum AffinityMode
+{
+    AFFINITY_NONE,     // 不绑核 由操作系统调度
+    AFFINITY_COMPACT,  // 依次占满一个NUMA节点的核(同一物理核的超线程相邻)再使用下一个节点 线程间共享缓存
+    AFFINITY_SPREAD    // 轮流分布到各个NUMA节点和各个物理核上 先用满物理核再使用超线程 最大化内存带宽
+};
+
+// CPU拓扑 从/sys/devices/system/cpu和/sys/devices/system/node读取
+// 只包含当前进程允许运行的CPU 读取失败时退化为hardware_concurrency个CPU、一个NUMA节点
+class CpuTopology
+{
+    public:
+        struct Cpu
+        {
+            int id;       // 逻辑CPU编号
+            int core;     // 物理核编号 同一个封装内唯一
+            int package;  // 物理封装(插槽)编号
+            int node;     // NUMA节点 从0开始连续编号
+        };
+
+        // 当前机器的拓扑 第一次调用时读取
+        static const CpuTopology& system();
+
+        // 从sysRoot(通常为/sys/devices/system)读取拓扑 便于在没有NUMA的机器上用构造的目录测试
+        static CpuTopology detect(const std::string& sysRoot);
+
+        const std::vector<Cpu>& cpus() const { return cpus_; }
+        int nodeCount() const { return nodeCount_; }
+
+        // 逻辑CPU所在的NUMA节点 未知的CPU返回0
+        int nodeOf(int cpu) const;
+
+        // 按策略排列的CPU顺序 第i个线程绑定到第i % size()个CPU上
+        std::vector<Cpu> placement(AffinityMode mode) const;
+
+    private:
+        std::vector<Cpu> cpus_;
+        std::vector<int> cpuNode_;  // 逻辑CPU编号 -> NUMA节点
+        int nodeCount_ = 1;
+};
+
+// 把当前线程绑定到逻辑CPU上 不支持或失败时返回false
+bool pinCurrentThread(int cpu);
+
+// 当前线程正在运行的逻辑CPU 未知时返回-1
+int currentCpu();
+
+#endif
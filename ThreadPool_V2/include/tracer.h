@@ -0,0 +1,158 @@
+#ifndef TRACER_H__
+#define TRACER_H__
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+// 任务生命周期追踪 编译时定义THREADPOOL_TRACING才启用(cmake -DTHREADPOOL_TRACING=ON) 否则所有调用都是空函数
+// 库和使用者需要使用相同的设置 运行时调用Tracer::enable(true)后开始记录
+// 每个任务记录提交、出队、开始、结束四个时间点 以及提交线程、执行线程和标签
+//   Tracer::enable(true);
+//   TaskOptions options;
+//   options.label = "parse";
+//   pool.submitTask(options, parse, buf);
+//   Tracer::writeChromeTrace("trace.json");   // 用Perfetto(ui.perfetto.dev)或chrome://tracing打开
+// 提交时间和标签保存在排队的任务上 任务结束时一次写入执行线程自己的单生产者环形缓冲区 不加锁、不做系统调用
+// x86上时间戳直接读TSC(要求invariant TSC) 输出时按steady_clock换算 每个事件只有几纳秒的开销
+// 缓冲区满时丢弃新记录并计数 长时间运行时定期调用writeChromeTrace取走记录
+#if defined(THREADPOOL_TRACING) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#define THREADPOOL_TRACE_TSC 1
+#else
+#include <chrono>
+#endif
+
+#ifdef THREADPOOL_TRACING
+
+// 提交时记录 保存在队列中的每个任务上 submitTime为0表示提交时没有开启追踪
+struct TraceStamp
+{
+    uint64_t submitTime = 0;
+    const char* label = nullptr;
+    uint32_t submitThread = 0;
+    void traceSubmit();
+};
+
+class Tracer
+{
+    public:
+        static constexpr size_t RING_SIZE = 8192;   // 每个线程缓冲区的记录数
+
+        static void enable(bool on);
+        static bool enabled() { return enabled_.load(std::memory_order_relaxed); }
+
+        // 原始时间戳 只用于比较和传回Tracer
+        static uint64_t now()
+        {
+#ifdef THREADPOOL_TRACE_TSC
+            return __rdtsc();
+#else
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+        }
+        // 没有开启追踪时返回0
+        static uint64_t timestamp() { return enabled() ? now() : 0; }
+
+        // 当前线程在trace中的编号 从1开始
+        static uint32_t threadId()
+        {
+            uint32_t id = threadId_;
+            return id != 0 ? id : registerThread();
+        }
+        // 当前线程在trace中显示的名字 name被复制
+        static void setThreadName(const char* name);
+
+        // 作用域内当前线程提交的任务使用这个标签 label为nullptr时保持外层的标签
+        // label需要在写出trace之前一直有效 一般使用字符串字面量
+        class LabelScope
+        {
+            public:
+                explicit LabelScope(const char* label) : prev_(label_) { if (label != nullptr) label_ = label; }
+                ~LabelScope() { label_ = prev_; }
+                LabelScope(const LabelScope&) = delete;
+                LabelScope& operator=(const LabelScope&) = delete;
+            private:
+                const char* prev_;
+        };
+        static const char* currentLabel() { return label_; }
+
+        // 任务执行完 start为开始时间(为0时不记录) dequeued为出队时间 返回结束时间作为下一个任务的开始时间
+        static uint64_t taskFinished(const TraceStamp& stamp, uint64_t dequeued, uint64_t start)
+        {
+            if (start == 0) return timestamp();
+            uint64_t end = now();
+            if (stamp.submitTime != 0 && dequeued != 0)
+            {
+                record(stamp, dequeued, start, end);
+            }
+            return end;
+        }
+
+        // 瞬时事件 如创建线程、线程退出 name需要一直有效
+        static void instant(const char* name)
+        {
+            if (enabled()) recordInstant(name);
+        }
+
+        // 取出所有缓冲区中的记录 写成Chrome trace_event格式的JSON 每次调用输出一个完整的文件
+        static bool writeChromeTrace(const char* path);
+        static void writeChromeTrace(FILE* out);
+
+        // 因缓冲区满而丢弃的记录数
+        static uint64_t droppedCount();
+
+    private:
+        static uint32_t registerThread();
+        static void record(const TraceStamp& stamp, uint64_t dequeued, uint64_t start, uint64_t end);
+        static void recordInstant(const char* name);
+
+        static inline std::atomic_bool enabled_{false};
+        static inline thread_local uint32_t threadId_ = 0;
+        static inline thread_local const char* label_ = nullptr;
+};
+
+inline void TraceStamp::traceSubmit()
+{
+    if (Tracer::enabled())
+    {
+        submitTime = Tracer::now();
+        label = Tracer::currentLabel();
+        submitThread = Tracer::threadId();
+    }
+}
+
+#else
+
+struct TraceStamp
+{
+    void traceSubmit() {}
+};
+
+class Tracer
+{
+    public:
+        static void enable(bool) {}
+        static bool enabled() { return false; }
+        static constexpr uint64_t timestamp() { return 0; }
+        static void setThreadName(const char*) {}
+
+        class LabelScope
+        {
+            public:
+                explicit LabelScope(const char*) {}
+        };
+        static const char* currentLabel() { return nullptr; }
+
+        static constexpr uint64_t taskFinished(const TraceStamp&, uint64_t, uint64_t) { return 0; }
+        static void instant(const char*) {}
+
+        static bool writeChromeTrace(const char*) { return false; }
+        static void writeChromeTrace(FILE*) {}
+        static uint64_t droppedCount() { return 0; }
+};
+
+#endif
+
+#endif
@@ -0,0 +1,203 @@
+#ifndef UNIQUEFUNCTION_H__
+#define UNIQUEFUNCTION_H__
+
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <type_traits>
+#include <functional>
+#include <memory>
+#include <memory_resource>
+
+#include "taskallocator.h"
+
+// 只能移动的类型擦除函数对象 可以保存std::packaged_task这类不可拷贝的可调用对象
+// 小于InlineSize的可调用对象直接保存在内部缓冲区中 不需要分配堆内存
+// 更大的对象从构造时指定的memory_resource分配 没有指定时从TaskMemoryCache分配
+template <typename Signature, size_t InlineSize = 64>
+class UniqueFunction;
+
+template <typename R, typename... Args, size_t InlineSize>
+class UniqueFunction<R(Args...), InlineSize>
+{
+    public:
+        UniqueFunction() noexcept : ops_(nullptr) {}
+        UniqueFunction(std::nullptr_t) noexcept : ops_(nullptr) {}
+
+        template <typename F, typename = std::enable_if_t<!std::is_same<std::decay_t<F>, UniqueFunction>::value>>
+        UniqueFunction(F&& f) : UniqueFunction(std::allocator_arg, nullptr, std::forward<F>(f))
+        {}
+
+        // 放不进内部缓冲区的可调用对象从resource分配 resource为nullptr时使用TaskMemoryCache
+        template <typename F>
+        UniqueFunction(std::allocator_arg_t, std::pmr::memory_resource* resource, F&& f) : ops_(nullptr)
+        {
+            using Fn = std::decay_t<F>;
+            static_assert(alignof(Fn) <= alignof(std::max_align_t), "over-aligned callable is not supported");
+            if constexpr (isInline<Fn>())
+            {
+                new (&storage_) Fn(std::forward<F>(f));
+                ops_ = &InlineOps<Fn>::ops;
+            }
+            else
+            {
+                HeapSlot& slot = *reinterpret_cast<HeapSlot*>(&storage_);
+                void* mem = allocate(resource, sizeof(Fn), alignof(Fn));
+                try
+                {
+                    slot.fn = new (mem) Fn(std::forward<F>(f));
+                }
+                catch (...)
+                {
+                    deallocate(resource, mem, sizeof(Fn), alignof(Fn));
+                    throw;
+                }
+                slot.resource = resource;
+                ops_ = &HeapOps<Fn>::ops;
+            }
+        }
+
+        UniqueFunction(UniqueFunction&& other) noexcept : ops_(other.ops_)
+        {
+            if (ops_ != nullptr)
+            {
+                ops_->move(&storage_, &other.storage_);
+                other.ops_ = nullptr;
+            }
+        }
+
+        UniqueFunction& operator=(UniqueFunction&& other) noexcept
+        {
+            if (this != &other)
+            {
+                reset();
+                ops_ = other.ops_;
+                if (ops_ != nullptr)
+                {
+                    ops_->move(&storage_, &other.storage_);
+                    other.ops_ = nullptr;
+                }
+            }
+            return *this;
+        }
+
+        UniqueFunction& operator=(std::nullptr_t) noexcept
+        {
+            reset();
+            return *this;
+        }
+
+        UniqueFunction(const UniqueFunction&) = delete;
+        UniqueFunction& operator=(const UniqueFunction&) = delete;
+
+        ~UniqueFunction() { reset(); }
+
+        R operator()(Args... args)
+        {
+            if (ops_ == nullptr)
+            {
+                throw std::bad_function_call();
+            }
+            return ops_->invoke(&storage_, std::forward<Args>(args)...);
+        }
+
+        explicit operator bool() const noexcept { return ops_ != nullptr; }
+
+        // 可调用对象是否保存在内部缓冲区中
+        template <typename Fn>
+        static constexpr bool isInline()
+        {
+            return sizeof(Fn) <= InlineSize
+                && alignof(Fn) <= alignof(std::max_align_t)
+                && std::is_nothrow_move_constructible<Fn>::value;
+        }
+
+        friend bool operator==(const UniqueFunction& f, std::nullptr_t) noexcept { return !f; }
+        friend bool operator!=(const UniqueFunction& f, std::nullptr_t) noexcept { return static_cast<bool>(f); }
+
+    private:
+        using Storage = typename std::aligned_storage<InlineSize, alignof(std::max_align_t)>::type;
+
+        // 放在堆上的可调用对象 内部缓冲区中保存指针和释放它用的memory_resource
+        struct HeapSlot
+        {
+            void* fn;
+            std::pmr::memory_resource* resource;
+        };
+        static_assert(InlineSize >= sizeof(HeapSlot), "InlineSize too small for a heap pointer");
+
+        static void* allocate(std::pmr::memory_resource* resource, size_t size, size_t align)
+        {
+            if (resource != nullptr) return resource->allocate(size, align);
+            return TaskMemoryCache::allocate(size);
+        }
+
+        static void deallocate(std::pmr::memory_resource* resource, void* ptr, size_t size, size_t align) noexcept
+        {
+            if (resource != nullptr) resource->deallocate(ptr, size, align);
+            else TaskMemoryCache::deallocate(ptr, size);
+        }
+
+        // 手写的虚函数表 每种可调用对象类型一份
+        struct Ops
+        {
+            R (*invoke)(void* storage, Args&&... args);
+            void (*move)(void* dst, void* src) noexcept; // 移动到dst并析构src
+            void (*destroy)(void* storage) noexcept;
+        };
+
+        template <typename Fn>
+        struct InlineOps
+        {
+            static R invoke(void* storage, Args&&... args)
+            {
+                return (*static_cast<Fn*>(storage))(std::forward<Args>(args)...);
+            }
+            static void move(void* dst, void* src) noexcept
+            {
+                new (dst) Fn(std::move(*static_cast<Fn*>(src)));
+                static_cast<Fn*>(src)->~Fn();
+            }
+            static void destroy(void* storage) noexcept
+            {
+                static_cast<Fn*>(storage)->~Fn();
+            }
+            static constexpr Ops ops = {&invoke, &move, &destroy};
+        };
+
+        template <typename Fn>
+        struct HeapOps
+        {
+            static Fn* ptr(void* storage) { return static_cast<Fn*>(static_cast<HeapSlot*>(storage)->fn); }
+            static R invoke(void* storage, Args&&... args)
+            {
+                return (*ptr(storage))(std::forward<Args>(args)...);
+            }
+            static void move(void* dst, void* src) noexcept
+            {
+                *static_cast<HeapSlot*>(dst) = *static_cast<HeapSlot*>(src);
+            }
+            static void destroy(void* storage) noexcept
+            {
+                Fn* fn = ptr(storage);
+                fn->~Fn();
+                deallocate(static_cast<HeapSlot*>(storage)->resource, fn, sizeof(Fn), alignof(Fn));
+            }
+            static constexpr Ops ops = {&invoke, &move, &destroy};
+        };
+
+        void reset() noexcept
+        {
+            if (ops_ != nullptr)
+            {
+                ops_->destroy(&storage_);
+                ops_ = nullptr;
+            }
+        }
+
+    private:
+        Storage storage_;
+        const Ops* ops_;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,138 @@
+#ifndef WSDEQUE_H__
+#define WSDEQUE_H__
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <type_traits>
+
+// Chase-Lev 工作窃取双端队列
+// 只有拥有者线程可以调用push/pop(操作队尾bottom) 其他线程只能调用steal(操作队头top)
+// 元素需要是可平凡拷贝的类型(一般存放任务指针) 以便用原子变量读写
+template <typename T>
+class WorkStealingDeque
+{
+    static_assert(std::is_trivially_copyable<T>::value, "WorkStealingDeque element must be trivially copyable");
+
+    public:
+        explicit WorkStealingDeque(int64_t capacity = 1024) : top_(0), bottom_(0)
+        {
+            int64_t cap = 1;
+            while (cap < capacity) cap <<= 1;
+            auto array = std::make_unique<Array>(cap);
+            array_.store(array.get(), std::memory_order_relaxed);
+            garbage_.push_back(std::move(array));
+        }
+        ~WorkStealingDeque() = default;
+
+        WorkStealingDeque(const WorkStealingDeque&) = delete;
+        WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+
+        // 拥有者线程调用 放入队尾
+        void push(T item)
+        {
+            int64_t b = bottom_.load(std::memory_order_relaxed);
+            int64_t t = top_.load(std::memory_order_acquire);
+            Array* a = array_.load(std::memory_order_relaxed);
+            if (b - t > a->capacity() - 1)
+            {
+                a = grow(a, b, t);
+            }
+            a->put(b, item);
+            bottom_.store(b + 1, std::memory_order_release);
+        }
+
+        // 拥有者线程调用 从队尾取出(LIFO 缓存更友好)
+        bool pop(T& item)
+        {
+            int64_t b = bottom_.load(std::memory_order_relaxed) - 1;
+            Array* a = array_.load(std::memory_order_relaxed);
+            bottom_.store(b, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            int64_t t = top_.load(std::memory_order_relaxed);
+
+            if (t > b)
+            {
+                // 队列为空 恢复bottom
+                bottom_.store(b + 1, std::memory_order_relaxed);
+                return false;
+            }
+
+            item = a->get(b);
+            if (t == b)
+            {
+                // 只剩最后一个元素 需要和窃取者竞争
+                bool won = top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+                bottom_.store(b + 1, std::memory_order_relaxed);
+                return won;
+            }
+            return true;
+        }
+
+        // 任意线程调用 从队头窃取(FIFO) 竞争失败时返回false
+        bool steal(T& item)
+        {
+            int64_t t = top_.load(std::memory_order_acquire);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            int64_t b = bottom_.load(std::memory_order_acquire);
+
+            if (t >= b) return false;
+
+            Array* a = array_.load(std::memory_order_acquire);
+            T x = a->get(t);
+            if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            {
+                return false;
+            }
+            item = x;
+            return true;
+        }
+
+        // 近似大小 仅用于统计和调度参考
+        int64_t size() const
+        {
+            int64_t b = bottom_.load(std::memory_order_relaxed);
+            int64_t t = top_.load(std::memory_order_relaxed);
+            return b > t ? b - t : 0;
+        }
+
+        bool empty() const { return size() == 0; }
+
+    private:
+        // 环形数组 容量为2的幂
+        class Array
+        {
+            public:
+                explicit Array(int64_t cap) : cap_(cap), mask_(cap - 1), buf_(new std::atomic<T>[cap]) {}
+                int64_t capacity() const { return cap_; }
+                T get(int64_t i) const { return buf_[i & mask_].load(std::memory_order_relaxed); }
+                void put(int64_t i, T x) { buf_[i & mask_].store(x, std::memory_order_relaxed); }
+            private:
+                int64_t cap_;
+                int64_t mask_;
+                std::unique_ptr<std::atomic<T>[]> buf_;
+        };
+
+        // 扩容时旧数组可能仍被窃取者读取 因此不立即释放 随队列一起析构
+        Array* grow(Array* old, int64_t b, int64_t t)
+        {
+            auto array = std::make_unique<Array>(old->capacity() * 2);
+            for (int64_t i = t; i < b; i++)
+            {
+                array->put(i, old->get(i));
+            }
+            Array* ptr = array.get();
+            garbage_.push_back(std::move(array));
+            array_.store(ptr, std::memory_order_release);
+            return ptr;
+        }
+
+    private:
+        alignas(64) std::atomic<int64_t> top_;
+        alignas(64) std::atomic<int64_t> bottom_;
+        std::atomic<Array*> array_;
+        std::vector<std::unique_ptr<Array>> garbage_; // 只有拥有者线程会修改
+};
+
+#endif
\ No newline at end of file
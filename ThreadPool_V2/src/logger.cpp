@@ -0,0 +1,248 @@
+#include "../include/logger.h"
+#include "../include/parker.h"
+
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+const std::chrono::milliseconds DRAIN_INTERVAL(20); // 后台线程没有被唤醒时的输出间隔
+
+struct Record
+{
+    uint8_t level;
+    uint8_t len;
+    char text[Logger::MAX_MESSAGE];
+};
+
+// 单生产者单消费者环形缓冲区 生产者是注册它的线程 消费者是后台线程
+struct Ring
+{
+    alignas(64) std::atomic<size_t> head{0};   // 后台线程读取的位置
+    alignas(64) std::atomic<size_t> tail{0};   // 写日志的线程写入的位置
+    std::atomic_bool orphan{false};            // 所属线程已经退出 输出完剩余记录后释放
+    Record records[Logger::RING_SIZE];
+};
+
+struct State
+{
+    std::mutex ringsMtx;
+    std::vector<Ring*> rings;          // 由ringsMtx保护
+    std::mutex sinkMtx;
+    Logger::Sink sink;                 // 由sinkMtx保护
+    Parker parker;                     // 后台线程睡眠
+    std::atomic<uint64_t> dropped{0};
+    std::atomic<uint32_t> flushRequest{0};
+    std::atomic<uint32_t> flushDone{0};
+};
+
+// 不析构 进程退出时其他线程可能仍在写日志
+State& state()
+{
+    static State* s = new State;
+    return *s;
+}
+
+void defaultSink(LogLevel level, const char* msg, size_t len)
+{
+    FILE* out = level >= LOG_WARN ? stderr : stdout;
+    fwrite(msg, 1, len, out);
+    fputc('\n', out);
+}
+
+// 输出所有缓冲区中已有的记录 返回是否输出了记录
+bool drainOnce(State& s)
+{
+    std::vector<Ring*> rings;
+    {
+        std::lock_guard<std::mutex> lock(s.ringsMtx);
+        rings = s.rings;
+    }
+
+    bool any = false;
+    std::lock_guard<std::mutex> lock(s.sinkMtx);
+    for (Ring* ring : rings)
+    {
+        size_t head = ring->head.load(std::memory_order_relaxed);
+        size_t tail = ring->tail.load(std::memory_order_acquire);
+        for (; head != tail; head++)
+        {
+            const Record& record = ring->records[head % Logger::RING_SIZE];
+            if (s.sink) s.sink((LogLevel)record.level, record.text, record.len);
+            else defaultSink((LogLevel)record.level, record.text, record.len);
+            any = true;
+        }
+        ring->head.store(head, std::memory_order_release);
+    }
+
+    static uint64_t reported = 0;
+    uint64_t dropped = s.dropped.load(std::memory_order_relaxed);
+    if (dropped != reported)
+    {
+        char text[64];
+        int len = snprintf(text, sizeof(text), "%llu log messages dropped", (unsigned long long)(dropped - reported));
+        if (s.sink) s.sink(LOG_WARN, text, len);
+        else defaultSink(LOG_WARN, text, len);
+        reported = dropped;
+    }
+    if (!s.sink)
+    {
+        fflush(stdout);
+        fflush(stderr);
+    }
+    return any;
+}
+
+// 释放所属线程已经退出并且已经输出完的缓冲区
+void reclaimRings(State& s)
+{
+    std::lock_guard<std::mutex> lock(s.ringsMtx);
+    for (size_t i = 0; i < s.rings.size(); )
+    {
+        Ring* ring = s.rings[i];
+        if (ring->orphan.load(std::memory_order_acquire)
+            && ring->head.load(std::memory_order_relaxed) == ring->tail.load(std::memory_order_acquire))
+        {
+            delete ring;
+            s.rings[i] = s.rings.back();
+            s.rings.pop_back();
+            continue;
+        }
+        i++;
+    }
+}
+
+void drainLoop()
+{
+    State& s = state();
+    for (;;)
+    {
+        uint32_t request = s.flushRequest.load(std::memory_order_acquire);
+        drainOnce(s);
+        reclaimRings(s);
+        if (s.flushDone.load(std::memory_order_relaxed) != request)
+        {
+            s.flushDone.store(request, std::memory_order_release);
+            atomicNotifyAll(s.flushDone);
+        }
+        s.parker.parkUntil(Parker::Clock::now() + DRAIN_INTERVAL);
+    }
+}
+
+void flushAtExit()
+{
+    Logger::flush();
+}
+
+// 每个线程的缓冲区 线程退出时交给后台线程释放
+struct LocalRing
+{
+    Ring* ring = nullptr;
+    ~LocalRing()
+    {
+        exited() = true;
+        if (ring != nullptr)
+        {
+            ring->orphan.store(true, std::memory_order_release);
+        }
+    }
+
+    static bool& exited()
+    {
+        static thread_local bool flag = false;
+        return flag;
+    }
+};
+
+Ring* localRing()
+{
+    static thread_local LocalRing local;
+    if (local.ring == nullptr)
+    {
+        State& s = state();
+        Ring* ring = new Ring;
+        std::lock_guard<std::mutex> lock(s.ringsMtx);
+        static bool started = false;
+        if (!started)
+        {
+            // 第一次写日志时启动后台线程 后台线程和State一样在进程退出前一直存在
+            started = true;
+            std::thread(drainLoop).detach();
+            std::atexit(flushAtExit);
+        }
+        s.rings.push_back(ring);
+        local.ring = ring;
+    }
+    return local.ring;
+}
+
+}
+
+void Logger::write(LogLevel level, const char* fmt, ...)
+{
+    State& s = state();
+    if (LocalRing::exited())
+    {
+        // 线程的缓冲区已经交出
+        s.dropped.fetch_add(1, std::memory_order_relaxed);
+        return ;
+    }
+    Ring* ring = localRing();
+    size_t tail = ring->tail.load(std::memory_order_relaxed);
+    size_t used = tail - ring->head.load(std::memory_order_acquire);
+    if (used >= RING_SIZE)
+    {
+        s.dropped.fetch_add(1, std::memory_order_relaxed);
+        s.parker.unpark();
+        return ;
+    }
+
+    Record& record = ring->records[tail % RING_SIZE];
+    va_list args;
+    va_start(args, fmt);
+    int len = vsnprintf(record.text, MAX_MESSAGE, fmt, args);
+    va_end(args);
+    record.level = (uint8_t)level;
+    record.len = (uint8_t)(len < 0 ? 0 : (size_t)len < MAX_MESSAGE ? len : MAX_MESSAGE - 1);
+    ring->tail.store(tail + 1, std::memory_order_release);
+
+    // 缓冲区过半时提前唤醒后台线程 否则等待下一次定期输出
+    if (used + 1 >= RING_SIZE / 2)
+    {
+        s.parker.unpark();
+    }
+}
+
+void Logger::setSink(Sink sink)
+{
+    State& s = state();
+    std::lock_guard<std::mutex> lock(s.sinkMtx);
+    s.sink = std::move(sink);
+}
+
+void Logger::flush()
+{
+    State& s = state();
+    {
+        std::lock_guard<std::mutex> lock(s.ringsMtx);
+        if (s.rings.empty()) return ; // 还没有人写过日志 后台线程没有启动
+    }
+    uint32_t request = s.flushRequest.fetch_add(1, std::memory_order_acq_rel) + 1;
+    s.parker.unpark();
+    for (;;)
+    {
+        uint32_t done = s.flushDone.load(std::memory_order_acquire);
+        if ((int32_t)(done - request) >= 0) return;
+        atomicWait(s.flushDone, done);
+    }
+}
+
+uint64_t Logger::droppedCount()
+{
+    return state().dropped.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,145 @@
+#include "../include/parallel.h"
+
+#include <algorithm>
+
+ParallelLoop::ParallelLoop(size_t total, int participants, Partitioner part) :
+    total_(total),
+    participants_(participants),
+    mode_(part.mode),
+    grain_(part.grainSize),
+    chunks_(0),
+    next_(0),
+    done_(0),
+    failed_(false),
+    finished_(false)
+{
+    if (mode_ == PARTITION_STATIC)
+    {
+        // 默认每个参与者一个块
+        if (grain_ == 0)
+        {
+            grain_ = (total_ + participants_ - 1) / participants_;
+        }
+        chunks_ = (total_ + grain_ - 1) / grain_;
+        claimed_.reset(new std::atomic_bool[chunks_]);
+        for (size_t i = 0; i < chunks_; i++)
+        {
+            claimed_[i].store(false, std::memory_order_relaxed);
+        }
+        cursor_.assign(participants_, 0);
+    }
+    else if (grain_ == 0)
+    {
+        // dynamic模式每个参与者平均领取8次 guided模式的块最小可以到1/64
+        size_t div = mode_ == PARTITION_DYNAMIC ? 8 : 64;
+        grain_ = std::max<size_t>(1, total_ / (participants_ * div));
+    }
+}
+
+int ParallelLoop::participantsFor(const ThreadPool& pool, size_t total, Partitioner part)
+{
+    size_t participants = pool.getThreadSize() + 1;
+    if (part.grainSize > 0)
+    {
+        participants = std::min(participants, (total + part.grainSize - 1) / part.grainSize);
+    }
+    participants = std::min(participants, total);
+    return std::max<size_t>(1, participants);
+}
+
+bool ParallelLoop::claim(int participant, size_t& lo, size_t& hi)
+{
+    switch (mode_)
+    {
+        case PARTITION_STATIC:
+        {
+            // 先按轮次处理分给自己的块
+            size_t& round = cursor_[participant];
+            for (;;)
+            {
+                size_t chunk = participant + round * participants_;
+                if (chunk >= chunks_) break;
+                round++;
+                if (!claimed_[chunk].exchange(true, std::memory_order_relaxed))
+                {
+                    lo = chunk * grain_;
+                    hi = std::min(total_, lo + grain_);
+                    return true;
+                }
+            }
+            // 自己的块处理完后 帮助处理其他参与者还没有开始的块(例如辅助任务还在队列中排队)
+            for (size_t chunk = next_.fetch_add(1, std::memory_order_relaxed); chunk < chunks_;
+                 chunk = next_.fetch_add(1, std::memory_order_relaxed))
+            {
+                if (!claimed_[chunk].exchange(true, std::memory_order_relaxed))
+                {
+                    lo = chunk * grain_;
+                    hi = std::min(total_, lo + grain_);
+                    return true;
+                }
+            }
+            return false;
+        }
+        case PARTITION_DYNAMIC:
+        {
+            size_t start = next_.fetch_add(grain_, std::memory_order_relaxed);
+            if (start >= total_) return false;
+            lo = start;
+            hi = std::min(total_, start + grain_);
+            return true;
+        }
+        case PARTITION_GUIDED:
+        {
+            size_t start = next_.load(std::memory_order_relaxed);
+            for (;;)
+            {
+                if (start >= total_) return false;
+                size_t remaining = total_ - start;
+                size_t size = std::min(remaining, std::max(grain_, remaining / (2 * participants_)));
+                if (next_.compare_exchange_weak(start, start + size, std::memory_order_relaxed))
+                {
+                    lo = start;
+                    hi = start + size;
+                    return true;
+                }
+            }
+        }
+    }
+    return false;
+}
+
+void ParallelLoop::finish(size_t count)
+{
+    // acq_rel: 让调用线程在wait返回后能看到各个块写入的结果
+    if (done_.fetch_add(count, std::memory_order_acq_rel) + count == total_)
+    {
+        std::unique_lock<std::mutex> lk(mtx_);
+        finished_ = true;
+        finishedCond_.notify_all();
+    }
+}
+
+void ParallelLoop::wait()
+{
+    if (done_.load(std::memory_order_acquire) != total_)
+    {
+        std::unique_lock<std::mutex> lk(mtx_);
+        finishedCond_.wait(lk, [&]() {return finished_;});
+    }
+
+    std::unique_lock<std::mutex> lk(mtx_);
+    if (exception_)
+    {
+        std::rethrow_exception(exception_);
+    }
+}
+
+void ParallelLoop::setException(std::exception_ptr e)
+{
+    std::unique_lock<std::mutex> lk(mtx_);
+    if (!exception_)
+    {
+        exception_ = e;
+    }
+    failed_ = true;
+}
\ No newline at end of file
@@ -0,0 +1,73 @@
+#include "../include/poolstats.h"
+
+uint64_t HistogramSnapshot::bucketLowerBound(int bucket)
+{
+#ifndef THREADPOOL_NO_STATS
+    const int sub = LatencyHistogram::SUB_BUCKETS;
+    if (bucket < sub) return bucket;
+    int shift = bucket / sub - 1;
+    return (uint64_t)(sub + bucket % sub) << shift;
+#else
+    return bucket;
+#endif
+}
+
+uint64_t HistogramSnapshot::percentile(double p) const
+{
+    if (count_ == 0) return 0;
+    uint64_t rank = (uint64_t)(p / 100 * count_ + 0.5);
+    if (rank == 0) rank = 1;
+    if (rank > count_) rank = count_;
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < counts_.size(); i++)
+    {
+        seen += counts_[i];
+        if (seen >= rank)
+        {
+            // 桶的上界 最后一个桶用最大值代替
+            uint64_t upper = i + 1 < counts_.size() ? bucketLowerBound(i + 1) - 1 : max_;
+            return upper < max_ ? upper : max_;
+        }
+    }
+    return max_;
+}
+
+#ifndef THREADPOOL_NO_STATS
+
+void LatencyHistogram::addTo(HistogramSnapshot& snapshot) const
+{
+    if (snapshot.counts_.empty())
+    {
+        snapshot.counts_.assign(BUCKETS, 0);
+    }
+    for (int i = 0; i < BUCKETS; i++)
+    {
+        snapshot.counts_[i] += counts_[i].load(std::memory_order_relaxed);
+    }
+    snapshot.count_ += count_.load(std::memory_order_relaxed);
+    snapshot.sum_ += sum_.load(std::memory_order_relaxed);
+    uint64_t m = max_.load(std::memory_order_relaxed);
+    if (m > snapshot.max_) snapshot.max_ = m;
+}
+
+void WorkerStats::snapshot(WorkerStatsSnapshot& worker, ThreadPoolStats& total) const
+{
+    worker.tasksExecuted = tasksExecuted_.load(std::memory_order_relaxed);
+    worker.steals = steals_.load(std::memory_order_relaxed);
+    worker.parks = parks_.load(std::memory_order_relaxed);
+    worker.helped = helped_.load(std::memory_order_relaxed);
+    worker.busyNs = busyNs_.load(std::memory_order_relaxed);
+    worker.idleNs = idleNs_.load(std::memory_order_relaxed);
+
+    total.tasksExecuted += worker.tasksExecuted;
+    total.steals += worker.steals;
+    total.parks += worker.parks;
+    total.helped += worker.helped;
+    total.busyNs += worker.busyNs;
+    total.idleNs += worker.idleNs;
+    queueWait_.addTo(total.queueWait);
+    exec_.addTo(total.exec);
+}
+
+#endif
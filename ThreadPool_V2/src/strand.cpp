@@ -0,0 +1,90 @@
+#include "../include/strand.h"
+
+#include <thread>
+
+Strand::Strand(ThreadPool& pool) : pool_(pool), tail_(&stub_), size_(0), head_(&stub_)
+{}
+
+Strand::~Strand()
+{
+    while (size_.load(std::memory_order_acquire) > 0)
+    {
+        std::this_thread::yield();
+    }
+    if (head_ != &stub_)
+    {
+        freeNode(head_);
+    }
+}
+
+void Strand::enqueue(Task&& task)
+{
+    TaskAllocator<Node> alloc(pool_.getMemoryResource());
+    Node* node = new (alloc.allocate(1)) Node;
+    node->task = std::move(task);
+
+    Node* prev = tail_.exchange(node, std::memory_order_acq_rel);
+    prev->next.store(node, std::memory_order_release);
+
+    // 队列原来为空 没有正在执行或者排队的执行任务
+    if (size_.fetch_add(1, std::memory_order_acq_rel) == 0)
+    {
+        pool_.post([this]() {drain();});
+    }
+}
+
+Strand::Node* Strand::pop()
+{
+    Node* head = head_;
+    Node* next = head->next.load(std::memory_order_acquire);
+    while (next == nullptr)
+    {
+        // 生产者已经交换了tail_ 还没有链接next
+        cpuRelax();
+        next = head->next.load(std::memory_order_acquire);
+    }
+    // next成为新的哑节点 任务由调用者取走
+    head_ = next;
+    if (head != &stub_)
+    {
+        freeNode(head);
+    }
+    return next;
+}
+
+void Strand::freeNode(Node* node)
+{
+    node->~Node();
+    TaskAllocator<Node>(pool_.getMemoryResource()).deallocate(node, 1);
+}
+
+void Strand::drain()
+{
+    const Strand* prev = current_;
+    current_ = this;
+    for (int i = 0; i < STRAND_BATCH; i++)
+    {
+        Node* node = pop();
+        // 一个任务抛出异常时继续执行后面的任务 size_总是减少 否则Strand会永远停在这里
+        runDetached(node->task, "strand");
+        node->task = nullptr; // 及时释放任务捕获的资源 节点作为哑节点保留到下一次pop
+        if (size_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            current_ = prev;
+            return ;
+        }
+    }
+    current_ = prev;
+    // 还有任务 重新排到线程池队列末尾 让其他Strand和任务有机会执行
+    pool_.post([this]() {drain();});
+}
+
+KeyedStrands::KeyedStrands(ThreadPool& pool, size_t count)
+{
+    if (count == 0) count = 1;
+    strands_.reserve(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        strands_.emplace_back(new Strand(pool));
+    }
+}
@@ -0,0 +1,170 @@
+#include "../include/taskgraph.h"
+
+#include <future>
+#include <stdexcept>
+
+// 一次run的状态 由正在执行的节点共同持有
+struct TaskGraph::Run
+{
+    const TaskGraph* graph = nullptr;
+    ThreadPool* pool = nullptr;
+    std::unique_ptr<std::atomic<int>[]> pending;   // 每个节点还没完成的前驱数
+    std::atomic<size_t> remaining{0};              // 还没完成(或跳过)的节点数
+    std::atomic_bool failed{false};
+    std::exception_ptr exception;
+    std::shared_ptr<detail::FutureState<void>> done;
+
+    // 还有节点没执行就被释放(节点任务随线程池析构等) 结束run并让future得到broken_promise 不会一直阻塞
+    ~Run()
+    {
+        if (done == nullptr || remaining.load(std::memory_order_acquire) == 0) return ;
+        graph->activeRuns_.fetch_sub(1, std::memory_order_release);
+        done->setException(std::make_exception_ptr(std::future_error(std::future_errc::broken_promise)));
+    }
+};
+
+void TaskGraph::checkIdle() const
+{
+    if (activeRuns_.load(std::memory_order_acquire) > 0)
+    {
+        throw std::logic_error("TaskGraph modified while running");
+    }
+}
+
+TaskGraph::NodeId TaskGraph::addNode(std::function<void()> work)
+{
+    checkIdle();
+    Node node;
+    node.work = std::move(work);
+    nodes_.push_back(std::move(node));
+    prepared_ = false;
+    return nodes_.size() - 1;
+}
+
+void TaskGraph::addEdge(NodeId from, NodeId to)
+{
+    checkIdle();
+    if (from >= nodes_.size() || to >= nodes_.size())
+    {
+        throw std::out_of_range("TaskGraph::addEdge: no such node");
+    }
+    nodes_[from].successors.push_back(to);
+    nodes_[to].predecessors++;
+    prepared_ = false;
+}
+
+void TaskGraph::prepare()
+{
+    roots_.clear();
+    std::vector<int> indegree(nodes_.size());
+    for (NodeId i = 0; i < nodes_.size(); i++)
+    {
+        indegree[i] = nodes_[i].predecessors;
+        if (indegree[i] == 0) roots_.push_back(i);
+    }
+
+    // Kahn拓扑排序 能访问到所有节点说明没有环
+    std::vector<NodeId> ready(roots_);
+    size_t visited = 0;
+    while (!ready.empty())
+    {
+        NodeId id = ready.back();
+        ready.pop_back();
+        visited++;
+        for (NodeId next : nodes_[id].successors)
+        {
+            if (--indegree[next] == 0) ready.push_back(next);
+        }
+    }
+    acyclic_ = visited == nodes_.size();
+    prepared_ = true;
+}
+
+PoolFuture<void> TaskGraph::run(ThreadPool& pool)
+{
+    auto done = detail::makeState<void>();
+    bool acyclic;
+    {
+        std::lock_guard<std::mutex> lock(prepareMtx_);
+        if (!prepared_) prepare();
+        acyclic = acyclic_;
+    }
+    if (!acyclic)
+    {
+        done->setException(std::make_exception_ptr(std::logic_error("TaskGraph contains a cycle")));
+        return detail::FutureAccess::make(std::move(done), &pool);
+    }
+    if (nodes_.empty())
+    {
+        done->setValue();
+        return detail::FutureAccess::make(std::move(done), &pool);
+    }
+
+    auto run = std::make_shared<Run>();
+    run->graph = this;
+    run->pool = &pool;
+    run->pending.reset(new std::atomic<int>[nodes_.size()]);
+    for (NodeId i = 0; i < nodes_.size(); i++)
+    {
+        run->pending[i].store(nodes_[i].predecessors, std::memory_order_relaxed);
+    }
+    run->remaining.store(nodes_.size(), std::memory_order_relaxed);
+    run->failed.store(false, std::memory_order_relaxed);
+
+    activeRuns_.fetch_add(1, std::memory_order_relaxed);
+    run->done = done;
+    for (NodeId id : roots_)
+    {
+        pool.post([run, id]() {execute(run, id);});
+    }
+    return detail::FutureAccess::make(std::move(done), &pool);
+}
+
+void TaskGraph::execute(std::shared_ptr<Run> run, NodeId id)
+{
+    const std::vector<Node>& nodes = run->graph->nodes_;
+    for (;;)
+    {
+        if (!run->failed.load(std::memory_order_relaxed))
+        {
+            try
+            {
+                nodes[id].work();
+            }
+            catch (...)
+            {
+                if (!run->failed.exchange(true))
+                {
+                    run->exception = std::current_exception();
+                }
+            }
+        }
+
+        // 后继的入度减到0时就绪 第一个就绪的后继在当前线程继续执行 省去一次入队和唤醒
+        NodeId next = nodes.size();
+        for (NodeId succ : nodes[id].successors)
+        {
+            if (run->pending[succ].fetch_sub(1, std::memory_order_acq_rel) != 1) continue;
+            if (next == nodes.size())
+            {
+                next = succ;
+            }
+            else
+            {
+                run->pool->post([run, succ]() {execute(run, succ);});
+            }
+        }
+
+        // acq_rel: 最后完成的节点能看到所有节点的执行结果和异常
+        if (run->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            // 先结束run再通知future 等待future的线程之后可以修改图
+            run->graph->activeRuns_.fetch_sub(1, std::memory_order_release);
+            if (run->failed.load(std::memory_order_relaxed)) run->done->setException(run->exception);
+            else run->done->setValue();
+            return ;
+        }
+        if (next == nodes.size()) return ;
+        id = next;
+    }
+}
@@ -1,31 +1,83 @@
 #include "../include/threadpool.h"
 
-#include <iostream>
 #include <ctime>
+#include <algorithm>
 
 const int TASK_MAX_THRESHHOLD = 1024;
 const int THREAD_MAX_THRESHHOLE = 20; // cached模式下线程数目的上限
 const int THREAD_MAX_IDLE_TIME = 60; // 秒
+const int THREAD_SPAWN_PER_TICK = 8; // cached模式下每个采样周期最多创建的线程数
+const auto CONTROLLER_TICK = std::chrono::milliseconds(1); // 扩容线程的采样周期
+const auto TIMER_TICK = std::chrono::milliseconds(1); // 时间轮的精度
+const int PRIORITY_AGING_THRESHHOLD = 32; // 低优先级任务最多连续被插队的次数
+const int IDLE_SPIN_COUNT = 512;  // 空闲线程park之前自旋检查任务的次数
+const int IDLE_YIELD_COUNT = 8;   // 自旋之后让出CPU的次数
 
 ThreadPool::ThreadPool():
+    poolMode_(MODE_FIXED),
+    schedMode_(SCHED_SHARED_QUEUE),
     initThreadSize_(0),
+    threadSizeThreshHold_(10),
+    idleThreadSize_(0),
+    curThreadSize_(0),
     taskSize_(0),
     taskQueMaxThreshHold_(TASK_MAX_THRESHHOLD),
-    threadSizeThreshHold_(10),
-    poolMode_(MODE_FIXED),
+    agingThreshHold_(PRIORITY_AGING_THRESHHOLD),
+    dequeueBatch_(1),
+    groupTaskSize_(0),
+    groupFullWaiters_(0),
     isPoolRunning_(false),
-    idleThreadSize_(0),
-    curThreadSize_(0)
+    growPending_(false),
+    idleTimeout_(std::chrono::seconds(THREAD_MAX_IDLE_TIME)),
+    spawnPerTick_(THREAD_SPAWN_PER_TICK),
+    timerWakeTick_(UINT64_MAX),
+    laneTaskSize_(0),
+    fullWaiters_(0),
+    sleepingThreadSize_(0),
+    spinningThreadSize_(0),
+    spinCount_(IDLE_SPIN_COUNT),
+    yieldCount_(IDLE_YIELD_COUNT),
+    affinityMode_(AFFINITY_NONE),
+    nodeCount_(1),
+    memResource_(nullptr),
+    overflowPolicy_(OVERFLOW_BLOCK),
+    submitTimeout_(std::chrono::seconds(1)),
+    rejectedTasks_(0),
+    droppedTasks_(0),
+    callerRunsTasks_(0),
+    cancelledTasks_(0)
 {
-
+    if (std::thread::hardware_concurrency() <= 1)
+    {
+        // 单核上自旋和让出CPU只会推迟提交者和正在执行任务的线程
+        spinCount_ = 0;
+        yieldCount_ = 0;
+    }
 }
 
 ThreadPool::~ThreadPool()
 {
     isPoolRunning_ = false;
 
+    if (controller_.joinable())
+    {
+        controllerParker_.unpark();
+        controller_.join();
+    }
+    {
+        // 和addTimer中的检查互斥 之后不会再启动定时线程
+        std::unique_lock<std::mutex> lk(timerMtx_);
+    }
+    if (timerThread_.joinable())
+    {
+        timerParker_.unpark();
+        timerThread_.join();
+    }
+
+    // 唤醒所有park的线程 线程发现线程池已经停止并且没有任务后退出
+    wakeWorkers(SIZE_MAX, true);
+
     std::unique_lock<std::mutex> lk(taskQueMtx_);
-    notEmpty_.notify_all();
     exitCond_.wait(lk, [&]() {return threads_.size() == 0;});
 }
 
@@ -40,6 +92,12 @@ void ThreadPool::setMode(PoolMode mode)
     poolMode_ = mode;
 }
 
+void ThreadPool::setSchedMode(SchedMode mode)
+{
+    if (checkRunningState()) return ;
+    schedMode_ = mode;
+}
+
 void ThreadPool::setTaskQueThreshHold(int threshhold)
 {
     if (checkRunningState()) return ;
@@ -52,12 +110,537 @@ void ThreadPool::setCachedModeThreadSizeLimit(int threashHold)
     threadSizeThreshHold_ = threashHold;
 }
 
+void ThreadPool::setCachedModeIdleTimeout(std::chrono::milliseconds timeout)
+{
+    if (checkRunningState() || timeout.count() <= 0) return ;
+    idleTimeout_ = timeout;
+}
+
+void ThreadPool::setCachedModeSpawnRate(int threadsPerTick)
+{
+    if (checkRunningState() || threadsPerTick <= 0) return ;
+    spawnPerTick_ = threadsPerTick;
+}
+
+void ThreadPool::setPriorityAgingThreshHold(int threshhold)
+{
+    if (checkRunningState() || threshhold <= 0) return ;
+    agingThreshHold_ = threshhold;
+}
+
+void ThreadPool::setDequeueBatch(int maxBatch)
+{
+    if (checkRunningState()) return ;
+    dequeueBatch_ = std::min(std::max(maxBatch, 1), DEQUEUE_BATCH_MAX);
+}
+
+void ThreadPool::setIdleStrategy(int spinCount, int yieldCount)
+{
+    if (checkRunningState()) return ;
+    spinCount_ = spinCount > 0 ? spinCount : 0;
+    yieldCount_ = yieldCount > 0 ? yieldCount : 0;
+}
+
+void ThreadPool::setAffinity(AffinityMode mode)
+{
+    if (checkRunningState()) return ;
+    affinityMode_ = mode;
+}
+
+void ThreadPool::setMemoryResource(std::pmr::memory_resource* resource)
+{
+    if (checkRunningState()) return ;
+    memResource_ = resource;
+}
+
+void ThreadPool::setOverflowPolicy(OverflowPolicy policy)
+{
+    if (checkRunningState()) return ;
+    overflowPolicy_ = policy;
+}
+
+void ThreadPool::setSubmitTimeout(std::chrono::milliseconds timeout)
+{
+    if (checkRunningState()) return ;
+    submitTimeout_ = timeout;
+}
+
+size_t ThreadPool::pushWithPolicy(Task* tasks, size_t count, Priority priority, int node)
+{
+    TimerClock::duration timeout = overflowPolicy_ == OVERFLOW_BLOCK ? submitTimeout_ : TimerClock::duration::zero();
+    return pushTasks(tasks, count, timeout, overflowPolicy_ == OVERFLOW_DROP_OLDEST, priority, node);
+}
+
+size_t ThreadPool::dispatch(Task* tasks, size_t count, Priority priority, int node)
+{
+    size_t pushed = pushWithPolicy(tasks, count, priority, node);
+    if (pushed == count) return count;
+
+    if (overflowPolicy_ == OVERFLOW_CALLER_RUNS)
+    {
+        callerRunsTasks_.fetch_add(count - pushed, std::memory_order_relaxed);
+        for (size_t i = pushed; i < count; i++)
+        {
+            runInline(tasks[i]);
+        }
+        return count;
+    }
+    rejectedTasks_.fetch_add(count - pushed, std::memory_order_relaxed);
+    Logger::log(LOG_WARN, "task queue is full, %zu tasks submit fail, retry later.", count - pushed);
+    return pushed;
+}
+
+TaskGroup ThreadPool::createTaskGroup(const std::string& name, int weight, size_t maxQueued)
+{
+    std::unique_lock<std::mutex> lk(groupMtx_);
+    int id = groupQue_.addGroup(weight, maxQueued > 0 ? maxQueued : taskQueMaxThreshHold_);
+    groups_.emplace_back(new GroupInfo(name));
+    return TaskGroup{id};
+}
+
+bool ThreadPool::dispatchGroup(TaskGroup group, Task& task)
+{
+    QueuedTask dropped; // 被丢弃的任务在锁外析构
+    GroupInfo* info = nullptr;
+    bool pushed = false;
+    {
+        std::unique_lock<std::mutex> lk(groupMtx_);
+        if (group.valid() && (size_t)group.id < groups_.size())
+        {
+            info = groups_[group.id].get();
+            if (groupQue_.full(group.id))
+            {
+                if (overflowPolicy_ == OVERFLOW_DROP_OLDEST && groupQue_.popOldest(group.id, dropped))
+                {
+                    groupTaskSize_--;
+                    taskSize_--;
+                    info->dropped.fetch_add(1, std::memory_order_relaxed);
+                    droppedTasks_.fetch_add(1, std::memory_order_relaxed);
+                }
+                else if (overflowPolicy_ == OVERFLOW_BLOCK)
+                {
+                    groupFullWaiters_++;
+                    groupNotFull_.wait_for(lk, submitTimeout_, [&]() {return !groupQue_.full(group.id);});
+                    groupFullWaiters_--;
+                }
+            }
+            if (!groupQue_.full(group.id))
+            {
+                groupQue_.push(group.id, QueuedTask(std::move(task), statsNow(), info));
+                // 先增加groupTaskSize_ 看到taskSize_大于0的线程一定能看到分组任务
+                groupTaskSize_++;
+                taskSize_++;
+                info->submitted.fetch_add(1, std::memory_order_relaxed);
+                pushed = true;
+            }
+        }
+    }
+    if (info == nullptr)
+    {
+        return dispatch(&task, 1) == 1;
+    }
+    if (pushed)
+    {
+        wakeWorkers(1);
+        requestGrowth();
+        return true;
+    }
+
+    info->rejected.fetch_add(1, std::memory_order_relaxed);
+    if (overflowPolicy_ == OVERFLOW_CALLER_RUNS)
+    {
+        callerRunsTasks_.fetch_add(1, std::memory_order_relaxed);
+        task();
+        return true;
+    }
+    rejectedTasks_.fetch_add(1, std::memory_order_relaxed);
+    Logger::log(LOG_WARN, "task group %s is full, submit task fail, retry later.", info->name.c_str());
+    return false;
+}
+
+int ThreadPool::submitNode(int hint) const
+{
+    if (nodeCount_ == 1) return 0;
+    if (hint >= 0) return hint % nodeCount_;
+    if (curNode_ >= 0) return curNode_ % nodeCount_;
+    // 外部线程按它当前运行的CPU选择节点
+    return CpuTopology::system().nodeOf(currentCpu()) % nodeCount_;
+}
+
+size_t ThreadPool::pushTasks(Task* tasks, size_t count, TimerClock::duration timeout, bool evict, Priority priority, int node)
+{
+    bool wait = timeout > TimerClock::duration::zero();
+    if (schedMode_ != SCHED_SHARED_QUEUE)
+    {
+        // 先增加任务计数再入队 睡眠线程检查任务计数时不会漏掉这些任务
+        taskSize_ += count;
+        size_t pushed = 0;
+        size_t woken = 0;
+        int64_t now = statsNow();
+        std::vector<QueuedTask> evicted;
+
+        Worker* self = curWorker_;
+        node = submitNode(node);
+        MpmcQueue<QueuedTask>* que = &laneQue(node, priority);
+        if (schedMode_ == SCHED_WORK_STEALING && self != nullptr && self->pool == this && priority == PRIORITY_NORMAL
+            && node == curNode_)
+        {
+            // 线程池线程提交的普通优先级子任务直接放入自己的双端队列 其他优先级进入对应的注入队列
+            for (; pushed < count; pushed++)
+            {
+                self->deque.push(newQueuedTask(std::move(tasks[pushed]), now));
+            }
+        }
+        else
+        {
+            while (pushed < count)
+            {
+                QueuedTask item(std::move(tasks[pushed]), now);
+                bool ok = pushLane(*que, item);
+                while (!ok && evict)
+                {
+                    // 挤出最早入队的任务 最后统一处理
+                    QueuedTask oldest;
+                    if (!evictLane(node, priority, oldest)) break;
+                    taskSize_--;
+                    evicted.push_back(std::move(oldest));
+                    ok = pushLane(*que, item);
+                }
+                if (!ok) // 失败时item不会被移动 放回tasks中
+                {
+                    tasks[pushed] = std::move(item.task);
+                    break;
+                }
+                pushed++;
+            }
+            if (pushed < count && !wait)
+            {
+                taskSize_ -= count - pushed;
+            }
+            else if (pushed < count)
+            {
+                // 队列满 先唤醒线程处理已经入队的任务 再进入慢路径等待消费者腾出位置
+                // 剩余任务不计入任务计数 否则空闲线程会看到任务数大于0却取不到任务而空转
+                taskSize_ -= count - pushed;
+                wakeWorkers(pushed - woken, false, node);
+                woken = pushed;
+                auto deadline = TimerClock::now() + timeout;
+                std::unique_lock<std::mutex> lk(taskQueMtx_);
+                fullWaiters_++;
+                while (pushed < count)
+                {
+                    bool ok = notFull_.wait_until(lk, deadline, [&]() {
+                        taskSize_++;
+                        std::atomic_thread_fence(std::memory_order_seq_cst);
+                        QueuedTask item(std::move(tasks[pushed]), statsNow());
+                        if (pushLane(*que, item))
+                        {
+                            return true;
+                        }
+                        tasks[pushed] = std::move(item.task);
+                        taskSize_--;
+                        return false;
+                    });
+                    if (!ok) break;
+                    pushed++;
+                    // 慢路径中线程可能已经把队列取空去睡眠了
+                    wakeWorkers(1, false, node);
+                    woken = pushed;
+                }
+                fullWaiters_--;
+            }
+        }
+
+        wakeWorkers(pushed - woken, false, node);
+        requestGrowth();
+        finishEvicted(evicted);
+        return pushed;
+    }
+
+    // 整批任务在一次加锁内入队 队列放不下时等待腾出位置后继续放入剩余的任务
+    std::vector<QueuedTask> evicted; // 被挤出的任务在锁外处理
+    TimerClock::time_point deadline;
+    const size_t limit = (size_t)taskQueMaxThreshHold_;
+    std::unique_lock<std::mutex> lk(taskQueMtx_);
+    size_t pushed = 0;
+    size_t woken = 0;
+    while (pushed < count)
+    {
+        if (taskQue_.size() >= limit)
+        {
+            QueuedTask oldest;
+            if (evict && taskQue_.popLowest(oldest, priority))
+            {
+                evicted.push_back(std::move(oldest));
+                taskSize_--;
+                continue;
+            }
+            if (!wait) break;
+            // 等待之前先唤醒线程处理已经入队的任务
+            wakeWorkers(pushed - woken);
+            woken = pushed;
+            if (deadline == TimerClock::time_point()) deadline = TimerClock::now() + timeout;
+            fullWaiters_++;
+            bool ok = notFull_.wait_until(lk, deadline, [&]() {return taskQue_.size() < limit;});
+            fullWaiters_--;
+            if (!ok) break;
+        }
+        size_t n = std::min(count - pushed, limit - taskQue_.size());
+        int64_t now = statsNow();
+        for (size_t i = 0; i < n; i++)
+        {
+            taskQue_.push(QueuedTask(std::move(tasks[pushed++]), now), priority);
+        }
+        taskSize_ += n;
+    }
+    lk.unlock();
+
+    // 只唤醒min(任务数 - 自旋线程数, 睡眠线程数)个线程
+    wakeWorkers(pushed - woken);
+    requestGrowth();
+    finishEvicted(evicted);
+    return pushed;
+}
+
+void ThreadPool::finishEvicted(std::vector<QueuedTask>& evicted)
+{
+    for (QueuedTask& item : evicted)
+    {
+        if (!item.mustRun)
+        {
+            droppedTasks_.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+        callerRunsTasks_.fetch_add(1, std::memory_order_relaxed);
+        if (item.control != nullptr && skipCancelled(item)) continue;
+        runTask(item);
+    }
+    evicted.clear();
+}
+
+// --------------------cached模式的扩容和缩容-------------------------------
+
+void ThreadPool::requestGrowth()
+{
+    // cached模式下 当前任务数大于空闲线程数并且当前已经创建的线程总数没有超过设定的阈值 通知扩容线程
+    if (poolMode_ != MODE_CACHED) return ;
+    if ((int)taskSize_ <= idleThreadSize_ || curThreadSize_ >= threadSizeThreshHold_) return ;
+    if (growPending_.load(std::memory_order_relaxed) || growPending_.exchange(true)) return ;
+    controllerParker_.unpark();
+}
+
+void ThreadPool::controllerFunc()
+{
+    // 积压(任务数超过空闲线程数)刚出现时 短任务可能很快就被现有线程取走 不急于创建线程
+    // 积压超过当前线程数 或者持续了一个采样周期(任务至少排队了一个周期)才扩容 每个周期最多创建spawnPerTick_个线程
+    // 新线程创建后立即计为空闲线程 下一个周期的积压已经扣除了它们 不会过量创建
+    Tracer::setThreadName("threadpool controller");
+    using Clock = std::chrono::steady_clock;
+    Clock::time_point backlogSince;
+    bool backlogged = false;
+    while (isPoolRunning_)
+    {
+        int backlog = (int)taskSize_ - idleThreadSize_;
+        int room = threadSizeThreshHold_ - curThreadSize_;
+        if (backlog <= 0 || room <= 0)
+        {
+            backlogged = false;
+            // 先清除标志再检查一次 和requestGrowth先增加任务数再设置标志的顺序配对
+            growPending_.store(false);
+            if (room > 0 && (int)taskSize_ > idleThreadSize_) continue;
+            controllerParker_.park();
+            continue;
+        }
+
+        auto now = Clock::now();
+        if (!backlogged)
+        {
+            backlogged = true;
+            backlogSince = now;
+        }
+        if (backlog >= curThreadSize_ || now - backlogSince >= CONTROLLER_TICK)
+        {
+            int n = std::min(std::min(backlog, room), spawnPerTick_);
+            for (int i = 0; i < n; i++)
+            {
+                spawnThread();
+            }
+            backlogSince = now;
+        }
+        controllerParker_.parkUntil(now + CONTROLLER_TICK);
+    }
+}
+
+void ThreadPool::spawnThread()
+{
+    // 线程对象的创建和线程的启动都在锁外 只有登记到threads_需要加锁
+    auto ptr = std::make_unique<Thread>(std::bind(&ThreadPool::threadFunc, this, std::placeholders::_1));
+    ulong id = ptr->getId();
+    Thread* thread = ptr.get();
+    idleThreadSize_ ++;
+    curThreadSize_ ++;
+    {
+        std::unique_lock<std::mutex> lk(taskQueMtx_);
+        threads_[id] = std::move(ptr);
+    }
+    Logger::log(LOG_INFO, "create new thread, id = %lu", id);
+    Tracer::instant("spawn thread");
+    // 线程退出时才会从threads_中删除 退出需要先启动 这里thread一定有效
+    thread->start();
+}
+
+// --------------------定时任务-------------------------------
+
+uint64_t ThreadPool::timerTick(TimerClock::time_point when) const
+{
+    // 向上取整 保证任务不会提前执行
+    if (when <= timerEpoch_) return 0;
+    auto ticks = (when - timerEpoch_ + TIMER_TICK - TimerClock::duration(1)) / TIMER_TICK;
+    return (uint64_t)ticks;
+}
+
+TimerId ThreadPool::addTimer(TimerClock::time_point when, Task task, TimerClock::duration period)
+{
+    bool wake = false;
+    TimerId id;
+    {
+        std::unique_lock<std::mutex> lk(timerMtx_);
+        if (!isPoolRunning_) return id;
+        if (wheel_ == nullptr)
+        {
+            wheel_ = std::make_unique<TimingWheel>();
+            timerEpoch_ = TimerClock::now();
+            timerThread_ = std::thread(&ThreadPool::timerFunc, this);
+        }
+        uint64_t tick = timerTick(when);
+        uint64_t periodTicks = 0;
+        if (period > TimerClock::duration::zero())
+        {
+            periodTicks = std::max<uint64_t>(1, (period + TIMER_TICK - TimerClock::duration(1)) / TIMER_TICK);
+        }
+        id = wheel_->add(tick, std::move(task), periodTicks);
+        // 比定时线程计划醒来的时间更早时提前唤醒它
+        if (tick < timerWakeTick_)
+        {
+            timerWakeTick_ = tick;
+            wake = true;
+        }
+    }
+    if (wake)
+    {
+        timerParker_.unpark();
+    }
+    return id;
+}
+
+bool ThreadPool::cancelTimer(TimerId id)
+{
+    std::unique_lock<std::mutex> lk(timerMtx_);
+    return wheel_ != nullptr && wheel_->cancel(id);
+}
+
+void ThreadPool::timerFunc()
+{
+    Tracer::setThreadName("threadpool timer");
+    std::vector<Task> expired;
+    std::unique_lock<std::mutex> lk(timerMtx_);
+    while (isPoolRunning_)
+    {
+        wheel_->advance(timerTick(TimerClock::now()), expired);
+        if (!expired.empty())
+        {
+            // 在锁外入队 按溢出策略没能入队的任务在定时线程上直接执行
+            lk.unlock();
+            MustRunScope mustRun;
+            size_t pushed = pushWithPolicy(expired.data(), expired.size());
+            callerRunsTasks_.fetch_add(expired.size() - pushed, std::memory_order_relaxed);
+            for (size_t i = pushed; i < expired.size(); i++)
+            {
+                expired[i]();
+            }
+            expired.clear();
+            lk.lock();
+            continue;
+        }
+
+        uint64_t next = wheel_->nextTick();
+        timerWakeTick_ = next;
+        lk.unlock();
+        if (next == UINT64_MAX)
+        {
+            timerParker_.park();
+        }
+        else
+        {
+            timerParker_.parkUntil(timerEpoch_ + next * TIMER_TICK);
+        }
+        lk.lock();
+        timerWakeTick_ = 0; // 醒着的时候不需要唤醒
+    }
+}
+
+bool ThreadPool::retireThread()
+{
+    int cur = curThreadSize_.load();
+    while (cur > initThreadSize_)
+    {
+        if (curThreadSize_.compare_exchange_weak(cur, cur - 1))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
 void ThreadPool::start(int initThreadSize)
 {
     isPoolRunning_ = true;
     initThreadSize_ = initThreadSize;
     curThreadSize_ = initThreadSize;
 
+    taskQue_.setAgingThreshHold(agingThreshHold_);
+    if (affinityMode_ != AFFINITY_NONE)
+    {
+        placement_ = CpuTopology::system().placement(affinityMode_);
+        // 共享队列模式只有一个加锁的队列 只绑核不分节点
+        if (schedMode_ != SCHED_SHARED_QUEUE)
+        {
+            nodeCount_ = CpuTopology::system().nodeCount();
+        }
+    }
+    if (schedMode_ != SCHED_SHARED_QUEUE)
+    {
+        // 每个节点每个优先级一个队列 任务总数由laneTaskSize_限制在taskQueMaxThreshHold_以内
+        // 每个队列的容量都按上限分配 任务集中在一个队列中时也放得下
+        lfQues_.resize(nodeCount_ * PRIORITY_LEVELS);
+        for (auto& que : lfQues_)
+        {
+            que = std::make_unique<MpmcQueue<QueuedTask>>(taskQueMaxThreshHold_);
+        }
+    }
+
+    if (schedMode_ == SCHED_WORK_STEALING)
+    {
+        // 每个线程占用一个槽位 cached模式下按线程数上限预留
+        int slots = initThreadSize_;
+        if (poolMode_ == MODE_CACHED && threadSizeThreshHold_ > slots)
+        {
+            slots = threadSizeThreshHold_;
+        }
+        for (int i = 0; i < slots; i++)
+        {
+            auto worker = std::make_unique<Worker>();
+            worker->pool = this;
+            worker->index = i;
+            worker->seed = 2654435761u * (i + 1);
+            workers_.push_back(std::move(worker));
+        }
+        for (int i = slots - 1; i >= 0; i--)
+        {
+            freeWorkerSlots_.push_back(i);
+        }
+    }
+
     // 创建线程对象
     for (int i = 0; i < initThreadSize_; i++)
     {
@@ -68,79 +651,652 @@ void ThreadPool::start(int initThreadSize)
         threads_[id] = std::move(threadPtr);
     }
 
-    for (int i = 0; i < initThreadSize_; i++)
+    // 线程id全局递增 多个线程池时不一定从0开始 所以遍历容器启动
+    for (auto& kv : threads_)
     {
-        threads_[i]->start();
+        kv.second->start();
         idleThreadSize_ ++;
     }
+
+    if (poolMode_ == MODE_CACHED)
+    {
+        controller_ = std::thread(&ThreadPool::controllerFunc, this);
+    }
 }
 
 void ThreadPool::threadFunc(ulong threadId)
 {
+    curPool_ = this;
+    if (schedMode_ == SCHED_WORK_STEALING)
+    {
+        std::unique_lock<std::mutex> lk(taskQueMtx_);
+        curWorker_ = workers_[freeWorkerSlots_.back()].get();
+        freeWorkerSlots_.pop_back();
+    }
+
+    int slot = 0;
+    WorkerStats* stats = claimStats(slot);
+    placeThread(slot);
+    Tracer::setThreadName("threadpool worker");
+    Parker parker;
+    std::vector<QueuedTask> batch(dequeueBatch_);
+    PendingBatch pending{batch.data(), 0, 0};
+    curBatch_ = &pending;
     auto last_time = std::chrono::high_resolution_clock().now();
     for (;;)
     {
-        Task task;
+        size_t count = findTasks(batch.data(), batch.size());
+        if (count == 0)
         {
-            std::unique_lock<std::mutex> lk(taskQueMtx_);
-            while (taskQue_.size() == 0) 
+            if (!waitForTask(threadId, parker, last_time)) // 保证threadpool析构的时候所有任务都完成再退出
             {
-                if (!isPoolRunning_) // 保证threadpool析构的时候所有任务都完成再退出
-                {
-                    threads_.erase(threadId);
-                    std::cout << threadId << " exit because threadpool life is over!" << std::endl;
-                    exitCond_.notify_all();
-                    return ;
-                }
+                curBatch_ = nullptr;
+                return ;
+            }
+            continue;
+        }
+        pending.next = 0;
+        pending.count = count;
 
-                if (poolMode_ == MODE_CACHED)
-                {
-                    if (std::cv_status::timeout == notEmpty_.wait_for(lk, std::chrono::seconds(1)))
-                    {
-                        auto now = std::chrono::high_resolution_clock().now();
-                        auto dur = std::chrono::duration_cast<std::chrono::seconds>(now - last_time);
-                        if (dur.count() > THREAD_MAX_IDLE_TIME)
-                        {
-                            std::cout << threadId << " exit because idle time is too long!" << std::endl;
-                            threads_.erase(threadId);
-                            curThreadSize_ --;
-                            idleThreadSize_ --;
-                            return ;
-                        }
-                    }
-                }
-                else
+        idleThreadSize_ --;
+        // 取走任务后还有剩余任务 并且没有线程在自旋时 再唤醒一个线程 由它继续唤醒下一个
+        if ((taskSize_ -= count) > 0)
+        {
+            wakeWorkers(1);
+        }
+        // 一批任务连续执行 上一个任务的结束时间就是下一个任务的开始时间
+        int64_t now = statsNow();
+        uint64_t dequeued = Tracer::timestamp(); // 没有开启追踪时为0
+        uint64_t traceStart = dequeued;
+        // 任务中等待future时(runPendingTask)会接着执行本批剩下的任务 所以每次从pending.next取
+        while (pending.next < pending.count)
+        {
+            QueuedTask& item = batch[pending.next++];
+            // 排队期间已经取消或过期的任务不执行 也不计入统计
+            if (item.control != nullptr && skipCancelled(item)) continue;
+            int64_t start = now;
+            stats->taskStarted(start, item);
+            if (item.group != nullptr) item.group->stats.taskStarted(start, item);
+            if (item.task != nullptr)
+            {
+                runTask(item); // 执行funtional<void()>
+            }
+            now = statsNow();
+            stats->taskFinished(now);
+            if (item.group != nullptr) groupTaskFinished(*item.group, start, now);
+            traceStart = Tracer::taskFinished(item, dequeued, traceStart);
+            item.task = nullptr; // 及时释放任务捕获的资源
+        }
+
+        idleThreadSize_ ++;
+        last_time = std::chrono::high_resolution_clock().now();
+    }
+}
+
+bool ThreadPool::runPendingTask()
+{
+    QueuedTask item;
+    PendingBatch* pending = curBatch_;
+    if (pending != nullptr && pending->next < pending->count)
+    {
+        // 本线程批量取出的任务其他线程取不到 等待的future可能正依赖它们 先执行 taskSize_取出时已经扣除
+        item = std::move(pending->tasks[pending->next++]);
+    }
+    else
+    {
+        if (!findTask(item)) return false;
+        if (-- taskSize_ > 0)
+        {
+            wakeWorkers(1);
+        }
+    }
+
+    // 本线程没有回到空闲状态 idleThreadSize_不变 执行时间算在外层任务中
+    if (item.control != nullptr && skipCancelled(item)) return true;
+    int64_t start = statsNow();
+    uint64_t traceStart = Tracer::timestamp();
+    if (item.group != nullptr) item.group->stats.taskStarted(start, item);
+    if (item.task != nullptr)
+    {
+        runTask(item);
+    }
+    Tracer::taskFinished(item, traceStart, traceStart);
+    int64_t end = statsNow();
+    curStats_->taskHelped(start, end, item);
+    if (item.group != nullptr) groupTaskFinished(*item.group, start, end);
+    return true;
+}
+
+bool ThreadPool::skipCancelled(QueuedTask& item)
+{
+    const char* reason = checkCancelled(*item.control);
+    if (reason == nullptr) return false;
+    if (item.task != nullptr)
+    {
+        cancelReason_ = reason;
+        item.task();
+        cancelReason_ = nullptr;
+        item.task = nullptr;
+    }
+    item.control.reset();
+    return true;
+}
+
+void ThreadPool::runTask(QueuedTask& item)
+{
+    if (item.control == nullptr)
+    {
+        item.task();
+        return ;
+    }
+    CancellationToken::Scope scope(item.control->token);
+    item.task();
+    item.control.reset();
+}
+
+void ThreadPool::runInline(Task& task)
+{
+    const TaskControl* control = submitControl_;
+    if (control == nullptr)
+    {
+        task();
+        return ;
+    }
+    // 任务中再提交的任务不继承外层的token
+    ControlScope clear(nullptr);
+    if (const char* reason = checkCancelled(*control))
+    {
+        cancelReason_ = reason;
+        task();
+        cancelReason_ = nullptr;
+        return ;
+    }
+    CancellationToken::Scope scope(control->token);
+    task();
+}
+
+bool ThreadPool::popSharedTask(QueuedTask& task)
+{
+    return popSharedTasks(&task, 1) == 1;
+}
+
+size_t ThreadPool::popSharedTasks(QueuedTask* tasks, size_t max)
+{
+    // taskSize_和队列在同一把锁内更新 为0时不需要加锁
+    if (taskSize_ == 0) return 0;
+
+    std::unique_lock<std::mutex> lk(taskQueMtx_);
+    size_t count = 0;
+    while (count < max && taskQue_.pop(tasks[count]))
+    {
+        count++;
+    }
+    if (count > 0 && fullWaiters_ > 0)
+    {
+        // 腾出了多个位置时唤醒所有等待的提交者
+        if (count > 1) notFull_.notify_all();
+        else notFull_.notify_one();
+    }
+    return count;
+}
+
+void ThreadPool::placeThread(int slot)
+{
+    curNode_ = 0;
+    if (placement_.empty()) return ;
+    const CpuTopology::Cpu& cpu = placement_[slot % placement_.size()];
+    pinCurrentThread(cpu.id);
+    if (nodeCount_ > 1)
+    {
+        curNode_ = cpu.node;
+    }
+}
+
+// --------------------空闲线程的自旋和睡眠-------------------------------
+
+void ThreadPool::wakeWorkers(size_t count, bool all, int node)
+{
+    if (count == 0) return ;
+
+    // 和空闲线程登记自旋/睡眠之后再检查任务数的顺序配对 保证不会丢失唤醒
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!all)
+    {
+        // 正在自旋的线程会自己取到任务 不需要唤醒
+        size_t spinning = spinningThreadSize_.load(std::memory_order_relaxed);
+        if (count <= spinning || sleepingThreadSize_.load(std::memory_order_relaxed) == 0) return ;
+        count -= spinning;
+    }
+
+    // 在锁内unpark 被唤醒的线程拿到idleMtx_时unpark一定已经完成 Parker不会在unpark期间析构
+    std::unique_lock<std::mutex> lk(idleMtx_);
+    while (count > 0 && !parked_.empty())
+    {
+        // 多个NUMA节点时优先唤醒任务所在节点上的线程
+        size_t pick = parked_.size() - 1;
+        if (node >= 0 && nodeCount_ > 1)
+        {
+            for (size_t i = parked_.size(); i-- > 0; )
+            {
+                if (parked_[i].node == node)
                 {
-                    notEmpty_.wait(lk);
+                    pick = i;
+                    break;
                 }
-
             }
+        }
+        Parker* parker = parked_[pick].parker;
+        parked_.erase(parked_.begin() + pick);
+        sleepingThreadSize_ --;
+        parker->unpark();
+        count--;
+    }
+}
+
+bool ThreadPool::cancelPark(Parker& parker)
+{
+    {
+        std::unique_lock<std::mutex> lk(idleMtx_);
+        auto it = std::find_if(parked_.begin(), parked_.end(), [&](const ParkedThread& t) {return t.parker == &parker;});
+        if (it != parked_.end())
+        {
+            parked_.erase(it);
+            sleepingThreadSize_ --;
+            return false;
+        }
+    }
+    // 已经被唤醒者从列表中取走 消耗掉这次唤醒
+    parker.park();
+    return true;
+}
+
+void ThreadPool::exitThread(ulong threadId, bool idleTimeout)
+{
+    Tracer::instant(idleTimeout ? "thread exit (idle)" : "thread exit");
+    releaseStats(curStats_);
+    curStats_ = nullptr;
+    curNode_ = -1;
+    curPool_ = nullptr;
+
+    std::unique_lock<std::mutex> lk(taskQueMtx_);
+    Worker* self = curWorker_;
+    if (self != nullptr)
+    {
+        // 退出时自己的双端队列一定为空 槽位可以直接交给新线程
+        freeWorkerSlots_.push_back(self->index);
+        curWorker_ = nullptr;
+    }
+    if (idleTimeout)
+    {
+        // curThreadSize_已经在retireThread中减少
+        Logger::log(LOG_INFO, "%lu exit because idle time is too long!", threadId);
+        idleThreadSize_ --;
+    }
+    else
+    {
+        Logger::log(LOG_INFO, "%lu exit because threadpool life is over!", threadId);
+    }
+    threads_.erase(threadId);
+    exitCond_.notify_all();
+}
+
+bool ThreadPool::waitForTask(ulong threadId, Parker& parker, std::chrono::high_resolution_clock::time_point& lastTime)
+{
+    // 1. 有限次数的自旋和让出CPU 短时间内到达的任务不需要经过睡眠和唤醒
+    spinningThreadSize_ ++;
+    for (int i = 0; i < spinCount_ + yieldCount_; i++)
+    {
+        if (taskSize_.load(std::memory_order_relaxed) > 0)
+        {
+            spinningThreadSize_ --;
+            return true;
+        }
+        if (i < spinCount_) cpuRelax();
+        else std::this_thread::yield();
+    }
+    spinningThreadSize_ --;
+
+    // 2. 先登记为睡眠线程再检查任务数 和提交者的检查配合避免丢失唤醒
+    {
+        std::unique_lock<std::mutex> lk(idleMtx_);
+        parked_.push_back(ParkedThread{&parker, curNode_});
+        sleepingThreadSize_ ++;
+    }
+    if (taskSize_ > 0)
+    {
+        cancelPark(parker);
+        return true;
+    }
+    if (!isPoolRunning_)
+    {
+        cancelPark(parker);
+        exitThread(threadId, false);
+        return false;
+    }
+
+    curStats_->parked();
+    if (poolMode_ != MODE_CACHED)
+    {
+        parker.park();
+        return true;
+    }
+
+    // cached模式下空闲超过idleTimeout_的线程退出 在截止时间精确醒来 不需要轮询
+    auto deadline = lastTime + idleTimeout_;
+    if (parker.parkUntil(std::chrono::steady_clock::now() + (deadline - std::chrono::high_resolution_clock::now())))
+    {
+        return true;
+    }
+    if (cancelPark(parker) || taskSize_ > 0)
+    {
+        return true;
+    }
+    if (!retireThread())
+    {
+        // 已经是初始线程数 重新计时继续等待
+        lastTime = std::chrono::high_resolution_clock::now();
+        return true;
+    }
+    exitThread(threadId, true);
+    return false;
+}
+
+// --------------------运行时统计-------------------------------
 
-            task = taskQue_.front();
-            taskQue_.pop();
-            idleThreadSize_ --;
-            taskSize_ --;
-            if (taskQue_.size() > 0)
+WorkerStats* ThreadPool::claimStats(int& slot)
+{
+    std::unique_lock<std::mutex> lk(statsMtx_);
+    if (!freeStatsSlots_.empty())
+    {
+        slot = freeStatsSlots_.back();
+        freeStatsSlots_.pop_back();
+    }
+    else
+    {
+        slot = workerStats_.size();
+        workerStats_.push_back(std::make_unique<WorkerStats>());
+        statsActive_.push_back(false);
+    }
+    statsActive_[slot] = true;
+    curStats_ = workerStats_[slot].get();
+    curStats_->threadStarted(statsNow());
+    return curStats_;
+}
+
+void ThreadPool::releaseStats(WorkerStats* stats)
+{
+    std::unique_lock<std::mutex> lk(statsMtx_);
+    for (size_t i = 0; i < workerStats_.size(); i++)
+    {
+        if (workerStats_[i].get() == stats)
+        {
+            statsActive_[i] = false;
+            freeStatsSlots_.push_back(i);
+            break;
+        }
+    }
+}
+
+ThreadPoolStats ThreadPool::stats() const
+{
+    ThreadPoolStats result;
+    result.threads = curThreadSize_;
+    result.idleThreads = idleThreadSize_;
+    result.queuedTasks = taskSize_;
+    result.rejectedTasks = rejectedTasks_.load(std::memory_order_relaxed);
+    result.droppedTasks = droppedTasks_.load(std::memory_order_relaxed);
+    result.callerRunsTasks = callerRunsTasks_.load(std::memory_order_relaxed);
+    result.cancelledTasks = cancelledTasks_.load(std::memory_order_relaxed);
+
+    {
+        std::unique_lock<std::mutex> lk(statsMtx_);
+        result.workers.resize(workerStats_.size());
+        for (size_t i = 0; i < workerStats_.size(); i++)
+        {
+            result.workers[i].active = statsActive_[i];
+            workerStats_[i]->snapshot(result.workers[i], result);
+        }
+    }
+
+    std::unique_lock<std::mutex> lk(groupMtx_);
+    result.groups.resize(groups_.size());
+    for (size_t i = 0; i < groups_.size(); i++)
+    {
+        TaskGroupStats& group = result.groups[i];
+        const GroupInfo& info = *groups_[i];
+        group.name = info.name;
+        group.weight = groupQue_.weight(i);
+        group.capacity = groupQue_.capacity(i);
+        group.queuedTasks = groupQue_.size(i);
+        group.submittedTasks = info.submitted.load(std::memory_order_relaxed);
+        group.executedTasks = info.executed.load(std::memory_order_relaxed);
+        group.rejectedTasks = info.rejected.load(std::memory_order_relaxed);
+        group.droppedTasks = info.dropped.load(std::memory_order_relaxed);
+        info.stats.snapshot(group);
+    }
+    return result;
+}
+
+// --------------------无锁调度实现-------------------------------
+
+thread_local ThreadPool* ThreadPool::curPool_ = nullptr;
+thread_local ThreadPool::Worker* ThreadPool::curWorker_ = nullptr;
+thread_local WorkerStats* ThreadPool::curStats_ = nullptr;
+thread_local ThreadPool::PendingBatch* ThreadPool::curBatch_ = nullptr;
+thread_local int ThreadPool::curNode_ = -1;
+thread_local const ThreadPool::TaskControl* ThreadPool::submitControl_ = nullptr;
+thread_local const char* ThreadPool::cancelReason_ = nullptr;
+thread_local bool ThreadPool::submitMustRun_ = false;
+
+bool ThreadPool::popLockFreeTask(QueuedTask& task)
+{
+    // 按优先级从高到低检查 每agingThreshHold_次改为从低优先级开始检查 防止低优先级任务饥饿
+    static thread_local unsigned popCount = 0;
+    bool aged = ++popCount % agingThreshHold_ == 0;
+    for (int i = 0; i < PRIORITY_LEVELS; i++)
+    {
+        if (popLane(aged ? PRIORITY_LEVELS - 1 - i : i, task))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ThreadPool::popLane(int lane, QueuedTask& task)
+{
+    // 先取本节点的队列 再按顺序取其他节点的
+    int self = curNode_ >= 0 ? curNode_ % nodeCount_ : 0;
+    for (int i = 0; i < nodeCount_; i++)
+    {
+        if (popQueue(laneQue((self + i) % nodeCount_, lane), task))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ThreadPool::pushLane(MpmcQueue<QueuedTask>& que, QueuedTask& item)
+{
+    if (laneTaskSize_.fetch_add(1, std::memory_order_relaxed) >= taskQueMaxThreshHold_)
+    {
+        laneTaskSize_.fetch_sub(1, std::memory_order_relaxed);
+        return false;
+    }
+    if (que.tryPush(std::move(item))) return true;
+    laneTaskSize_.fetch_sub(1, std::memory_order_relaxed);
+    return false;
+}
+
+bool ThreadPool::evictLane(int node, Priority priority, QueuedTask& oldest)
+{
+    for (int lane = PRIORITY_LEVELS - 1; lane >= priority; lane--)
+    {
+        for (int i = 0; i < nodeCount_; i++)
+        {
+            if (laneQue((node + i) % nodeCount_, lane).tryPop(oldest))
             {
-                notEmpty_.notify_all();
+                laneTaskSize_.fetch_sub(1, std::memory_order_relaxed);
+                return true;
             }
-            notFull_.notify_all();
         }
-        if (task != nullptr)
+    }
+    return false;
+}
+
+bool ThreadPool::popQueue(MpmcQueue<QueuedTask>& que, QueuedTask& task)
+{
+    if (!que.tryPop(task)) return false;
+    laneTaskSize_.fetch_sub(1, std::memory_order_relaxed);
+
+    // 和提交者登记fullWaiters_之后的重试配对 保证腾出位置后能唤醒等待者
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (fullWaiters_.load(std::memory_order_relaxed) > 0)
+    {
+        std::unique_lock<std::mutex> lk(taskQueMtx_);
+        notFull_.notify_one();
+    }
+    return true;
+}
+
+ThreadPool::QueuedTask* ThreadPool::newQueuedTask(Task&& task, int64_t now)
+{
+    TaskAllocator<QueuedTask> alloc(memResource_);
+    QueuedTask* ptr = alloc.allocate(1);
+    return new (ptr) QueuedTask(std::move(task), now);
+}
+
+void ThreadPool::deleteQueuedTask(QueuedTask* ptr)
+{
+    ptr->~QueuedTask();
+    TaskAllocator<QueuedTask>(memResource_).deallocate(ptr, 1);
+}
+
+bool ThreadPool::stealTask(int self, QueuedTask& task)
+{
+    Worker* worker = workers_[self].get();
+    // xorshift随机选择起始的窃取对象 避免所有线程同时窃取同一个队列
+    uint32_t x = worker->seed;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    worker->seed = x;
+
+    int n = workers_.size();
+    int start = x % n;
+    for (int i = 0; i < n; i++)
+    {
+        int victim = (start + i) % n;
+        if (victim == self) continue;
+        QueuedTask* ptr = nullptr;
+        if (workers_[victim]->deque.steal(ptr))
+        {
+            task = std::move(*ptr);
+            deleteQueuedTask(ptr);
+            curStats_->stolen();
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ThreadPool::findTask(QueuedTask& task)
+{
+    if (groupTaskSize_.load(std::memory_order_relaxed) == 0)
+    {
+        return findUngroupedTask(task);
+    }
+    // 分组任务和未分组任务轮流取 任何一边积压都不会让另一边饿死
+    static thread_local bool groupFirst = false;
+    groupFirst = !groupFirst;
+    if (groupFirst)
+    {
+        return popGroupTask(task) || findUngroupedTask(task);
+    }
+    return findUngroupedTask(task) || popGroupTask(task);
+}
+
+bool ThreadPool::popGroupTask(QueuedTask& task)
+{
+    std::unique_lock<std::mutex> lk(groupMtx_);
+    if (!groupQue_.pop(task)) return false;
+    groupTaskSize_--;
+    if (groupFullWaiters_ > 0)
+    {
+        // 等待者可能在等不同的组
+        groupNotFull_.notify_all();
+    }
+    return true;
+}
+
+void ThreadPool::groupTaskFinished(GroupInfo& group, int64_t start, int64_t end)
+{
+    group.executed.fetch_add(1, std::memory_order_relaxed);
+    group.stats.taskFinished(start, end);
+}
+
+bool ThreadPool::findUngroupedTask(QueuedTask& task)
+{
+    if (schedMode_ == SCHED_SHARED_QUEUE)
+    {
+        return popSharedTask(task);
+    }
+
+    Worker* self = curWorker_;
+    if (self == nullptr)
+    {
+        return popLockFreeTask(task);
+    }
+
+    // 依次尝试: 有高优先级任务时先取注入队列 -> 自己的双端队列 -> 注入队列 -> 窃取其他线程
+    for (int node = 0; node < nodeCount_; node++)
+    {
+        if (laneQue(node, PRIORITY_HIGH).sizeApprox() > 0)
         {
-            task(); // 执行funtional<void()>
+            if (popLockFreeTask(task)) return true;
+            break;
         }
+    }
+    QueuedTask* ptr = nullptr;
+    if (self->deque.pop(ptr))
+    {
+        task = std::move(*ptr);
+        deleteQueuedTask(ptr);
+        return true;
+    }
+    return popLockFreeTask(task) || stealTask(self->index, task);
+}
 
-        idleThreadSize_ ++;
-        last_time = std::chrono::high_resolution_clock().now();
+size_t ThreadPool::findTasks(QueuedTask* tasks, size_t max)
+{
+    // 有分组任务时每次取一个 由findTask在分组和未分组任务之间轮转
+    if (max <= 1 || schedMode_ == SCHED_WORK_STEALING || groupTaskSize_.load(std::memory_order_relaxed) > 0)
+    {
+        return findTask(tasks[0]) ? 1 : 0;
+    }
+
+    // 队列中的任务平均分给所有线程 一个线程不会拿走其他线程能够并行执行的任务
+    size_t threads = std::max(curThreadSize_.load(std::memory_order_relaxed), 1);
+    size_t share = (taskSize_.load(std::memory_order_relaxed) + threads - 1) / threads;
+    size_t want = std::min(std::max(share, (size_t)1), max);
+    if (schedMode_ == SCHED_SHARED_QUEUE)
+    {
+        return popSharedTasks(tasks, want);
+    }
+    size_t count = 0;
+    while (count < want && popLockFreeTask(tasks[count]))
+    {
+        count++;
     }
+    return count;
 }
 
 // --------------------Thread类方法实现-------------------------------
 
-ulong Thread::idIdx_ = 0;
+std::atomic<ulong> Thread::idIdx_(0);
 
-Thread::Thread(ThreadFunc func) : func_(func), threadId_(idIdx_ ++)
+Thread::Thread(ThreadFunc func) : func_(func), threadId_(idIdx_.fetch_add(1, std::memory_order_relaxed))
 {}
 
 Thread::~Thread()
@@ -0,0 +1,257 @@
+#include "../include/timingwheel.h"
+
+const int NODE_BLOCK_SIZE = 256; // 节点按块分配
+
+TimingWheel::TimingWheel() : cur_(0), count_(0), freeList_(nullptr)
+{
+    for (Link& head : slots_)
+    {
+        head.prev = &head;
+        head.next = &head;
+    }
+    for (uint64_t& bits : rootBits_)
+    {
+        bits = 0;
+    }
+}
+
+TimingWheel::~TimingWheel()
+{
+    // 节点的任务由blocks_析构时一起释放
+}
+
+TimingWheel::Node* TimingWheel::allocNode()
+{
+    if (freeList_ == nullptr)
+    {
+        std::unique_ptr<Node[]> block(new Node[NODE_BLOCK_SIZE]);
+        for (int i = 0; i < NODE_BLOCK_SIZE; i++)
+        {
+            block[i].seq = 0;
+            block[i].slot = -1;
+            block[i].next = i + 1 < NODE_BLOCK_SIZE ? &block[i + 1] : nullptr;
+        }
+        freeList_ = &block[0];
+        blocks_.push_back(std::move(block));
+    }
+    Node* node = freeList_;
+    freeList_ = static_cast<Node*>(node->next);
+    return node;
+}
+
+void TimingWheel::freeNode(Node* node)
+{
+    node->task = nullptr;
+    node->periodic.reset();
+    node->slot = -1;
+    node->seq++;
+    node->next = freeList_;
+    freeList_ = node;
+}
+
+void TimingWheel::place(Node* node)
+{
+    uint64_t expire = node->expire < cur_ ? cur_ : node->expire;
+    uint64_t delta = expire - cur_;
+    if (delta > MAX_DELTA)
+    {
+        // 超出时间轮范围的先放在最高层 重新分配时按真实的到期时间再次放置
+        delta = MAX_DELTA;
+        expire = cur_ + MAX_DELTA;
+    }
+
+    int slot;
+    if (delta < (uint64_t)ROOT_SLOTS)
+    {
+        slot = expire & (ROOT_SLOTS - 1);
+        rootBits_[slot / 64] |= uint64_t(1) << (slot % 64);
+    }
+    else
+    {
+        int level = 1;
+        while (delta >= (uint64_t(1) << (ROOT_BITS + level * LEVEL_BITS)))
+        {
+            level++;
+        }
+        int shift = ROOT_BITS + (level - 1) * LEVEL_BITS;
+        slot = ROOT_SLOTS + (level - 1) * LEVEL_SLOTS + (int)((expire >> shift) & (LEVEL_SLOTS - 1));
+    }
+
+    Link& head = slots_[slot];
+    node->slot = slot;
+    node->prev = head.prev;
+    node->next = &head;
+    head.prev->next = node;
+    head.prev = node;
+}
+
+void TimingWheel::unlink(Node* node)
+{
+    node->prev->next = node->next;
+    node->next->prev = node->prev;
+    int slot = node->slot;
+    if (slot < ROOT_SLOTS && slots_[slot].next == &slots_[slot])
+    {
+        rootBits_[slot / 64] &= ~(uint64_t(1) << (slot % 64));
+    }
+}
+
+TimerId TimingWheel::add(uint64_t expire, Task task, uint64_t period)
+{
+    Node* node = allocNode();
+    node->expire = expire;
+    node->period = period;
+    if (period > 0)
+    {
+        node->periodic = std::make_shared<Periodic>();
+        node->periodic->func = std::move(task);
+    }
+    else
+    {
+        node->task = std::move(task);
+    }
+    place(node);
+    count_++;
+    return TimerId{node, node->seq};
+}
+
+bool TimingWheel::cancel(TimerId id)
+{
+    Node* node = static_cast<Node*>(id.node);
+    if (node == nullptr || node->seq != id.seq || node->slot < 0)
+    {
+        return false;
+    }
+    unlink(node);
+    freeNode(node);
+    count_--;
+    return true;
+}
+
+void TimingWheel::cascade(int level, int index)
+{
+    // 把上层一个槽中的定时器按到期时间重新放到下层
+    Link& head = slots_[ROOT_SLOTS + (level - 1) * LEVEL_SLOTS + index];
+    Link* link = head.next;
+    head.prev = &head;
+    head.next = &head;
+    while (link != &head)
+    {
+        Node* node = static_cast<Node*>(link);
+        link = link->next;
+        place(node);
+    }
+}
+
+void TimingWheel::advance(uint64_t now, std::vector<Task>& expired)
+{
+    while (cur_ <= now)
+    {
+        if (count_ == 0)
+        {
+            // 没有定时器时直接跳到now之后
+            cur_ = now + 1;
+            return ;
+        }
+
+        // 当前槽为空并且不需要分配上层的槽时 直接跳到下一个有事可做的tick 长时间空闲后不需要逐个tick推进
+        int index = cur_ & (ROOT_SLOTS - 1);
+        if (index != 0 && (rootBits_[index / 64] & (uint64_t(1) << (index % 64))) == 0)
+        {
+            uint64_t next = nextTick();
+            if (next > now)
+            {
+                cur_ = now + 1;
+                return ;
+            }
+            cur_ = next;
+            index = cur_ & (ROOT_SLOTS - 1);
+        }
+
+        // 到达第0层一圈的起点时 依次把上层对应的槽分配下来 上层的槽也到达起点时继续向上
+        for (int level = 1; index == 0 && level < LEVELS; level++)
+        {
+            index = (cur_ >> (ROOT_BITS + (level - 1) * LEVEL_BITS)) & (LEVEL_SLOTS - 1);
+            cascade(level, index);
+        }
+
+        int slot = cur_ & (ROOT_SLOTS - 1);
+        Link& head = slots_[slot];
+        rootBits_[slot / 64] &= ~(uint64_t(1) << (slot % 64));
+        Link* link = head.next;
+        head.prev = &head;
+        head.next = &head;
+        while (link != &head)
+        {
+            Node* node = static_cast<Node*>(link);
+            link = link->next;
+            if (node->expire > cur_)
+            {
+                // 超出范围被提前放下来的定时器
+                place(node);
+                continue;
+            }
+            if (node->period == 0)
+            {
+                expired.push_back(std::move(node->task));
+                freeNode(node);
+                count_--;
+                continue;
+            }
+
+            // 周期任务 上一次还在执行时跳过 下一次从now之后的周期点开始 错过的不补
+            std::shared_ptr<Periodic> periodic = node->periodic;
+            if (!periodic->running.exchange(true, std::memory_order_acquire))
+            {
+                expired.push_back([periodic]() {
+                    periodic->func();
+                    periodic->running.store(false, std::memory_order_release);
+                });
+            }
+            node->expire += node->period;
+            if (node->expire <= now)
+            {
+                node->expire += (now - node->expire) / node->period * node->period + node->period;
+            }
+            place(node);
+        }
+        cur_++;
+    }
+}
+
+uint64_t TimingWheel::nextTick() const
+{
+    if (count_ == 0) return UINT64_MAX;
+
+    // 第0层: 从当前槽开始绕一圈找第一个非空槽
+    uint64_t next = UINT64_MAX;
+    int start = cur_ & (ROOT_SLOTS - 1);
+    for (int i = 0; i <= ROOT_SLOTS / 64; i++)
+    {
+        int word = (start / 64 + i) % (ROOT_SLOTS / 64);
+        uint64_t bits = rootBits_[word];
+        if (i == 0) bits &= ~uint64_t(0) << (start % 64);
+        else if (i == ROOT_SLOTS / 64) bits &= ~(~uint64_t(0) << (start % 64));
+        if (bits != 0)
+        {
+            int slot = word * 64 + __builtin_ctzll(bits);
+            next = cur_ + ((slot - start) & (ROOT_SLOTS - 1));
+            break;
+        }
+    }
+
+    // 上层: 每个非空槽下一次被分配下来的时刻 即该层索引等于槽号且低位全为0的第一个tick
+    for (int level = 1; level < LEVELS; level++)
+    {
+        int shift = ROOT_BITS + (level - 1) * LEVEL_BITS;
+        uint64_t base = (cur_ + (uint64_t(1) << shift) - 1) >> shift;
+        for (int j = 0; j < LEVEL_SLOTS; j++)
+        {
+            const Link& head = slots_[ROOT_SLOTS + (level - 1) * LEVEL_SLOTS + j];
+            if (head.next == &head) continue;
+            uint64_t tick = (base + ((j - base) & (LEVEL_SLOTS - 1))) << shift;
+            if (tick < next) next = tick;
+        }
+    }
+    return next;
+}
@@ -0,0 +1,206 @@
+#include "../include/topology.h"
+
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <map>
+#include <thread>
+#include <tuple>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <dirent.h>
+#endif
+
+namespace
+{
+
+// 解析"0-3,8,10-11"格式的CPU列表
+std::vector<int> parseCpuList(const std::string& text)
+{
+    std::vector<int> result;
+    std::stringstream ss(text);
+    std::string item;
+    while (std::getline(ss, item, ','))
+    {
+        if (item.empty() || item[0] < '0' || item[0] > '9') continue;
+        size_t dash = item.find('-');
+        int lo = std::stoi(item.substr(0, dash));
+        int hi = dash == std::string::npos ? lo : std::stoi(item.substr(dash + 1));
+        for (int i = lo; i <= hi; i++) result.push_back(i);
+    }
+    return result;
+}
+
+bool readFile(const std::string& path, std::string& text)
+{
+    std::ifstream in(path);
+    if (!in) return false;
+    std::getline(in, text);
+    return true;
+}
+
+int readInt(const std::string& path, int fallback)
+{
+    std::string text;
+    if (!readFile(path, text) || text.empty()) return fallback;
+    return std::atoi(text.c_str());
+}
+
+bool allowedCpu(int cpu)
+{
+#ifdef __linux__
+    static cpu_set_t mask;
+    static bool valid = sched_getaffinity(0, sizeof(mask), &mask) == 0;
+    if (!valid || cpu >= CPU_SETSIZE) return true;
+    return CPU_ISSET(cpu, &mask);
+#else
+    (void)cpu;
+    return true;
+#endif
+}
+
+}
+
+const CpuTopology& CpuTopology::system()
+{
+    static const CpuTopology topology = detect("/sys/devices/system");
+    return topology;
+}
+
+CpuTopology CpuTopology::detect(const std::string& sysRoot)
+{
+    CpuTopology topo;
+    std::string text;
+    std::vector<int> online;
+    if (readFile(sysRoot + "/cpu/online", text))
+    {
+        online = parseCpuList(text);
+    }
+    bool real = sysRoot == "/sys/devices/system";
+
+    std::map<int, int> cpuNode;
+#ifdef __linux__
+    if (DIR* dir = opendir((sysRoot + "/node").c_str()))
+    {
+        while (dirent* entry = readdir(dir))
+        {
+            std::string name = entry->d_name;
+            if (name.compare(0, 4, "node") != 0 || name.size() == 4 || name[4] < '0' || name[4] > '9') continue;
+            int node = std::atoi(name.c_str() + 4);
+            if (readFile(sysRoot + "/node/" + name + "/cpulist", text))
+            {
+                for (int cpu : parseCpuList(text)) cpuNode[cpu] = node;
+            }
+        }
+        closedir(dir);
+    }
+#endif
+    for (int id : online)
+    {
+        if (real && !allowedCpu(id)) continue;
+        std::string base = sysRoot + "/cpu/cpu" + std::to_string(id) + "/topology/";
+        Cpu cpu;
+        cpu.id = id;
+        cpu.core = readInt(base + "core_id", id);
+        cpu.package = readInt(base + "physical_package_id", 0);
+        auto it = cpuNode.find(id);
+        cpu.node = it == cpuNode.end() ? 0 : it->second;
+        topo.cpus_.push_back(cpu);
+    }
+
+    // sysfs中的节点编号可能不连续 也可能有节点上没有允许使用的CPU 按编号顺序重新编号
+    std::map<int, int> nodeIds;
+    for (const Cpu& cpu : topo.cpus_) nodeIds[cpu.node] = 0;
+    int next = 0;
+    for (auto& kv : nodeIds) kv.second = next++;
+    for (Cpu& cpu : topo.cpus_) cpu.node = nodeIds[cpu.node];
+
+    if (topo.cpus_.empty())
+    {
+        int n = std::max(1u, std::thread::hardware_concurrency());
+        for (int i = 0; i < n; i++) topo.cpus_.push_back(Cpu{i, i, 0, 0});
+    }
+
+    topo.nodeCount_ = 1;
+    for (const Cpu& cpu : topo.cpus_)
+    {
+        topo.nodeCount_ = std::max(topo.nodeCount_, cpu.node + 1);
+        if (cpu.id >= (int)topo.cpuNode_.size()) topo.cpuNode_.resize(cpu.id + 1, 0);
+        topo.cpuNode_[cpu.id] = cpu.node;
+    }
+    return topo;
+}
+
+int CpuTopology::nodeOf(int cpu) const
+{
+    if (cpu < 0 || cpu >= (int)cpuNode_.size()) return 0;
+    return cpuNode_[cpu];
+}
+
+std::vector<CpuTopology::Cpu> CpuTopology::placement(AffinityMode mode) const
+{
+    // compact: 节点 -> 封装 -> 物理核 -> 超线程 依次排列
+    std::vector<Cpu> compact = cpus_;
+    std::sort(compact.begin(), compact.end(), [](const Cpu& a, const Cpu& b) {
+        return std::make_tuple(a.node, a.package, a.core, a.id) < std::make_tuple(b.node, b.package, b.core, b.id);
+    });
+    if (mode != AFFINITY_SPREAD) return compact;
+
+    // spread: 每个节点内先取每个物理核的第一个超线程 再取第二个...
+    std::vector<std::vector<Cpu>> perNode(nodeCount_);
+    for (const Cpu& cpu : compact)
+    {
+        perNode[cpu.node].push_back(cpu);
+    }
+    for (auto& cpus : perNode)
+    {
+        // rank为CPU在所属物理核内的序号
+        std::vector<int> rank(cpus.size(), 0);
+        for (size_t k = 1; k < cpus.size(); k++)
+        {
+            bool sameCore = cpus[k].package == cpus[k - 1].package && cpus[k].core == cpus[k - 1].core;
+            rank[k] = sameCore ? rank[k - 1] + 1 : 0;
+        }
+        std::vector<size_t> order(cpus.size());
+        for (size_t k = 0; k < order.size(); k++) order[k] = k;
+        std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {return rank[a] < rank[b];});
+        std::vector<Cpu> sorted;
+        for (size_t k : order) sorted.push_back(cpus[k]);
+        cpus.swap(sorted);
+    }
+
+    // 节点之间轮流取
+    std::vector<Cpu> result;
+    for (size_t round = 0; result.size() < compact.size(); round++)
+    {
+        for (auto& cpus : perNode)
+        {
+            if (round < cpus.size()) result.push_back(cpus[round]);
+        }
+    }
+    return result;
+}
+
+bool pinCurrentThread(int cpu)
+{
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    (void)cpu;
+    return false;
+#endif
+}
+
+int currentCpu()
+{
+#ifdef __linux__
+    return sched_getcpu();
+#else
+    return -1;
+#endif
+}
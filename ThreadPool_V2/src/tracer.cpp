@@ -0,0 +1,353 @@
+#include "../include/tracer.h"
+
+#ifdef THREADPOOL_TRACING
+
+#include <chrono>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+namespace
+{
+
+// 开启追踪后至少经过这么久才换算时间戳 间隔太短时TSC频率的误差较大
+const std::chrono::milliseconds CALIBRATE_MIN(10);
+
+enum RecordKind : uint8_t
+{
+    RECORD_TASK,
+    RECORD_INSTANT
+};
+
+struct Record
+{
+    uint64_t submit;
+    uint64_t dequeue;
+    uint64_t start;     // 瞬时事件的时间
+    uint64_t end;
+    const char* name;
+    uint32_t submitThread;
+    uint8_t kind;
+};
+
+// 单生产者单消费者环形缓冲区 生产者是注册它的线程 消费者是writeChromeTrace
+struct Ring
+{
+    alignas(64) std::atomic<size_t> head{0};   // 已经写出的位置
+    alignas(64) std::atomic<size_t> tail{0};   // 所属线程写入的位置
+    std::atomic_bool orphan{false};            // 所属线程已经退出 写出剩余记录后释放
+    uint32_t id = 0;
+    char name[32] = {};                        // 由State::mtx保护
+    Record* records = nullptr;                 // 第一次写入时分配 只提交任务的线程不分配
+    ~Ring() { delete[] records; }
+};
+
+struct State
+{
+    std::mutex mtx;                    // 保护rings、线程名和时间基准 同一时间只有一个writeChromeTrace
+    std::vector<Ring*> rings;
+    std::atomic<uint32_t> nextId{1};
+    std::atomic<uint64_t> dropped{0};
+    uint64_t baseTicks = 0;            // 第一次开启追踪时的时间戳 输出的时间从这里开始
+    int64_t baseNs = 0;
+    uint64_t nextFlow = 1;             // 异步事件和箭头的编号
+};
+
+// 不析构 进程退出时其他线程可能仍在记录
+State& state()
+{
+    static State* s = new State;
+    return *s;
+}
+
+int64_t steadyNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+thread_local Ring* localRing = nullptr;
+
+// 线程退出时把缓冲区交给writeChromeTrace释放 之后本线程的记录直接丢弃
+struct LocalRing
+{
+    ~LocalRing()
+    {
+        exited() = true;
+        if (localRing != nullptr)
+        {
+            localRing->orphan.store(true, std::memory_order_release);
+            localRing = nullptr;
+        }
+    }
+
+    static bool& exited()
+    {
+        static thread_local bool flag = false;
+        return flag;
+    }
+};
+
+// 取得当前线程缓冲区的下一个位置 缓冲区满时返回nullptr
+Record* reserve(State& s)
+{
+    Ring* ring = localRing;
+    if (ring->records == nullptr)
+    {
+        ring->records = new Record[Tracer::RING_SIZE];
+    }
+    size_t tail = ring->tail.load(std::memory_order_relaxed);
+    if (tail - ring->head.load(std::memory_order_acquire) >= Tracer::RING_SIZE)
+    {
+        s.dropped.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+    return &ring->records[tail % Tracer::RING_SIZE];
+}
+
+void publish()
+{
+    Ring* ring = localRing;
+    ring->tail.store(ring->tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+// 写出JSON字符串 转义引号、反斜杠和控制字符
+void writeString(FILE* out, const char* str)
+{
+    fputc('"', out);
+    for (const char* p = str; *p != '\0'; p++)
+    {
+        unsigned char c = *p;
+        if (c == '"' || c == '\\') fprintf(out, "\\%c", c);
+        else if (c < 0x20) fprintf(out, "\\u%04x", c);
+        else fputc(c, out);
+    }
+    fputc('"', out);
+}
+
+// 原始时间戳换算为相对于开启追踪时刻的微秒
+struct TimeBase
+{
+    uint64_t ticks;
+    double nsPerTick;
+    double us(uint64_t t) const { return (double)(int64_t)(t - ticks) * nsPerTick / 1000.0; }
+};
+
+TimeBase calibrate(State& s)
+{
+#ifdef THREADPOOL_TRACE_TSC
+    int64_t elapsed = steadyNs() - s.baseNs;
+    auto least = std::chrono::duration_cast<std::chrono::nanoseconds>(CALIBRATE_MIN).count();
+    if (elapsed < least)
+    {
+        std::this_thread::sleep_for(std::chrono::nanoseconds(least - elapsed));
+    }
+    uint64_t ticks = Tracer::now();
+    int64_t ns = steadyNs();
+    return TimeBase{s.baseTicks, ticks > s.baseTicks ? (double)(ns - s.baseNs) / (double)(ticks - s.baseTicks) : 1.0};
+#else
+    return TimeBase{s.baseTicks, 1.0};
+#endif
+}
+
+class EventWriter
+{
+    public:
+        EventWriter(FILE* out, const TimeBase& base) : out_(out), base_(base), first_(true), pid_(getpid()) {}
+
+        void threadName(uint32_t tid, const char* name)
+        {
+            begin();
+            fprintf(out_, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%u,\"args\":{\"name\":", pid_, tid);
+            writeString(out_, name);
+            fputs("}}", out_);
+        }
+
+        // 执行线程上的执行区间 提交线程上的排队区间 以及从提交指向开始执行的箭头
+        void task(uint32_t tid, const Record& r, uint64_t flow)
+        {
+            const char* name = r.name != nullptr ? r.name : "task";
+            begin();
+            fputs("{\"name\":", out_);
+            writeString(out_, name);
+            fprintf(out_, ",\"cat\":\"task\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":%u,"
+                    "\"args\":{\"submit_thread\":%u,\"queued_us\":%.3f,\"dequeue_to_start_us\":%.3f}}",
+                    base_.us(r.start), base_.us(r.end) - base_.us(r.start), pid_, tid,
+                    r.submitThread, base_.us(r.dequeue) - base_.us(r.submit), base_.us(r.start) - base_.us(r.dequeue));
+
+            asyncEvent(name, "b", r.submit, r.submitThread, flow);
+            asyncEvent(name, "e", r.dequeue, r.submitThread, flow);
+
+            begin();
+            fprintf(out_, "{\"name\":\"submit\",\"cat\":\"flow\",\"ph\":\"s\",\"id\":%llu,\"ts\":%.3f,\"pid\":%d,\"tid\":%u}",
+                    (unsigned long long)flow, base_.us(r.submit), pid_, r.submitThread);
+            begin();
+            fprintf(out_, "{\"name\":\"submit\",\"cat\":\"flow\",\"ph\":\"f\",\"bp\":\"e\",\"id\":%llu,\"ts\":%.3f,\"pid\":%d,\"tid\":%u}",
+                    (unsigned long long)flow, base_.us(r.start), pid_, tid);
+        }
+
+        void instant(uint32_t tid, const Record& r)
+        {
+            begin();
+            fputs("{\"name\":", out_);
+            writeString(out_, r.name);
+            fprintf(out_, ",\"cat\":\"pool\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,\"pid\":%d,\"tid\":%u}", base_.us(r.start), pid_, tid);
+        }
+
+    private:
+        void begin()
+        {
+            if (!first_) fputs(",\n", out_);
+            first_ = false;
+        }
+
+        void asyncEvent(const char* name, const char* ph, uint64_t ts, uint32_t tid, uint64_t id)
+        {
+            begin();
+            fputs("{\"name\":", out_);
+            writeString(out_, name);
+            fprintf(out_, ",\"cat\":\"queue\",\"ph\":\"%s\",\"id\":%llu,\"ts\":%.3f,\"pid\":%d,\"tid\":%u}",
+                    ph, (unsigned long long)id, base_.us(ts), pid_, tid);
+        }
+
+        FILE* out_;
+        TimeBase base_;
+        bool first_;
+        int pid_;
+};
+
+}
+
+void Tracer::enable(bool on)
+{
+    if (on)
+    {
+        State& s = state();
+        std::lock_guard<std::mutex> lock(s.mtx);
+        if (s.baseTicks == 0)
+        {
+            s.baseTicks = now();
+            s.baseNs = steadyNs();
+        }
+    }
+    enabled_.store(on, std::memory_order_relaxed);
+}
+
+uint32_t Tracer::registerThread()
+{
+    // 线程的缓冲区已经交出
+    if (LocalRing::exited()) return 0;
+    static thread_local LocalRing local;
+
+    State& s = state();
+    Ring* ring = new Ring;
+    ring->id = s.nextId.fetch_add(1, std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock(s.mtx);
+        s.rings.push_back(ring);
+    }
+    localRing = ring;
+    threadId_ = ring->id;
+    return ring->id;
+}
+
+void Tracer::setThreadName(const char* name)
+{
+    if (threadId() == 0 || localRing == nullptr) return;
+    State& s = state();
+    std::lock_guard<std::mutex> lock(s.mtx);
+    strncpy(localRing->name, name, sizeof(localRing->name) - 1);
+}
+
+void Tracer::record(const TraceStamp& stamp, uint64_t dequeued, uint64_t start, uint64_t end)
+{
+    State& s = state();
+    if (threadId() == 0 || localRing == nullptr)
+    {
+        s.dropped.fetch_add(1, std::memory_order_relaxed);
+        return ;
+    }
+    Record* r = reserve(s);
+    if (r == nullptr) return ;
+    r->submit = stamp.submitTime;
+    r->dequeue = dequeued;
+    r->start = start;
+    r->end = end;
+    r->name = stamp.label;
+    r->submitThread = stamp.submitThread;
+    r->kind = RECORD_TASK;
+    publish();
+}
+
+void Tracer::recordInstant(const char* name)
+{
+    State& s = state();
+    if (threadId() == 0 || localRing == nullptr)
+    {
+        s.dropped.fetch_add(1, std::memory_order_relaxed);
+        return ;
+    }
+    Record* r = reserve(s);
+    if (r == nullptr) return ;
+    r->start = now();
+    r->name = name;
+    r->kind = RECORD_INSTANT;
+    publish();
+}
+
+void Tracer::writeChromeTrace(FILE* out)
+{
+    State& s = state();
+    std::lock_guard<std::mutex> lock(s.mtx);
+    EventWriter writer(out, calibrate(s));
+
+    fputs("{\"traceEvents\":[\n", out);
+    for (size_t i = 0; i < s.rings.size(); )
+    {
+        Ring* ring = s.rings[i];
+        char name[48];
+        if (ring->name[0] != '\0') snprintf(name, sizeof(name), "%s", ring->name);
+        else snprintf(name, sizeof(name), "thread %u", ring->id);
+        writer.threadName(ring->id, name);
+
+        size_t head = ring->head.load(std::memory_order_relaxed);
+        size_t tail = ring->tail.load(std::memory_order_acquire);
+        for (; head != tail; head++)
+        {
+            const Record& r = ring->records[head % RING_SIZE];
+            if (r.kind == RECORD_TASK) writer.task(ring->id, r, s.nextFlow++);
+            else writer.instant(ring->id, r);
+        }
+        ring->head.store(head, std::memory_order_release);
+
+        // 所属线程已经退出并且记录已经写出
+        if (ring->orphan.load(std::memory_order_acquire) && head == ring->tail.load(std::memory_order_acquire))
+        {
+            delete ring;
+            s.rings[i] = s.rings.back();
+            s.rings.pop_back();
+            continue;
+        }
+        i++;
+    }
+    fprintf(out, "\n],\"displayTimeUnit\":\"ns\",\"otherData\":{\"dropped\":\"%llu\"}}\n",
+            (unsigned long long)s.dropped.load(std::memory_order_relaxed));
+    fflush(out);
+}
+
+bool Tracer::writeChromeTrace(const char* path)
+{
+    FILE* out = fopen(path, "w");
+    if (out == nullptr) return false;
+    writeChromeTrace(out);
+    bool ok = !ferror(out);
+    return fclose(out) == 0 && ok;
+}
+
+uint64_t Tracer::droppedCount()
+{
+    return state().dropped.load(std::memory_order_relaxed);
+}
+
+#endif
@@ -0,0 +1,85 @@
+#include "threadpool.h"
+#include "check.h"
+
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <future>
+#include <memory_resource>
+
+// 内存资源: setMemoryResource覆盖放不进Task内部缓冲区的任务 TaskMemoryCache的0字节分配
+
+// 统计分配和释放次数的memory_resource 实际内存来自全局堆
+class CountingResource : public std::pmr::memory_resource
+{
+    public:
+        std::atomic_int allocated{0};
+        std::atomic_int deallocated{0};
+
+    private:
+        void* do_allocate(size_t bytes, size_t alignment) override
+        {
+            allocated++;
+            return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+        }
+        void do_deallocate(void* ptr, size_t bytes, size_t alignment) override
+        {
+            deallocated++;
+            std::pmr::new_delete_resource()->deallocate(ptr, bytes, alignment);
+        }
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+        {
+            return this == &other;
+        }
+};
+
+static void testResource(SchedMode mode)
+{
+    CountingResource resource;
+    {
+        ThreadPool pool;
+        pool.setSchedMode(mode);
+        pool.setMemoryResource(&resource);
+        pool.start(2);
+
+        // 捕获的数据超过Task的内部缓冲区 可调用对象从resource分配
+        std::array<char, 256> big{};
+        big[0] = 7;
+        auto f = pool.submitTask([big]() {return (int)big[0];});
+        CHECK(f.get() == 7);
+        int before = resource.allocated;
+
+        std::promise<int> posted;
+        pool.post([big, &posted]() {posted.set_value(big[0]);});
+        CHECK(posted.get_future().get() == 7);
+        CHECK(resource.allocated > before);
+    }
+    // 线程池析构后所有任务都已经释放
+    CHECK(resource.allocated > 0);
+    CHECK(resource.allocated == resource.deallocated);
+}
+
+static void testZeroSize()
+{
+    // 0字节的请求也得到互不相同的内存块
+    void* a = TaskMemoryCache::allocate(0);
+    void* b = TaskMemoryCache::allocate(0);
+    CHECK(a != nullptr && b != nullptr && a != b);
+    TaskMemoryCache::deallocate(a, 0);
+    TaskMemoryCache::deallocate(b, 0);
+    // 释放后按最小的大小等级复用 必须能放下一个完整的内存块
+    void* c = TaskMemoryCache::allocate(TaskMemoryCache::BLOCK_ALIGN);
+    std::memset(c, 0xff, TaskMemoryCache::BLOCK_ALIGN);
+    TaskMemoryCache::deallocate(c, TaskMemoryCache::BLOCK_ALIGN);
+}
+
+int main()
+{
+    Logger::setLevel(LOG_OFF);
+    for (SchedMode mode : {SCHED_SHARED_QUEUE, SCHED_WORK_STEALING, SCHED_LOCKFREE_QUEUE})
+    {
+        testResource(mode);
+    }
+    testZeroSize();
+    return 0;
+}
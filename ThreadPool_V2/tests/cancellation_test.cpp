@@ -0,0 +1,113 @@
+#include "threadpool.h"
+#include "cancellation.h"
+#include "check.h"
+
+#include <atomic>
+#include <functional>
+#include <future>
+#include <thread>
+#include <vector>
+
+// 取消token和截止时间: 提交时和取出任务时检查 已经取消的任务不执行 future中保存TaskCancelledError
+
+template <typename T>
+static bool cancelled(std::future<T>& f)
+{
+    try
+    {
+        f.get();
+    }
+    catch (const TaskCancelledError&)
+    {
+        return true;
+    }
+    return false;
+}
+
+static void testDequeue(SchedMode mode)
+{
+    ThreadPool pool;
+    pool.setSchedMode(mode);
+    pool.start(1);
+
+    // 占住唯一的线程 任务在队列中时取消
+    std::promise<void> gate;
+    std::shared_future<void> opened = gate.get_future().share();
+    std::atomic_bool blocked(false);
+    pool.post([&blocked, opened]() {
+        blocked = true;
+        opened.wait();
+    });
+    while (!blocked) std::this_thread::yield();
+
+    std::atomic_int ran(0);
+    CancellationSource source;
+    TaskOptions options;
+    options.token = source.token();
+
+    auto single = pool.submitTask(options, [&]() {ran++; return 1;});
+    pool.post(options, [&]() {ran++;});
+    std::vector<std::function<int()>> funcs(3, [&]() {ran++; return 2;});
+    auto batch = pool.submitBatch(options, funcs.begin(), funcs.end());
+
+    // 另一个token没有取消 执行时可以通过current()取得
+    TaskOptions other;
+    other.token = CancellationSource().token();
+    auto kept = pool.submitTask(other, []() {return CancellationToken::current().cancellable() ? 7 : 0;});
+
+    source.cancel();
+    gate.set_value();
+
+    CHECK(cancelled(single));
+    for (auto& f : batch) CHECK(cancelled(f));
+    CHECK(kept.get() == 7);
+
+    // 提交时已经取消或过期的任务不入队
+    auto late = pool.submitTask(options, [&]() {ran++; return 1;});
+    CHECK(cancelled(late));
+    TaskOptions expired;
+    expired.deadline = std::chrono::steady_clock::now() - std::chrono::seconds(1);
+    auto overdue = pool.submitTask(expired, [&]() {ran++; return 1;});
+    CHECK(cancelled(overdue));
+
+    // post的任务没有future 等线程池执行完排在它后面的任务
+    pool.submitTask([]() {}).get();
+    CHECK(ran == 0);
+    CHECK(pool.stats().cancelledTasks == 7);
+}
+
+static void testCooperative()
+{
+    ThreadPool pool;
+    pool.start(2);
+
+    // 执行中的任务通过CancellationToken::current()检查取消
+    CancellationSource source;
+    TaskOptions options;
+    options.token = source.token();
+    std::atomic_bool started(false);
+    auto f = pool.submitTask(options, [&]() {
+        started = true;
+        while (!CancellationToken::current().isCancelled()) std::this_thread::yield();
+        CancellationToken::current().throwIfCancelled();
+        return 1;
+    });
+    while (!started) std::this_thread::yield();
+    source.cancel();
+    CHECK(cancelled(f));
+
+    // 没有token的任务中current()不可取消
+    auto plain = pool.submitTask([]() {return CancellationToken::current().cancellable();});
+    CHECK(!plain.get());
+}
+
+int main()
+{
+    Logger::setLevel(LOG_OFF);
+    for (SchedMode mode : {SCHED_SHARED_QUEUE, SCHED_WORK_STEALING, SCHED_LOCKFREE_QUEUE})
+    {
+        testDequeue(mode);
+    }
+    testCooperative();
+    return 0;
+}
@@ -0,0 +1,107 @@
+#include "threadpool.h"
+#include "poolfuture.h"
+#include "coro.h"
+#include "check.h"
+
+#include <future>
+#include <thread>
+#include <stdexcept>
+
+// C++20协程: schedule()切换线程、co_await PoolFuture、CoTask嵌套、syncWait和toFuture 以及等待空的CoTask
+#ifndef THREADPOOL_HAS_COROUTINES
+#error "coro_test must be compiled with C++20 coroutines"
+#endif
+
+static PoolFuture<int> readyFuture(ThreadPool& pool, int v)
+{
+    auto state = detail::makeState<int>();
+    state->setValue(v);
+    return detail::FutureAccess::make(std::move(state), &pool);
+}
+
+static CoTask<int> leaf(ThreadPool& pool, int v)
+{
+    co_await pool.schedule();
+    co_return v * 2;
+}
+
+static CoTask<int> handler(ThreadPool& pool, std::thread::id caller)
+{
+    co_await pool.schedule();
+    CHECK(std::this_thread::get_id() != caller);
+
+    // 已经就绪的future不挂起 直接继续
+    int a = co_await readyFuture(pool, 1);
+
+    int b = co_await submitAsync(pool, []() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        return 20;
+    });
+    int c = co_await leaf(pool, 100);
+    co_return a + b + c;
+}
+
+static CoTask<void> thrower(ThreadPool& pool)
+{
+    co_await pool.schedule();
+    throw std::runtime_error("boom");
+}
+
+// 等待大量很快完成的future 结果经常在await_ready和await_suspend之间就绪
+static CoTask<long> manyShort(ThreadPool& pool)
+{
+    long sum = 0;
+    for (int i = 0; i < 20000; i++)
+    {
+        sum += co_await submitAsync(pool, [i]() {return i % 3;});
+    }
+    co_return sum;
+}
+
+// 等待已经移走的CoTask
+static CoTask<int> awaitMoved(ThreadPool& pool)
+{
+    CoTask<int> task = leaf(pool, 1);
+    CoTask<int> other = std::move(task);
+    int v = co_await std::move(other);
+    co_return v + co_await std::move(task);
+}
+
+int main()
+{
+    Logger::setLevel(LOG_WARN);
+    ThreadPool pool;
+    pool.start(2);
+
+    CHECK(syncWait(handler(pool, std::this_thread::get_id())) == 1 + 20 + 200);
+
+    bool caught = false;
+    try
+    {
+        syncWait(thrower(pool));
+    }
+    catch (const std::runtime_error&)
+    {
+        caught = true;
+    }
+    CHECK(caught);
+
+    PoolFuture<int> f = toFuture(leaf(pool, 7), &pool);
+    CHECK(f.get() == 14);
+
+    long expect = 0;
+    for (int i = 0; i < 20000; i++) expect += i % 3;
+    CHECK(syncWait(manyShort(pool)) == expect);
+
+    caught = false;
+    try
+    {
+        syncWait(awaitMoved(pool));
+    }
+    catch (const std::future_error& e)
+    {
+        caught = e.code() == std::future_errc::no_state;
+    }
+    CHECK(caught);
+    return 0;
+}
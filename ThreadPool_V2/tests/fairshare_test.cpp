@@ -0,0 +1,118 @@
+#include "threadpool.h"
+#include "check.h"
+
+#include <atomic>
+#include <future>
+#include <thread>
+#include <vector>
+
+// 任务组: 都有积压时按权重公平调度 组的队列满时按DROP_OLDEST丢弃并计入组的统计
+
+// 用一个任务占住唯一的线程 之后提交的任务留在队列中 返回放开的promise
+static std::promise<void> block(ThreadPool& pool)
+{
+    std::promise<void> gate;
+    std::shared_future<void> opened = gate.get_future().share();
+    std::atomic_bool blocked(false);
+    pool.post([&blocked, opened]() {
+        blocked = true;
+        opened.wait();
+    });
+    while (!blocked) std::this_thread::yield();
+    return gate;
+}
+
+static void testWeights(SchedMode mode)
+{
+    ThreadPool pool;
+    pool.setSchedMode(mode);
+    pool.start(1);
+    std::promise<void> gate = block(pool);
+
+    const int perGroup = 200;
+    TaskGroup light = pool.createTaskGroup("light", 1, perGroup);
+    TaskGroup heavy = pool.createTaskGroup("heavy", 3, perGroup);
+    // 只有一个线程 执行顺序就是调度顺序
+    std::vector<int> order;
+    std::vector<std::future<void>> results;
+    for (int i = 0; i < perGroup; i++)
+    {
+        results.push_back(pool.submitTask(light, [&order]() {order.push_back(1);}));
+        results.push_back(pool.submitTask(heavy, [&order]() {order.push_back(3);}));
+    }
+    gate.set_value();
+    for (auto& f : results) f.get();
+
+    // heavy还有积压的前240个任务中 两组执行的任务数之比等于权重之比
+    CHECK(order.size() == 2 * perGroup);
+    int lightRan = 0;
+    for (int i = 0; i < 240; i++)
+    {
+        if (order[i] == 1) lightRan++;
+    }
+    CHECK(lightRan >= 58 && lightRan <= 62);
+
+    // 组的统计在任务结束后才更新 唯一的线程执行下一个任务时前面的统计已经完成
+    pool.submitTask([]() {}).get();
+    ThreadPoolStats stats = pool.stats();
+    CHECK(stats.groups[light.id].executedTasks == (uint64_t)perGroup);
+    CHECK(stats.groups[heavy.id].executedTasks == (uint64_t)perGroup);
+    CHECK(stats.groups[heavy.id].weight == 3);
+}
+
+static void testDropOldest(SchedMode mode)
+{
+    ThreadPool pool;
+    pool.setSchedMode(mode);
+    pool.setOverflowPolicy(OVERFLOW_DROP_OLDEST);
+    pool.start(1);
+    std::promise<void> gate = block(pool);
+
+    TaskGroup small = pool.createTaskGroup("small", 1, 4);
+    TaskGroup other = pool.createTaskGroup("other", 1, 4);
+    std::atomic_int ran(0);
+    std::vector<std::future<int>> results;
+    for (int i = 0; i < 10; i++)
+    {
+        results.push_back(pool.submitTask(small, [&ran, i]() {ran++; return i;}));
+    }
+    auto kept = pool.submitTask(other, []() {return -1;});
+
+    // 组满时丢弃组内最早的任务 只计入这个组
+    ThreadPoolStats stats = pool.stats();
+    CHECK(stats.groups[small.id].droppedTasks == 6);
+    CHECK(stats.groups[small.id].rejectedTasks == 0);
+    CHECK(stats.groups[small.id].submittedTasks == 10);
+    CHECK(stats.groups[other.id].droppedTasks == 0);
+    CHECK(stats.droppedTasks == 6);
+
+    gate.set_value();
+    CHECK(kept.get() == -1);
+    for (int i = 0; i < 10; i++)
+    {
+        bool dropped = false;
+        try
+        {
+            CHECK(results[i].get() == i);
+        }
+        catch (const std::future_error&)
+        {
+            dropped = true;
+        }
+        CHECK(dropped == (i < 6));
+    }
+    CHECK(ran == 4);
+    pool.submitTask([]() {}).get();
+    CHECK(pool.stats().groups[small.id].executedTasks == 4);
+}
+
+int main()
+{
+    Logger::setLevel(LOG_OFF);
+    for (SchedMode mode : {SCHED_SHARED_QUEUE, SCHED_WORK_STEALING, SCHED_LOCKFREE_QUEUE})
+    {
+        testWeights(mode);
+        testDropOldest(mode);
+    }
+    return 0;
+}
@@ -0,0 +1,159 @@
+#include "threadpool.h"
+#include "poolfuture.h"
+#include "check.h"
+
+#include <atomic>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+// PoolFuture: then续延、whenAll/whenAny的结果和异常传递、PoolPromise
+
+static void testThen(ThreadPool& pool)
+{
+    PoolFuture<std::string> f = submitAsync(pool, []() {return 20;})
+        .then([](int v) {return v + 1;})
+        .then([](int v) {return std::to_string(v);});
+    CHECK(f.get() == "21");
+
+    // 异常跳过后面的续延直接传递
+    std::atomic_int called(0);
+    PoolFuture<int> failed = submitAsync(pool, []() -> int {throw std::runtime_error("first");})
+        .then([&](int v) {called++; return v;});
+    bool caught = false;
+    try
+    {
+        failed.get();
+    }
+    catch (const std::runtime_error&)
+    {
+        caught = true;
+    }
+    CHECK(caught);
+    CHECK(called == 0);
+}
+
+static void testWhenAll(ThreadPool& pool)
+{
+    // 结果按输入顺序排列 和完成顺序无关
+    std::vector<PoolFuture<int>> futures;
+    for (int i = 0; i < 16; i++)
+    {
+        futures.push_back(submitAsync(pool, [i]() {
+            std::this_thread::sleep_for(std::chrono::microseconds((16 - i) * 100));
+            return i * i;
+        }));
+    }
+    std::vector<int> values = whenAll(std::move(futures)).get();
+    CHECK(values.size() == 16);
+    for (int i = 0; i < 16; i++) CHECK(values[i] == i * i);
+
+    // 任意一个失败时得到异常
+    std::vector<PoolFuture<void>> voids;
+    voids.push_back(submitAsync(pool, []() {}));
+    voids.push_back(submitAsync(pool, []() {throw std::logic_error("bad");}));
+    voids.push_back(submitAsync(pool, []() {}));
+    bool caught = false;
+    try
+    {
+        whenAll(std::move(voids)).get();
+    }
+    catch (const std::logic_error&)
+    {
+        caught = true;
+    }
+    CHECK(caught);
+
+    // 空输入立即就绪
+    CHECK(whenAll(std::vector<PoolFuture<int>>()).get().empty());
+
+    // 不同类型的future组成tuple
+    auto tuple = whenAll(submitAsync(pool, []() {return 1;}), submitAsync(pool, []() {return std::string("x");})).get();
+    CHECK(std::get<0>(tuple) == 1);
+    CHECK(std::get<1>(tuple) == "x");
+}
+
+static void testWhenAny(ThreadPool& pool)
+{
+    // 最先设置结果的future胜出 之后完成的不影响结果
+    std::vector<PoolPromise<int>> promises(4);
+    std::vector<PoolFuture<int>> futures;
+    for (auto& p : promises) futures.push_back(p.getFuture(&pool));
+    PoolFuture<WhenAnyResult<int>> any = whenAny(std::move(futures));
+    CHECK(!any.ready());
+    promises[2].setValue(22);
+    CHECK(any.ready());
+    promises[0].setValue(10);
+    WhenAnyResult<int> result = any.get();
+    CHECK(result.index == 2);
+    CHECK(result.value == 22);
+    promises[1].setValue(11);
+    promises[3].setValue(33);
+
+    // 最先完成的是异常时得到异常
+    std::vector<PoolPromise<void>> voidPromises(2);
+    std::vector<PoolFuture<void>> voids;
+    for (auto& p : voidPromises) voids.push_back(p.getFuture(&pool));
+    PoolFuture<size_t> anyVoid = whenAny(std::move(voids));
+    voidPromises[1].setException(std::make_exception_ptr(std::runtime_error("lost")));
+    voidPromises[0].setValue();
+    bool caught = false;
+    try
+    {
+        anyVoid.get();
+    }
+    catch (const std::runtime_error&)
+    {
+        caught = true;
+    }
+    CHECK(caught);
+
+    // 空输入得到std::invalid_argument
+    caught = false;
+    try
+    {
+        whenAny(std::vector<PoolFuture<int>>()).get();
+    }
+    catch (const std::invalid_argument&)
+    {
+        caught = true;
+    }
+    CHECK(caught);
+}
+
+static void testBrokenPromise()
+{
+    PoolFuture<int> f;
+    {
+        PoolPromise<int> promise;
+        f = promise.getFuture();
+    }
+    bool caught = false;
+    try
+    {
+        f.get();
+    }
+    catch (const std::future_error&)
+    {
+        caught = true;
+    }
+    CHECK(caught);
+}
+
+int main()
+{
+    Logger::setLevel(LOG_OFF);
+    for (SchedMode mode : {SCHED_SHARED_QUEUE, SCHED_WORK_STEALING, SCHED_LOCKFREE_QUEUE})
+    {
+        ThreadPool pool;
+        pool.setSchedMode(mode);
+        pool.start(2);
+        testThen(pool);
+        testWhenAll(pool);
+        testWhenAny(pool);
+    }
+    testBrokenPromise();
+    return 0;
+}
@@ -0,0 +1,89 @@
+#include "threadpool.h"
+#include "check.h"
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <thread>
+
+// 等待future时执行其他任务: 固定数量的线程上任务等待自己提交的任务不会死锁
+
+// 用一个任务占住唯一的线程 之后提交的任务留在队列中 返回放开的promise
+static std::promise<void> block(ThreadPool& pool)
+{
+    std::promise<void> gate;
+    std::shared_future<void> opened = gate.get_future().share();
+    std::atomic_bool blocked(false);
+    pool.post([&blocked, opened]() {
+        blocked = true;
+        opened.wait();
+    });
+    while (!blocked) std::this_thread::yield();
+    return gate;
+}
+
+// 递归分治 每一层提交两个子任务并等待
+static int fib(ThreadPool& pool, int n)
+{
+    if (n < 2) return n;
+    auto a = pool.submitTask(fib, std::ref(pool), n - 1);
+    auto b = pool.submitTask(fib, std::ref(pool), n - 2);
+    pool.wait(a);
+    pool.wait(b);
+    return a.get() + b.get();
+}
+
+static void testNested(SchedMode mode)
+{
+    ThreadPool pool;
+    pool.setSchedMode(mode);
+    pool.start(1);
+
+    // wait: 父任务等待自己提交的子任务 多层嵌套
+    auto f = pool.submitTask(fib, std::ref(pool), 12);
+    CHECK(f.wait_for(std::chrono::seconds(5)) == std::future_status::ready);
+    CHECK(f.get() == 144);
+
+    // helpUntil: 等待任意条件 子任务没有future
+    auto counted = pool.submitTask([&pool]() {
+        std::atomic_int done(0);
+        for (int i = 0; i < 8; i++) pool.post([&done]() {done++;});
+        pool.helpUntil([&]() {return done == 8;}, []() {std::this_thread::yield();});
+        return done.load();
+    });
+    CHECK(counted.wait_for(std::chrono::seconds(5)) == std::future_status::ready);
+    CHECK(counted.get() == 8);
+}
+
+static void testBatch(SchedMode mode)
+{
+    // P等待排在它后面的Q 线程一次取出P和Q Q只能在P等待期间由同一个线程执行
+    ThreadPool pool;
+    pool.setSchedMode(mode);
+    pool.setDequeueBatch(4);
+    pool.start(1);
+    std::promise<void> gate = block(pool);
+
+    std::shared_future<int> fq;
+    auto fp = pool.submitTask([&]() {
+        pool.wait(fq);
+        return fq.get() + 1;
+    });
+    fq = pool.submitTask([]() {return 41;}).share();
+    gate.set_value();
+
+    CHECK(fp.wait_for(std::chrono::seconds(5)) == std::future_status::ready);
+    CHECK(fp.get() == 42);
+}
+
+int main()
+{
+    Logger::setLevel(LOG_OFF);
+    for (SchedMode mode : {SCHED_SHARED_QUEUE, SCHED_WORK_STEALING, SCHED_LOCKFREE_QUEUE})
+    {
+        testNested(mode);
+        testBatch(mode);
+    }
+    return 0;
+}
@@ -0,0 +1,86 @@
+#include "mpmcqueue.h"
+#include "check.h"
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// 有界MPMC队列: 容量、FIFO 以及多生产者多消费者时每个元素恰好取出一次
+
+static void testSingleThread()
+{
+    MpmcQueue<int> que(5);
+    CHECK(que.capacity() == 8);
+    for (int i = 0; i < 8; i++) CHECK(que.tryPush(i));
+    CHECK(!que.tryPush(100));
+    CHECK(que.sizeApprox() == 8);
+    int item;
+    for (int i = 0; i < 8; i++)
+    {
+        CHECK(que.tryPop(item));
+        CHECK(item == i);
+    }
+    CHECK(!que.tryPop(item));
+
+    // 只能移动的类型 多次绕回
+    MpmcQueue<std::unique_ptr<int>> owned(4);
+    for (int round = 0; round < 10; round++)
+    {
+        for (int i = 0; i < 4; i++) CHECK(owned.tryPush(std::make_unique<int>(round * 4 + i)));
+        std::unique_ptr<int> p;
+        for (int i = 0; i < 4; i++)
+        {
+            CHECK(owned.tryPop(p));
+            CHECK(*p == round * 4 + i);
+        }
+    }
+}
+
+static void testConcurrent()
+{
+    const int producers = 3;
+    const int consumers = 3;
+    const int perProducer = 20000;
+    MpmcQueue<int> que(64);
+    std::vector<std::atomic_int> seen(producers * perProducer);
+    std::atomic_int consumed(0);
+
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; p++)
+    {
+        threads.emplace_back([&, p]() {
+            for (int i = 0; i < perProducer; i++)
+            {
+                while (!que.tryPush(p * perProducer + i)) std::this_thread::yield();
+            }
+        });
+    }
+    for (int c = 0; c < consumers; c++)
+    {
+        threads.emplace_back([&]() {
+            int item;
+            while (consumed.load() < producers * perProducer)
+            {
+                if (que.tryPop(item))
+                {
+                    seen[item]++;
+                    consumed++;
+                }
+                else
+                {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+    for (auto& s : seen) CHECK(s == 1);
+}
+
+int main()
+{
+    testSingleThread();
+    testConcurrent();
+    return 0;
+}
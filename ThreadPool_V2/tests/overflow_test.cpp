@@ -0,0 +1,185 @@
+#include "threadpool.h"
+#include "check.h"
+
+#include <atomic>
+#include <future>
+#include <thread>
+#include <vector>
+
+// 队列满时的溢出策略: 拒绝、提交线程执行、丢弃最早的任务、等待超时 以及trySubmit和submitTaskFor
+
+const int QUEUE_LIMIT = 8;
+
+// 用一个任务占住唯一的线程 之后提交的任务都留在队列中 析构时放开
+class BlockedPool
+{
+    public:
+        BlockedPool(SchedMode mode, OverflowPolicy policy)
+        {
+            opened_ = gate_.get_future().share();
+            pool_.setSchedMode(mode);
+            pool_.setOverflowPolicy(policy);
+            pool_.setTaskQueThreshHold(QUEUE_LIMIT);
+            pool_.setSubmitTimeout(std::chrono::milliseconds(20));
+            pool_.start(1);
+            std::atomic_bool blocked(false);
+            std::shared_future<void> opened = opened_;
+            pool_.post([&blocked, opened]() {
+                blocked = true;
+                opened.wait();
+            });
+            while (!blocked) std::this_thread::yield();
+        }
+        ~BlockedPool() { open(); }
+
+        void open()
+        {
+            if (!isOpen_) gate_.set_value();
+            isOpen_ = true;
+        }
+
+        ThreadPool& operator*() { return pool_; }
+        ThreadPool* operator->() { return &pool_; }
+
+    private:
+        std::promise<void> gate_;
+        std::shared_future<void> opened_;
+        bool isOpen_ = false;
+        ThreadPool pool_; // 最后声明 最先析构 析构前已经放开
+};
+
+template <typename T>
+static bool rejected(std::future<T>& f)
+{
+    try
+    {
+        f.get();
+    }
+    catch (const TaskRejectedError&)
+    {
+        return true;
+    }
+    return false;
+}
+
+static void testReject(SchedMode mode)
+{
+    BlockedPool pool(mode, OVERFLOW_REJECT);
+    std::atomic_int ran(0);
+    std::vector<std::future<void>> results;
+    for (int i = 0; i < QUEUE_LIMIT + 4; i++)
+    {
+        results.push_back(pool->submitTask([&]() {ran++;}));
+    }
+    CHECK(pool->stats().rejectedTasks == 4);
+    pool.open();
+    int failed = 0;
+    for (auto& f : results)
+    {
+        if (rejected(f)) failed++;
+    }
+    CHECK(failed == 4);
+    CHECK(ran == QUEUE_LIMIT);
+}
+
+static void testCallerRuns(SchedMode mode)
+{
+    BlockedPool pool(mode, OVERFLOW_CALLER_RUNS);
+    std::atomic_int onCaller(0);
+    std::atomic_int ran(0);
+    std::thread::id caller = std::this_thread::get_id();
+    std::vector<std::future<void>> results;
+    for (int i = 0; i < QUEUE_LIMIT + 4; i++)
+    {
+        results.push_back(pool->submitTask([&]() {
+            if (std::this_thread::get_id() == caller) onCaller++;
+            ran++;
+        }));
+    }
+    // 放不下的任务已经在提交线程上执行完
+    CHECK(onCaller == 4);
+    CHECK(pool->stats().callerRunsTasks == 4);
+    pool.open();
+    for (auto& f : results) f.get();
+    CHECK(ran == QUEUE_LIMIT + 4);
+}
+
+static void testDropOldest(SchedMode mode)
+{
+    BlockedPool pool(mode, OVERFLOW_DROP_OLDEST);
+    std::atomic_int ranLow(0);
+    std::atomic_int ranHigh(0);
+    std::vector<std::future<void>> lows;
+    std::vector<std::future<void>> highs;
+    for (int i = 0; i < QUEUE_LIMIT; i++)
+    {
+        lows.push_back(pool->submitTask(PRIORITY_LOW, [&]() {ranLow++;}));
+    }
+    // 高优先级任务挤掉所有低优先级任务
+    for (int i = 0; i < QUEUE_LIMIT; i++)
+    {
+        highs.push_back(pool->submitTask(PRIORITY_HIGH, [&]() {ranHigh++;}));
+    }
+    CHECK(pool->stats().droppedTasks == QUEUE_LIMIT);
+    // 不会为低优先级的新任务丢弃高优先级的任务
+    auto late = pool->submitTask(PRIORITY_LOW, [&]() {ranLow++;});
+    CHECK(rejected(late));
+
+    pool.open();
+    for (auto& f : highs) f.get();
+    for (auto& f : lows)
+    {
+        // 丢弃的任务没有执行 future不会一直阻塞
+        bool failed = false;
+        try
+        {
+            f.get();
+        }
+        catch (const std::future_error&)
+        {
+            failed = true;
+        }
+        CHECK(failed);
+    }
+    CHECK(ranHigh == QUEUE_LIMIT);
+    CHECK(ranLow == 0);
+}
+
+static void testBlockAndTry(SchedMode mode)
+{
+    BlockedPool pool(mode, OVERFLOW_BLOCK);
+    std::vector<std::future<int>> results;
+    for (int i = 0; i < QUEUE_LIMIT; i++)
+    {
+        results.push_back(pool->submitTask([i]() {return i;}));
+    }
+    // 等待提交超时后拒绝
+    auto start = std::chrono::steady_clock::now();
+    auto blocked = pool->submitTask([]() {return -1;});
+    CHECK(std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(15));
+    CHECK(rejected(blocked));
+
+    CHECK(!pool->trySubmit([]() {return -1;}).has_value());
+    auto timed = pool->submitTaskFor(std::chrono::milliseconds(5), []() {return -1;});
+    CHECK(rejected(timed));
+    CHECK(pool->stats().rejectedTasks == 3);
+
+    pool.open();
+    for (int i = 0; i < QUEUE_LIMIT; i++) CHECK(results[i].get() == i);
+    // 队列腾空后可以再次提交
+    auto again = pool->trySubmit([]() {return 42;});
+    CHECK(again.has_value() && again->get() == 42);
+}
+
+int main()
+{
+    Logger::setLevel(LOG_OFF);
+    for (SchedMode mode : {SCHED_SHARED_QUEUE, SCHED_WORK_STEALING, SCHED_LOCKFREE_QUEUE})
+    {
+        testReject(mode);
+        testCallerRuns(mode);
+        testDropOldest(mode);
+        testBlockAndTry(mode);
+    }
+    return 0;
+}
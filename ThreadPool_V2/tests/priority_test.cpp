@@ -0,0 +1,108 @@
+#include "threadpool.h"
+#include "prioritytaskqueue.h"
+#include "check.h"
+
+#include <atomic>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// 多级优先级: 高优先级先出队 低优先级任务连续被插队的次数不超过防饥饿阈值
+
+static void testQueue()
+{
+    PriorityTaskQueue<int> que;
+    que.setAgingThreshHold(4);
+    for (int i = 0; i < 10; i++) que.push(100 + i, PRIORITY_HIGH);
+    for (int i = 0; i < 3; i++) que.push(int(i), PRIORITY_LOW);
+
+    // 低优先级队列每被跳过一次计数加一 第4次出队时轮到它
+    const int expect[] = {100, 101, 102, 0, 103, 104, 105, 1, 106, 107, 108, 2, 109};
+    for (int v : expect)
+    {
+        int item = -1;
+        CHECK(que.pop(item));
+        CHECK(item == v);
+    }
+    int item;
+    CHECK(!que.pop(item));
+
+    // popLowest不会取比floor更高优先级的任务
+    que.push(1, PRIORITY_HIGH);
+    CHECK(!que.popLowest(item, PRIORITY_NORMAL));
+    que.push(2, PRIORITY_LOW);
+    CHECK(que.popLowest(item, PRIORITY_NORMAL) && item == 2);
+}
+
+// 单线程的线程池 先用一个任务占住线程 排好队之后放开 记录执行顺序
+static std::vector<Priority> runOrder(SchedMode mode, int aging, int highs, int lows)
+{
+    ThreadPool pool;
+    pool.setSchedMode(mode);
+    pool.setPriorityAgingThreshHold(aging);
+    pool.start(1);
+
+    std::promise<void> gate;
+    std::shared_future<void> opened = gate.get_future().share();
+    std::atomic_bool blocked(false);
+    auto first = pool.submitTask(PRIORITY_HIGH, [&]() {
+        blocked = true;
+        opened.wait();
+    });
+    while (!blocked) std::this_thread::yield();
+
+    std::mutex mtx;
+    std::vector<Priority> order;
+    std::vector<std::future<void>> results;
+    auto record = [&](Priority p) {
+        return [&, p]() {
+            std::lock_guard<std::mutex> lock(mtx);
+            order.push_back(p);
+        };
+    };
+    for (int i = 0; i < lows; i++) results.push_back(pool.submitTask(PRIORITY_LOW, record(PRIORITY_LOW)));
+    for (int i = 0; i < highs; i++) results.push_back(pool.submitTask(PRIORITY_HIGH, record(PRIORITY_HIGH)));
+    gate.set_value();
+    first.get();
+    for (auto& f : results) f.get();
+    return order;
+}
+
+static void testPool(SchedMode mode)
+{
+    // 阈值很大时所有高优先级任务先执行
+    std::vector<Priority> order = runOrder(mode, 1000, 20, 5);
+    CHECK(order.size() == 25);
+    for (int i = 0; i < 20; i++) CHECK(order[i] == PRIORITY_HIGH);
+
+    // 还有低优先级任务排队时 连续执行的高优先级任务不超过阈值
+    const int aging = 4;
+    order = runOrder(mode, aging, 40, 5);
+    CHECK(order.size() == 45);
+    int lowsLeft = 5;
+    int run = 0;
+    for (Priority p : order)
+    {
+        if (lowsLeft == 0) break;
+        if (p == PRIORITY_LOW)
+        {
+            lowsLeft--;
+            run = 0;
+        }
+        else
+        {
+            CHECK(++run <= aging);
+        }
+    }
+    CHECK(lowsLeft == 0);
+}
+
+int main()
+{
+    Logger::setLevel(LOG_OFF);
+    testQueue();
+    testPool(SCHED_SHARED_QUEUE);
+    testPool(SCHED_LOCKFREE_QUEUE);
+    return 0;
+}
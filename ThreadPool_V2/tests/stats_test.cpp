@@ -0,0 +1,93 @@
+#include "threadpool.h"
+#include "poolstats.h"
+#include "check.h"
+
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+// 运行时统计: 已知样本的直方图百分位 以及线程池汇总的任务数
+// 用-DTHREADPOOL_STATS=OFF编译时没有统计 测试直接通过
+
+#ifndef THREADPOOL_NO_STATS
+
+// 百分位返回所在桶的上界 不小于真实值 相对误差不超过1/8
+static bool near(uint64_t got, uint64_t expect)
+{
+    return got >= expect && got <= expect + expect / 8;
+}
+
+static void testHistogram()
+{
+    HistogramSnapshot empty;
+    LatencyHistogram().addTo(empty);
+    CHECK(empty.count() == 0);
+    CHECK(empty.percentile(50) == 0);
+
+    // 1..1000
+    LatencyHistogram hist;
+    for (int v = 1; v <= 1000; v++) hist.record(v);
+    HistogramSnapshot snap;
+    hist.addTo(snap);
+    CHECK(snap.count() == 1000);
+    CHECK(snap.max() == 1000);
+    CHECK(snap.mean() == 500.5);
+    CHECK(near(snap.percentile(50), 500));
+    CHECK(near(snap.percentile(90), 900));
+    CHECK(near(snap.percentile(99), 990));
+    CHECK(snap.percentile(100) == 1000);
+    // 小于SUB_BUCKETS的值每个值一个桶 没有误差
+    CHECK(snap.percentile(0.1) == 1);
+
+    // 两个直方图合并 负值按0记录
+    LatencyHistogram other;
+    for (int i = 0; i < 1000; i++) other.recordConcurrent(1000000);
+    other.record(-5);
+    other.addTo(snap);
+    CHECK(snap.count() == 2001);
+    CHECK(snap.max() == 1000000);
+    CHECK(near(snap.percentile(25), 500));
+    CHECK(near(snap.percentile(75), 1000000));
+
+    // 桶的下界和编号一致
+    for (uint64_t v = 0; v < 100000; v += 7)
+    {
+        int bucket = LatencyHistogram::bucketIndex(v);
+        CHECK(HistogramSnapshot::bucketLowerBound(bucket) <= v);
+        CHECK(HistogramSnapshot::bucketLowerBound(bucket + 1) > v);
+    }
+}
+
+static void testPool(SchedMode mode)
+{
+    ThreadPool pool;
+    pool.setSchedMode(mode);
+    pool.start(2);
+    for (int i = 0; i < 100; i++) pool.submitTask([]() {}).get();
+    // 统计在future就绪之后才更新 等最后一个任务计入
+    ThreadPoolStats stats = pool.stats();
+    for (int i = 0; i < 1000 && stats.tasksExecuted < 100; i++)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        stats = pool.stats();
+    }
+    CHECK(stats.tasksExecuted == 100);
+    CHECK(stats.exec.count() == stats.tasksExecuted);
+    CHECK(stats.queueWait.count() == stats.tasksExecuted);
+    CHECK(stats.exec.percentile(50) <= stats.exec.max());
+}
+
+#endif
+
+int main()
+{
+    Logger::setLevel(LOG_OFF);
+#ifndef THREADPOOL_NO_STATS
+    testHistogram();
+    for (SchedMode mode : {SCHED_SHARED_QUEUE, SCHED_WORK_STEALING, SCHED_LOCKFREE_QUEUE})
+    {
+        testPool(mode);
+    }
+#endif
+    return 0;
+}
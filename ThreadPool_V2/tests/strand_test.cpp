@@ -0,0 +1,110 @@
+#include "threadpool.h"
+#include "strand.h"
+#include "check.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <stdexcept>
+
+// Strand和KeyedStrands: 按提交顺序执行、同一个Strand的任务不重叠、任务抛出异常后继续执行
+
+static void testFifo(ThreadPool& pool)
+{
+    const int producers = 4;
+    const int perProducer = 2000;
+    std::vector<int> next(producers, 0);
+    std::atomic_int inside(0);
+    std::atomic_int overlaps(0);
+    std::atomic_int reordered(0);
+    {
+        Strand strand(pool);
+        std::vector<std::thread> threads;
+        for (int p = 0; p < producers; p++)
+        {
+            threads.emplace_back([&, p]() {
+                for (int i = 0; i < perProducer; i++)
+                {
+                    strand.post([&, p, i]() {
+                        if (inside.fetch_add(1) != 0) overlaps++;
+                        CHECK(strand.runningInThisThread());
+                        // 同一个生产者的任务按提交顺序执行
+                        if (next[p] != i) reordered++;
+                        next[p] = i + 1;
+                        inside.fetch_sub(1);
+                    });
+                }
+            });
+        }
+        for (auto& t : threads) t.join();
+        CHECK(strand.submit([&]() {return next[0];}).get() == perProducer);
+    }
+    CHECK(overlaps == 0);
+    CHECK(reordered == 0);
+    for (int p = 0; p < producers; p++) CHECK(next[p] == perProducer);
+}
+
+static void testKeyed(ThreadPool& pool)
+{
+    const int keys = 8;
+    const int perKey = 500;
+    std::vector<int> next(keys, 0);
+    std::atomic_int reordered(0);
+    KeyedStrands strands(pool, keys);
+    for (int i = 0; i < perKey; i++)
+    {
+        for (int k = 0; k < keys; k++)
+        {
+            strands.post(k, [&, k, i]() {
+                if (next[k] != i) reordered++;
+                next[k] = i + 1;
+            });
+        }
+    }
+    for (int k = 0; k < keys; k++)
+    {
+        CHECK(strands.submit(k, [&, k]() {return next[k];}).get() == perKey);
+    }
+    CHECK(reordered == 0);
+}
+
+static void testThrowing(ThreadPool& pool)
+{
+    std::atomic_int ran(0);
+    Strand strand(pool);
+    for (int i = 0; i < 200; i++)
+    {
+        strand.post([&, i]() {
+            if (i % 7 == 0) throw std::runtime_error("strand task failed");
+            ran++;
+        });
+    }
+    auto f = strand.submit([]() -> int {throw std::logic_error("in future");});
+    bool caught = false;
+    try
+    {
+        f.get();
+    }
+    catch (const std::logic_error&)
+    {
+        caught = true;
+    }
+    CHECK(caught);
+    CHECK(ran == 200 - 29);
+    // 异常没有让Strand停住 析构不会一直等待
+}
+
+int main()
+{
+    Logger::setLevel(LOG_OFF);
+    for (SchedMode mode : {SCHED_SHARED_QUEUE, SCHED_WORK_STEALING, SCHED_LOCKFREE_QUEUE})
+    {
+        ThreadPool pool;
+        pool.setSchedMode(mode);
+        pool.start(3);
+        testFifo(pool);
+        testKeyed(pool);
+        testThrowing(pool);
+    }
+    return 0;
+}
@@ -0,0 +1,190 @@
+#include "threadpool.h"
+#include "taskgraph.h"
+#include "check.h"
+
+#include <atomic>
+#include <future>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+// TaskGraph: 依赖顺序、异常、环检测、重叠的run、run期间修改图 以及队列满时按OVERFLOW_DROP_OLDEST挤出节点
+
+static void testOrder(ThreadPool& pool)
+{
+    // 菱形 a -> b, c -> d
+    TaskGraph graph;
+    std::atomic_int step(0);
+    int a = -1, b = -1, c = -1, d = -1;
+    auto na = graph.addNode([&]() {a = step++;});
+    auto nb = graph.addNode([&]() {b = step++;});
+    auto nc = graph.addNode([&]() {c = step++;});
+    auto nd = graph.addNode([&]() {d = step++;});
+    graph.addEdge(na, nb);
+    graph.addEdge(na, nc);
+    graph.addEdge(nb, nd);
+    graph.addEdge(nc, nd);
+    for (int round = 0; round < 20; round++)
+    {
+        step = 0;
+        graph.run(pool).get();
+        CHECK(a == 0);
+        CHECK(b > a && c > a);
+        CHECK(d == 3);
+    }
+}
+
+static void testFailure(ThreadPool& pool)
+{
+    TaskGraph graph;
+    std::atomic_int after(0);
+    auto first = graph.addNode([]() {throw std::runtime_error("node failed");});
+    auto second = graph.addNode([&]() {after++;});
+    graph.addEdge(first, second);
+    bool caught = false;
+    try
+    {
+        graph.run(pool).get();
+    }
+    catch (const std::runtime_error&)
+    {
+        caught = true;
+    }
+    CHECK(caught);
+    CHECK(after == 0);
+
+    TaskGraph cyclic;
+    auto x = cyclic.addNode([]() {});
+    auto y = cyclic.addNode([]() {});
+    cyclic.addEdge(x, y);
+    cyclic.addEdge(y, x);
+    caught = false;
+    try
+    {
+        cyclic.run(pool).get();
+    }
+    catch (const std::logic_error&)
+    {
+        caught = true;
+    }
+    CHECK(caught);
+
+    caught = false;
+    try
+    {
+        cyclic.addEdge(x, 100);
+    }
+    catch (const std::out_of_range&)
+    {
+        caught = true;
+    }
+    CHECK(caught);
+}
+
+static void testConcurrentRuns(ThreadPool& pool)
+{
+    TaskGraph graph;
+    std::atomic_int count(0);
+    std::promise<void> gate;
+    std::shared_future<void> opened = gate.get_future().share();
+    auto head = graph.addNode([&, opened]() {opened.wait(); count++;});
+    auto tail = graph.addNode([&]() {count++;});
+    graph.addEdge(head, tail);
+
+    // 多个线程同时run同一个图 每次run有自己的计数器
+    std::mutex mtx;
+    std::vector<PoolFuture<void>> runs;
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; i++)
+    {
+        threads.emplace_back([&]() {
+            PoolFuture<void> f = graph.run(pool);
+            std::lock_guard<std::mutex> lock(mtx);
+            runs.push_back(std::move(f));
+        });
+    }
+    for (auto& t : threads) t.join();
+
+    // run还没有完成时不能修改图
+    bool caught = false;
+    try
+    {
+        graph.addNode([]() {});
+    }
+    catch (const std::logic_error&)
+    {
+        caught = true;
+    }
+    CHECK(caught);
+
+    gate.set_value();
+    for (auto& f : runs) f.get();
+    CHECK(count == 8);
+
+    // 所有run完成后可以继续修改
+    graph.addNode([&]() {count++;});
+    graph.run(pool).get();
+    CHECK(count == 11);
+}
+
+static void testDropOldest(SchedMode mode)
+{
+    // 占住唯一的线程 节点任务在队列中时被高优先级任务挤出
+    ThreadPool pool;
+    pool.setSchedMode(mode);
+    pool.setOverflowPolicy(OVERFLOW_DROP_OLDEST);
+    pool.setTaskQueThreshHold(8);
+    pool.start(1);
+    std::promise<void> gate;
+    std::shared_future<void> opened = gate.get_future().share();
+    std::atomic_bool blocked(false);
+    pool.post([&blocked, opened]() {
+        blocked = true;
+        opened.wait();
+    });
+    while (!blocked) std::this_thread::yield();
+
+    // 4个根节点 -> sink
+    TaskGraph graph;
+    std::atomic_int count(0);
+    auto sink = graph.addNode([&]() {count++;});
+    for (int i = 0; i < 4; i++)
+    {
+        graph.addEdge(graph.addNode([&]() {count++;}), sink);
+    }
+    PoolFuture<void> run = graph.run(pool);
+
+    std::vector<std::future<void>> highs;
+    for (int i = 0; i < 8; i++)
+    {
+        highs.push_back(pool.submitTask(PRIORITY_HIGH, []() {}));
+    }
+    // 节点任务没有被丢弃 挤出时在提交线程上执行
+    CHECK(run.ready());
+    CHECK(count == 5);
+    ThreadPoolStats stats = pool.stats();
+    CHECK(stats.droppedTasks == 0);
+    CHECK(stats.callerRunsTasks == 4);
+
+    gate.set_value();
+    run.get();
+    for (auto& f : highs) f.get();
+    graph.addNode([]() {});
+}
+
+int main()
+{
+    Logger::setLevel(LOG_OFF);
+    for (SchedMode mode : {SCHED_SHARED_QUEUE, SCHED_WORK_STEALING, SCHED_LOCKFREE_QUEUE})
+    {
+        ThreadPool pool;
+        pool.setSchedMode(mode);
+        pool.start(4);
+        testOrder(pool);
+        testFailure(pool);
+        testConcurrentRuns(pool);
+        testDropOldest(mode);
+    }
+    return 0;
+}
@@ -0,0 +1,73 @@
+#include "threadpool.h"
+#include "check.h"
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <thread>
+
+// 定时任务: 不早于指定时间执行、取消、周期任务
+
+using Clock = std::chrono::steady_clock;
+
+static void testDelay(ThreadPool& pool)
+{
+    std::promise<Clock::time_point> fired;
+    auto start = Clock::now();
+    TimerId id = pool.submitAfter(std::chrono::milliseconds(30), [&]() {fired.set_value(Clock::now());});
+    CHECK(id.valid());
+    CHECK(fired.get_future().get() - start >= std::chrono::milliseconds(30));
+    // 已经执行过的定时任务不能再取消
+    CHECK(!pool.cancelTimer(id));
+
+    std::promise<void> at;
+    pool.submitAt(Clock::now() + std::chrono::milliseconds(5), [&]() {at.set_value();});
+    at.get_future().get();
+}
+
+static void testCancel(ThreadPool& pool)
+{
+    std::atomic_int ran(0);
+    TimerId id = pool.submitAfter(std::chrono::milliseconds(50), [&]() {ran++;});
+    CHECK(pool.cancelTimer(id));
+    CHECK(!pool.cancelTimer(id));
+
+    // 比被取消的任务晚到期的任务执行时 被取消的任务一定已经过期
+    std::promise<void> later;
+    pool.submitAfter(std::chrono::milliseconds(80), [&]() {later.set_value();});
+    later.get_future().get();
+    CHECK(ran == 0);
+}
+
+static void testPeriodic(ThreadPool& pool)
+{
+    std::atomic_int ticks(0);
+    TimerId id = pool.submitEvery(std::chrono::milliseconds(5), [&]() {ticks++;});
+    while (ticks < 5) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    CHECK(pool.cancelTimer(id));
+    // 取消时已经放入任务队列的那一次仍会执行 之后不再增加
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    int stopped = ticks;
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    CHECK(ticks == stopped);
+}
+
+int main()
+{
+    Logger::setLevel(LOG_OFF);
+    {
+        // 还没有start时返回无效的TimerId
+        ThreadPool idle;
+        CHECK(!idle.submitAfter(std::chrono::milliseconds(1), []() {}).valid());
+    }
+    for (SchedMode mode : {SCHED_SHARED_QUEUE, SCHED_WORK_STEALING, SCHED_LOCKFREE_QUEUE})
+    {
+        ThreadPool pool;
+        pool.setSchedMode(mode);
+        pool.start(2);
+        testDelay(pool);
+        testCancel(pool);
+        testPeriodic(pool);
+    }
+    return 0;
+}
@@ -0,0 +1,86 @@
+#include "topology.h"
+#include "check.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+
+// CPU拓扑: 从构造的sysfs目录读取节点、CPU列表和物理核 节点编号不连续和缺少node目录时的处理
+
+namespace fs = std::filesystem;
+
+static void writeFile(const fs::path& path, const std::string& text)
+{
+    fs::create_directories(path.parent_path());
+    std::ofstream(path) << text << "\n";
+}
+
+// 两个封装各4个核 CPU 0-3在第一个封装 8-11在第二个封装
+static fs::path makeTree(const fs::path& root)
+{
+    writeFile(root / "cpu/online", "0-3,8-11");
+    for (int id : {0, 1, 2, 3, 8, 9, 10, 11})
+    {
+        fs::path base = root / ("cpu/cpu" + std::to_string(id)) / "topology";
+        writeFile(base / "core_id", std::to_string(id % 4));
+        writeFile(base / "physical_package_id", id < 8 ? "0" : "1");
+    }
+    return root;
+}
+
+static void testTwoNodes(const fs::path& root)
+{
+    // sysfs中的节点为node0和node2 重新编号为0和1
+    writeFile(root / "node/node0/cpulist", "0-3");
+    writeFile(root / "node/node2/cpulist", "8-11");
+    writeFile(root / "node/possible", "0,2"); // 不是nodeN目录 忽略
+    CpuTopology topo = CpuTopology::detect(root.string());
+    CHECK(topo.cpus().size() == 8);
+    CHECK(topo.nodeCount() == 2);
+    CHECK(topo.nodeOf(0) == 0 && topo.nodeOf(3) == 0);
+    CHECK(topo.nodeOf(8) == 1 && topo.nodeOf(11) == 1);
+    // 不在线或者未知的CPU属于节点0
+    CHECK(topo.nodeOf(5) == 0);
+    CHECK(topo.nodeOf(100) == 0);
+    for (const CpuTopology::Cpu& cpu : topo.cpus())
+    {
+        CHECK(cpu.core == cpu.id % 4);
+        CHECK(cpu.package == (cpu.id < 8 ? 0 : 1));
+    }
+
+    // compact先占满一个节点 spread在节点之间轮流
+    auto compact = topo.placement(AFFINITY_COMPACT);
+    for (int i = 0; i < 4; i++) CHECK(compact[i].node == 0);
+    for (int i = 4; i < 8; i++) CHECK(compact[i].node == 1);
+    auto spread = topo.placement(AFFINITY_SPREAD);
+    for (int i = 0; i < 8; i++) CHECK(spread[i].node == i % 2);
+}
+
+static void testMissingNodes(const fs::path& root)
+{
+    // 没有node目录(内核不支持NUMA) 所有CPU在一个节点上
+    fs::remove_all(root / "node");
+    CpuTopology topo = CpuTopology::detect(root.string());
+    CHECK(topo.cpus().size() == 8);
+    CHECK(topo.nodeCount() == 1);
+    CHECK(topo.nodeOf(9) == 0);
+
+    // 读不到CPU列表时退化为hardware_concurrency个CPU
+    CpuTopology empty = CpuTopology::detect((root / "missing").string());
+    CHECK(empty.nodeCount() == 1);
+    CHECK(empty.cpus().size() == std::max(1u, std::thread::hardware_concurrency()));
+}
+
+int main()
+{
+    char dir[] = "/tmp/topology_testXXXXXX";
+    CHECK(mkdtemp(dir) != nullptr);
+    fs::path root = makeTree(dir);
+    testTwoNodes(root);
+    testMissingNodes(root);
+    fs::remove_all(root);
+    return 0;
+}
@@ -0,0 +1,74 @@
+#include "threadpool.h"
+#include "tracer.h"
+#include "check.h"
+
+#include <cstdio>
+#include <string>
+
+// 任务追踪: 导出的Chrome trace中每个开启追踪后提交的任务恰好一个完整("X")事件 标签作为事件名
+#ifndef THREADPOOL_TRACING
+#error "tracer_test must be compiled with THREADPOOL_TRACING"
+#endif
+
+static size_t countOf(const std::string& text, const std::string& pattern)
+{
+    size_t count = 0;
+    for (size_t pos = text.find(pattern); pos != std::string::npos; pos = text.find(pattern, pos + 1)) count++;
+    return count;
+}
+
+// 写出trace并读回
+static std::string exportTrace()
+{
+    FILE* file = tmpfile();
+    CHECK(file != nullptr);
+    Tracer::writeChromeTrace(file);
+    std::string text;
+    rewind(file);
+    char buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), file)) > 0) text.append(buf, n);
+    fclose(file);
+    return text;
+}
+
+static void testExport(SchedMode mode)
+{
+    const int untraced = 5;
+    const int plain = 40;
+    const int labelled = 10;
+    {
+        ThreadPool pool;
+        pool.setSchedMode(mode);
+        pool.start(2);
+        // 开启追踪前提交的任务不记录
+        for (int i = 0; i < untraced; i++) pool.submitTask([]() {}).get();
+
+        Tracer::enable(true);
+        for (int i = 0; i < plain; i++) pool.submitTask([]() {}).get();
+        TaskOptions options;
+        options.label = "labelled";
+        for (int i = 0; i < labelled; i++) pool.submitTask(options, []() {}).get();
+        // 析构时等线程退出 所有任务的结束事件都已经写入缓冲区
+    }
+    Tracer::enable(false);
+
+    std::string trace = exportTrace();
+    CHECK(trace.front() == '{');
+    CHECK(countOf(trace, "\"cat\":\"task\",\"ph\":\"X\"") == (size_t)(plain + labelled));
+    CHECK(countOf(trace, "{\"name\":\"labelled\",\"cat\":\"task\",\"ph\":\"X\"") == (size_t)labelled);
+    CHECK(Tracer::droppedCount() == 0);
+
+    // 记录已经取走 再次导出时没有任务事件
+    CHECK(countOf(exportTrace(), "\"ph\":\"X\"") == 0);
+}
+
+int main()
+{
+    Logger::setLevel(LOG_OFF);
+    for (SchedMode mode : {SCHED_SHARED_QUEUE, SCHED_WORK_STEALING, SCHED_LOCKFREE_QUEUE})
+    {
+        testExport(mode);
+    }
+    return 0;
+}